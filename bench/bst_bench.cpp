@@ -0,0 +1,921 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bst.hpp"
+#include "bst_btree.hpp"
+#include "bst_external_sort.hpp"
+#include "bst_static.hpp"
+#include "key_streams.hpp"
+
+#ifndef BST_BENCH_MAX_KEYS
+#define BST_BENCH_MAX_KEYS 1000000
+#endif
+
+/* Thread-scaling benchmarks of concurrent_bst, in concurrent_bench.cpp */
+void register_concurrent_benchmarks();
+
+/* Thread-scaling benchmarks of the parallel scans and clear, in parallel_bench.cpp */
+void register_parallel_benchmarks();
+
+namespace
+{
+using namespace BST;
+using namespace BST::bench;
+
+/* Bytes currently handed out through counting_allocator, for the bytes/node counter */
+std::size_t allocated_bytes = 0;
+
+template<typename T>
+struct counting_allocator
+{
+    using value_type = T;
+
+    counting_allocator() = default;
+
+    template<typename U> counting_allocator(const counting_allocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        allocated_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        allocated_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool operator==(const counting_allocator&, const counting_allocator&) { return true; }
+};
+
+using plain_tree = binary_search_tree<int, unbalanced_policy, counting_allocator<int>>;
+using red_black_tree = binary_search_tree<int, red_black_policy, counting_allocator<int>>;
+using avl_tree = binary_search_tree<int, avl_policy, counting_allocator<int>>;
+using arena_red_black_tree = binary_search_tree<int, red_black_policy, arena_allocator<int>>;
+using counted_red_black_tree = binary_search_tree<int, duplicate_handling<duplicate_keys::count, red_black_policy>, counting_allocator<int>>;
+using unique_red_black_tree = binary_search_tree<int, duplicate_handling<duplicate_keys::reject, red_black_policy>, counting_allocator<int>>;
+using instrumented_red_black_tree = binary_search_tree<int, instrumented<red_black_policy>, counting_allocator<int>>;
+using splay_tree = binary_search_tree<int, splay_policy, counting_allocator<int>>;
+using semi_splay_tree = binary_search_tree<int, semi_splay_policy, counting_allocator<int>>;
+using sampled_semi_splay_tree = binary_search_tree<int, sampled_splaying<16, semi_splay_policy>, counting_allocator<int>>;
+
+/* Reports the time per tree operation next to Google Benchmark's time per iteration */
+void report_ops(benchmark::State& state, std::size_t ops_per_iteration)
+{
+    double ops = static_cast<double>(state.iterations()) * static_cast<double>(ops_per_iteration);
+    state.SetItemsProcessed(static_cast<std::int64_t>(ops));
+    state.counters["time/op"] = benchmark::Counter(ops, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+template<typename Tree>
+Tree build_tree(const std::vector<int>& keys)
+{
+    Tree tree;
+    for(int key : keys)
+        tree.insert(key);
+    return tree;
+}
+
+/* The keys of the stream in random order, used as lookup and delete sequences */
+std::vector<int> shuffled(std::vector<int> keys)
+{
+    std::mt19937_64 gen(7);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    return keys;
+}
+
+template<typename Tree>
+void bm_insert(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    std::size_t bytes_per_tree = 0;
+    for(auto _ : state)
+    {
+        std::size_t bytes_before = allocated_bytes;
+        Tree tree;
+        for(int key : keys)
+            tree.insert(key);
+        benchmark::DoNotOptimize(tree.get_root());
+
+        state.PauseTiming();
+        bytes_per_tree = allocated_bytes - bytes_before;
+        tree.clear();
+        state.ResumeTiming();
+    }
+
+    report_ops(state, keys.size());
+    if(bytes_per_tree != 0)
+        state.counters["bytes/node"] = static_cast<double>(bytes_per_tree) / static_cast<double>(keys.size());
+}
+
+template<typename Tree>
+void bm_search(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto lookups = shuffled(keys);
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+            benchmark::DoNotOptimize(tree.search(key));
+    }
+
+    report_ops(state, lookups.size());
+}
+
+/* search_batch over consecutive batches of state.range(1) lookups, each batch sorted first when sorted_batches */
+template<typename Tree>
+void bm_search_batch(benchmark::State& state, key_order order, bool sorted_batches)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const std::size_t batch_size = static_cast<std::size_t>(state.range(1));
+    auto lookups = shuffled(keys);
+    if(sorted_batches)
+    {
+        for(std::size_t batch_start = 0; batch_start < lookups.size(); batch_start += batch_size)
+            std::sort(lookups.begin() + batch_start, lookups.begin() + std::min(lookups.size(), batch_start + batch_size));
+    }
+
+    const Tree tree = build_tree<Tree>(keys);
+    std::vector<typename Tree::node_pointer> found(batch_size);
+    for(auto _ : state)
+    {
+        for(std::size_t batch_start = 0; batch_start < lookups.size(); batch_start += batch_size)
+        {
+            std::span<const int> batch(lookups.data() + batch_start, std::min(batch_size, lookups.size() - batch_start));
+            if(sorted_batches)
+                tree.search_batch(sorted_equivalent, batch, found);
+            else
+                tree.search_batch(batch, found);
+            benchmark::DoNotOptimize(found.data());
+        }
+    }
+
+    report_ops(state, lookups.size());
+}
+
+template<typename Tree>
+void bm_insert_batch(benchmark::State& state, key_order order, bool sorted_batches)
+{
+    auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const std::size_t batch_size = static_cast<std::size_t>(state.range(1));
+    if(sorted_batches)
+    {
+        for(std::size_t batch_start = 0; batch_start < keys.size(); batch_start += batch_size)
+            std::sort(keys.begin() + batch_start, keys.begin() + std::min(keys.size(), batch_start + batch_size));
+    }
+
+    for(auto _ : state)
+    {
+        Tree tree;
+        for(std::size_t batch_start = 0; batch_start < keys.size(); batch_start += batch_size)
+        {
+            std::span<const int> batch(keys.data() + batch_start, std::min(batch_size, keys.size() - batch_start));
+            if(sorted_batches)
+                tree.insert_batch(sorted_equivalent, batch);
+            else
+                tree.insert_batch(batch);
+        }
+        benchmark::DoNotOptimize(tree.get_root());
+
+        state.PauseTiming();
+        tree.clear();
+        state.ResumeTiming();
+    }
+
+    report_ops(state, keys.size());
+}
+
+/* search on the frozen_bst snapshot of a red-black tree */
+void bm_frozen_search(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto lookups = shuffled(keys);
+    const auto frozen = build_tree<red_black_tree>(keys).freeze();
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+            benchmark::DoNotOptimize(frozen.search(key));
+    }
+
+    report_ops(state, lookups.size());
+}
+
+/* _N distinct even keys in scrambled order, as a lookup table literal would list them */
+template<std::size_t _N>
+constexpr std::array<int, _N> static_table_keys()
+{
+    std::array<int, _N> keys{};
+    for(std::size_t i = 0; i < _N; ++i)
+        keys[i] = static_cast<int>((i * 37) % _N) * 2;
+    return keys;
+}
+
+enum class table_kind { static_bst, frozen_bst, std_binary_search };
+
+/* Lookups in a table of _N keys built at compile time, half of them misses, against the runtime-built alternatives */
+template<std::size_t _N>
+void bm_static_search(benchmark::State& state, table_kind kind)
+{
+    static constexpr std::array<int, _N> keys = static_table_keys<_N>();
+    static constexpr static_bst<int, _N> table(keys);
+
+    std::vector<int> sorted_keys(keys.begin(), keys.end());
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    const frozen_bst<int> frozen(sorted_keys.begin(), sorted_keys.end());
+
+    std::mt19937_64 gen(11);
+    std::uniform_int_distribution<int> lookup_key(0, static_cast<int>(2 * _N - 1));
+    std::vector<int> lookups(4096);
+    for(int& lookup : lookups)
+        lookup = lookup_key(gen);
+
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+        {
+            if(kind == table_kind::static_bst)
+                benchmark::DoNotOptimize(table.search(key));
+            else if(kind == table_kind::frozen_bst)
+                benchmark::DoNotOptimize(frozen.search(key));
+            else
+                benchmark::DoNotOptimize(std::binary_search(sorted_keys.begin(), sorted_keys.end(), key));
+        }
+    }
+
+    report_ops(state, lookups.size());
+}
+
+/* simd_btree with its rank kernels limited to kernel_level */
+void bm_btree_insert(benchmark::State& state, key_order order, simd::level kernel_level)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const simd::level previous_level = simd::current_level();
+    simd::use_level(kernel_level);
+    for(auto _ : state)
+    {
+        simd_btree<int> tree;
+        for(int key : keys)
+            tree.insert(key);
+        benchmark::DoNotOptimize(tree.size());
+
+        state.PauseTiming();
+        tree.clear();
+        state.ResumeTiming();
+    }
+
+    simd::use_level(previous_level);
+    report_ops(state, keys.size());
+}
+
+void bm_btree_search(benchmark::State& state, key_order order, simd::level kernel_level)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto lookups = shuffled(keys);
+    simd_btree<int> tree;
+    for(int key : keys)
+        tree.insert(key);
+
+    const simd::level previous_level = simd::current_level();
+    simd::use_level(kernel_level);
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+            benchmark::DoNotOptimize(tree.search(key));
+    }
+
+    simd::use_level(previous_level);
+    report_ops(state, lookups.size());
+}
+
+enum class sort_kind
+{
+    std_sort,
+    bst_sort,
+    bst_sort_parallel,
+    bst_sort_external
+};
+
+/* Sorts a fresh copy of the keys per iteration; the external sort gets memory for about a quarter of them per run */
+void bm_sort(benchmark::State& state, key_order order, sort_kind kind)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    std::vector<int> sorted(keys.size());
+    for(auto _ : state)
+    {
+        switch(kind)
+        {
+            case sort_kind::std_sort:
+                std::copy(keys.begin(), keys.end(), sorted.begin());
+                std::sort(sorted.begin(), sorted.end());
+                break;
+            case sort_kind::bst_sort:
+                bst_sort_copy(keys.begin(), keys.end(), sorted.begin());
+                break;
+            case sort_kind::bst_sort_parallel:
+                bst_sort_copy(task_pool::shared(), keys.begin(), keys.end(), sorted.begin());
+                break;
+            case sort_kind::bst_sort_external:
+                bst_sort_external(keys.begin(), keys.end(), sorted.begin(), keys.size() * 3 * sizeof(int) / 4);
+                break;
+        }
+        benchmark::DoNotOptimize(sorted.data());
+    }
+
+    report_ops(state, keys.size());
+}
+
+enum class startup_kind
+{
+    insert,
+    load,
+    mapped,
+    mapped_header_only
+};
+
+/* Time to get a searchable tree back on restart: re-inserting the keys, load() of a snapshot, or a mapped_bst over it */
+void bm_startup(benchmark::State& state, startup_kind kind)
+{
+    const auto keys = make_keys(key_order::random, static_cast<std::size_t>(state.range(0)));
+    const auto snapshot_path = std::filesystem::temp_directory_path() / "bst_bench_snapshot.bin";
+    build_tree<red_black_tree>(keys).save(snapshot_path);
+    for(auto _ : state)
+    {
+        switch(kind)
+        {
+            case startup_kind::insert:
+                benchmark::DoNotOptimize(build_tree<red_black_tree>(keys).get_root());
+                break;
+            case startup_kind::load:
+            {
+                red_black_tree tree;
+                tree.load(snapshot_path);
+                benchmark::DoNotOptimize(tree.get_root());
+                break;
+            }
+            case startup_kind::mapped:
+                benchmark::DoNotOptimize(mapped_bst<int>(snapshot_path).minimum());
+                break;
+            case startup_kind::mapped_header_only:
+                benchmark::DoNotOptimize(mapped_bst<int>(snapshot_path, snapshot_check::header_only).minimum());
+                break;
+        }
+    }
+
+    std::filesystem::remove(snapshot_path);
+    report_ops(state, keys.size());
+}
+
+enum class set_operation_kind
+{
+    insert_loop,
+    merge,
+    union_with,
+    parallel_union_with,
+    intersect,
+    difference
+};
+
+/*
+ * Combines a tree of state.range(0) keys with one of state.range(1) keys spread over the same range, half
+ * of them present in the first. insert_loop is the merge done by inserting the second tree's keys one by
+ * one. Both trees are rebuilt outside the timing for every iteration.
+ */
+void bm_set_operation(benchmark::State& state, set_operation_kind kind)
+{
+    const std::size_t key_count = static_cast<std::size_t>(state.range(0));
+    const std::size_t other_count = static_cast<std::size_t>(state.range(1));
+    std::vector<int> keys = make_keys(key_order::random, key_count);
+    for(int& key : keys)
+        key *= 2;
+
+    std::vector<int> other_keys = make_keys(key_order::random, other_count, 1.0, 43);
+    for(int& key : other_keys)
+        key = 2 * key * static_cast<int>(key_count / other_count) + (key & 1);
+
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        red_black_tree tree = build_tree<red_black_tree>(keys);
+        red_black_tree other = build_tree<red_black_tree>(other_keys);
+        state.ResumeTiming();
+
+        switch(kind)
+        {
+            case set_operation_kind::insert_loop:
+                for(int key : other)
+                    tree.insert(key);
+                break;
+            case set_operation_kind::merge:
+                tree.merge(other);
+                break;
+            case set_operation_kind::union_with:
+                tree.union_with(other);
+                break;
+            case set_operation_kind::parallel_union_with:
+                tree.parallel_union_with(other);
+                break;
+            case set_operation_kind::intersect:
+                tree.intersect(other);
+                break;
+            case set_operation_kind::difference:
+                tree.difference(other);
+                break;
+        }
+        benchmark::DoNotOptimize(tree.get_root());
+
+        state.PauseTiming();
+        tree.clear();
+        other.clear();
+        state.ResumeTiming();
+    }
+
+    report_ops(state, other_count);
+}
+
+template<typename Tree>
+void bm_delete_node(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto victims = shuffled(keys);
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Tree victim_tree = tree;
+        state.ResumeTiming();
+
+        for(int key : victims)
+            victim_tree.delete_node(key);
+        benchmark::DoNotOptimize(victim_tree.get_root());
+    }
+
+    report_ops(state, victims.size());
+}
+
+template<typename Tree>
+void bm_delete_all_node(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    auto distinct_keys = keys;
+    std::sort(distinct_keys.begin(), distinct_keys.end());
+    distinct_keys.erase(std::unique(distinct_keys.begin(), distinct_keys.end()), distinct_keys.end());
+    distinct_keys = shuffled(distinct_keys);
+
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Tree victim_tree = tree;
+        state.ResumeTiming();
+
+        for(int key : distinct_keys)
+            victim_tree.delete_all_node(key);
+        benchmark::DoNotOptimize(victim_tree.get_root());
+    }
+
+    report_ops(state, distinct_keys.size());
+}
+
+/*
+ * Inserts a Zipfian stream of state.range(0) keys with exponent state.range(1) / 100, whose hot keys
+ * repeat, then removes every distinct key with erase(key). Under chain each repeat is a node of its own;
+ * under count it bumps the counter of the key's node, and under reject it is dropped.
+ */
+template<typename Tree>
+void bm_duplicates(benchmark::State& state)
+{
+    const auto keys = make_keys(key_order::zipfian, static_cast<std::size_t>(state.range(0)), static_cast<double>(state.range(1)) / 100.0);
+    auto distinct_keys = keys;
+    std::sort(distinct_keys.begin(), distinct_keys.end());
+    distinct_keys.erase(std::unique(distinct_keys.begin(), distinct_keys.end()), distinct_keys.end());
+    distinct_keys = shuffled(distinct_keys);
+
+    std::size_t bytes_per_tree = 0;
+    for(auto _ : state)
+    {
+        std::size_t bytes_before = allocated_bytes;
+        Tree tree;
+        for(int key : keys)
+            tree.insert(key);
+        bytes_per_tree = allocated_bytes - bytes_before;
+
+        for(int key : distinct_keys)
+            benchmark::DoNotOptimize(tree.erase(key));
+    }
+
+    report_ops(state, keys.size() + distinct_keys.size());
+    state.counters["bytes/key"] = static_cast<double>(bytes_per_tree) / static_cast<double>(keys.size());
+}
+
+/*
+ * Looks up a Zipfian stream of state.range(0) keys with exponent state.range(1) / 100 in a tree of the
+ * keys 0 .. n - 1 inserted in random order. Ranks are mapped through a shuffle of the keys, so the hot
+ * keys are spread over the tree rather than packed at its left edge. The tree is searched through a
+ * non-const reference, which lets the splay policies move the keys they find up.
+ */
+template<typename Tree>
+void bm_skewed_search(benchmark::State& state)
+{
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    std::vector<int> keys(count);
+    std::iota(keys.begin(), keys.end(), 0);
+    keys = shuffled(keys);
+
+    auto lookups = make_keys(key_order::zipfian, count, static_cast<double>(state.range(1)) / 100.0, 43);
+    for(int& lookup : lookups)
+        lookup = keys[static_cast<std::size_t>(lookup)];
+
+    Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+            benchmark::DoNotOptimize(tree.search(key));
+    }
+
+    report_ops(state, lookups.size());
+}
+
+template<typename Tree>
+void bm_shape_report(benchmark::State& state, key_order order)
+{
+    const Tree tree = build_tree<Tree>(make_keys(order, static_cast<std::size_t>(state.range(0))));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(tree.shape_report());
+
+    report_ops(state, static_cast<std::size_t>(state.range(0)));
+}
+
+template<typename Tree>
+void bm_count(benchmark::State& state, key_order order)
+{
+    const Tree tree = build_tree<Tree>(make_keys(order, static_cast<std::size_t>(state.range(0))));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(tree.count());
+
+    report_ops(state, 1);
+}
+
+template<typename Tree>
+void bm_count_key(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto lookups = shuffled(keys);
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+            benchmark::DoNotOptimize(tree.count(key));
+    }
+
+    report_ops(state, lookups.size());
+}
+
+/* Time-window queries: visit_range over 100 consecutive key values starting at each lookup key */
+template<typename Tree>
+void bm_visit_range(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const auto lookups = shuffled(keys);
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        for(int key : lookups)
+        {
+            long long sum = 0;
+            tree.visit_range(key, key + 99, [&sum](int visited) { sum += visited; });
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+
+    report_ops(state, lookups.size());
+}
+
+template<typename Tree>
+void bm_successor_walk(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        for(auto current_node = tree.minimum(); current_node != nullptr; current_node = tree.successor(current_node))
+            benchmark::DoNotOptimize(current_node);
+    }
+
+    report_ops(state, keys.size());
+}
+
+template<typename Tree>
+void bm_copy(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        auto copied_tree = std::make_unique<Tree>(tree);
+        benchmark::DoNotOptimize(copied_tree->get_root());
+
+        state.PauseTiming();
+        copied_tree.reset();
+        state.ResumeTiming();
+    }
+
+    report_ops(state, keys.size());
+}
+
+template<typename Tree>
+void bm_clear(benchmark::State& state, key_order order)
+{
+    const auto keys = make_keys(order, static_cast<std::size_t>(state.range(0)));
+    const Tree tree = build_tree<Tree>(keys);
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Tree cleared_tree = tree;
+        state.ResumeTiming();
+
+        cleared_tree.clear();
+        benchmark::DoNotOptimize(cleared_tree.get_root());
+    }
+
+    report_ops(state, keys.size());
+}
+
+/*
+ * Registers every operation for one tree type over all key streams and sizes from 1K up to
+ * BST_BENCH_MAX_KEYS. The unbalanced tree degenerates into a list on sorted and skewed streams,
+ * where every operation is O(n), so it is capped at small sizes there.
+ */
+template<typename Tree>
+void register_tree(const std::string& tree_name, bool degenerates)
+{
+    using bench_function = void (*)(benchmark::State&, key_order);
+    const std::pair<const char*, bench_function> operations[] = {
+        {"insert", bm_insert<Tree>},
+        {"search", bm_search<Tree>},
+        {"delete_node", bm_delete_node<Tree>},
+        {"delete_all_node", bm_delete_all_node<Tree>},
+        {"count", bm_count<Tree>},
+        {"count_key", bm_count_key<Tree>},
+        {"visit_range", bm_visit_range<Tree>},
+        {"successor_walk", bm_successor_walk<Tree>},
+        {"copy", bm_copy<Tree>},
+        {"clear", bm_clear<Tree>},
+    };
+
+    for(auto order : {key_order::sorted, key_order::reverse_sorted, key_order::random, key_order::zipfian})
+    {
+        std::int64_t max_keys = BST_BENCH_MAX_KEYS;
+        if(degenerates && order != key_order::random)
+            max_keys = std::min<std::int64_t>(max_keys, (order == key_order::zipfian) ? 100000 : 10000);
+
+        for(const auto& [operation_name, function] : operations)
+        {
+            auto* bench = benchmark::RegisterBenchmark((std::string(operation_name) + "/" + tree_name + "/" + key_order_name(order)).c_str(),
+                                                       function, order);
+            for(std::int64_t keys = 1000; keys <= max_keys; keys *= 10)
+                bench->Arg(keys);
+        }
+    }
+}
+
+void register_frozen()
+{
+    for(auto order : {key_order::sorted, key_order::reverse_sorted, key_order::random, key_order::zipfian})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("search/frozen/") + key_order_name(order)).c_str(), bm_frozen_search, order);
+        for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+            bench->Arg(keys);
+    }
+}
+
+void register_static()
+{
+    using bench_function = void (*)(benchmark::State&, table_kind);
+    for(auto [size_name, function] : {std::pair<const char*, bench_function>{"16", bm_static_search<16>},
+                                      std::pair<const char*, bench_function>{"64", bm_static_search<64>},
+                                      std::pair<const char*, bench_function>{"256", bm_static_search<256>},
+                                      std::pair<const char*, bench_function>{"1024", bm_static_search<1024>}})
+    {
+        for(auto [kind_name, kind] : {std::pair{"static_bst", table_kind::static_bst}, std::pair{"frozen_bst", table_kind::frozen_bst},
+                                      std::pair{"std_binary_search", table_kind::std_binary_search}})
+            benchmark::RegisterBenchmark((std::string("static_search/") + kind_name + "/keys:" + size_name).c_str(), function, kind);
+    }
+}
+
+void register_sort()
+{
+    for(auto [kind_name, kind] : {std::pair{"std_sort", sort_kind::std_sort}, std::pair{"bst_sort", sort_kind::bst_sort},
+                                  std::pair{"bst_sort_parallel", sort_kind::bst_sort_parallel}, std::pair{"bst_sort_external", sort_kind::bst_sort_external}})
+    {
+        for(auto order : {key_order::sorted, key_order::reverse_sorted, key_order::random, key_order::zipfian})
+        {
+            auto* bench = benchmark::RegisterBenchmark((std::string("sort/") + kind_name + "/" + key_order_name(order)).c_str(), bm_sort, order, kind);
+            for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+                bench->Arg(keys);
+        }
+    }
+}
+
+void register_startup()
+{
+    for(auto [kind_name, kind] : {std::pair{"insert", startup_kind::insert}, std::pair{"load", startup_kind::load},
+                                  std::pair{"mapped", startup_kind::mapped}, std::pair{"mapped_header_only", startup_kind::mapped_header_only}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("startup/") + kind_name).c_str(), bm_startup, kind);
+        for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+            bench->Arg(keys);
+    }
+}
+
+void register_set_operations()
+{
+    for(auto [kind_name, kind] : {std::pair{"insert_loop", set_operation_kind::insert_loop}, std::pair{"merge", set_operation_kind::merge},
+                                  std::pair{"union_with", set_operation_kind::union_with}, std::pair{"parallel_union_with", set_operation_kind::parallel_union_with},
+                                  std::pair{"intersect", set_operation_kind::intersect}, std::pair{"difference", set_operation_kind::difference}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("setops/") + kind_name).c_str(), bm_set_operation, kind)->ArgNames({"keys", "other"});
+        for(std::int64_t keys = 100000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+        {
+            for(std::int64_t other = keys / 1000; other <= keys; other *= 10)
+                bench->Args({keys, other});
+        }
+    }
+}
+
+/* What instrumented costs on the hot paths, next to insert/red_black and search/red_black, and the price of a shape_report() */
+enum class export_kind { copy_to_inorder, copy_to_level_order, iterators };
+
+/* Copies every key of a red-black tree of random keys into a preallocated buffer */
+void bm_export(benchmark::State& state, export_kind kind)
+{
+    const auto tree = build_tree<red_black_tree>(make_keys(key_order::random, static_cast<std::size_t>(state.range(0))));
+    std::vector<int> exported(tree.size());
+    for(auto _ : state)
+    {
+        if(kind == export_kind::copy_to_inorder)
+            tree.copy_to(exported.data());
+        else if(kind == export_kind::copy_to_level_order)
+            tree.copy_to(exported.data(), traversal_order::level_order);
+        else
+            std::copy(tree.begin(), tree.end(), exported.data());
+        benchmark::DoNotOptimize(exported.data());
+    }
+
+    report_ops(state, tree.size());
+}
+
+void register_export()
+{
+    for(auto [kind_name, kind] : {std::pair{"copy_to_inorder", export_kind::copy_to_inorder}, std::pair{"copy_to_level_order", export_kind::copy_to_level_order},
+                                  std::pair{"iterators", export_kind::iterators}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("export/") + kind_name).c_str(), bm_export, kind);
+        for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+            bench->Arg(keys);
+    }
+}
+
+void register_instrumentation()
+{
+    using bench_function = void (*)(benchmark::State&, key_order);
+    for(auto [operation_name, function] : {std::pair<const char*, bench_function>{"insert/red_black_instrumented", bm_insert<instrumented_red_black_tree>},
+                                           std::pair<const char*, bench_function>{"search/red_black_instrumented", bm_search<instrumented_red_black_tree>},
+                                           std::pair<const char*, bench_function>{"shape_report/red_black", bm_shape_report<red_black_tree>}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string(operation_name) + "/" + key_order_name(key_order::random)).c_str(), function, key_order::random);
+        for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+            bench->Arg(keys);
+    }
+}
+
+void register_duplicates()
+{
+    using bench_function = void (*)(benchmark::State&);
+    for(auto [mode_name, function] : {std::pair<const char*, bench_function>{"chain", bm_duplicates<red_black_tree>},
+                                      std::pair<const char*, bench_function>{"count", bm_duplicates<counted_red_black_tree>},
+                                      std::pair<const char*, bench_function>{"reject", bm_duplicates<unique_red_black_tree>}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("duplicates/") + mode_name).c_str(), function)->ArgNames({"keys", "zipf_x100"});
+        for(std::int64_t keys = 10000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+        {
+            for(std::int64_t exponent : {80, 100, 120})
+                bench->Args({keys, exponent});
+        }
+    }
+}
+
+void register_skewed_search()
+{
+    using bench_function = void (*)(benchmark::State&);
+    for(auto [tree_name, function] : {std::pair<const char*, bench_function>{"unbalanced", bm_skewed_search<plain_tree>},
+                                      std::pair<const char*, bench_function>{"red_black", bm_skewed_search<red_black_tree>},
+                                      std::pair<const char*, bench_function>{"splay", bm_skewed_search<splay_tree>},
+                                      std::pair<const char*, bench_function>{"semi_splay", bm_skewed_search<semi_splay_tree>},
+                                      std::pair<const char*, bench_function>{"semi_splay_sampled", bm_skewed_search<sampled_semi_splay_tree>}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("skewed_search/") + tree_name).c_str(), function)->ArgNames({"keys", "zipf_x100"});
+        for(std::int64_t keys = 10000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+        {
+            for(std::int64_t exponent : {80, 100, 120})
+                bench->Args({keys, exponent});
+        }
+    }
+}
+
+/* Batch operations on random keys, to compare with search and insert one key at a time */
+template<typename Tree>
+void register_batches(const std::string& tree_name)
+{
+    using bench_function = void (*)(benchmark::State&, key_order, bool);
+    const std::pair<const char*, bench_function> operations[] = {
+        {"search_batch", bm_search_batch<Tree>},
+        {"insert_batch", bm_insert_batch<Tree>},
+    };
+
+    for(const auto& [operation_name, function] : operations)
+    {
+        for(bool sorted_batches : {false, true})
+        {
+            auto* bench = benchmark::RegisterBenchmark(
+                (std::string(operation_name) + (sorted_batches ? "_sorted/" : "/") + tree_name + "/random").c_str(), function, key_order::random, sorted_batches);
+            bench->ArgNames({"keys", "batch"});
+            for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+                for(std::int64_t batch_size : {64, 256, 1024})
+                    bench->Args({keys, batch_size});
+        }
+    }
+}
+
+void register_btree()
+{
+    using bench_function = void (*)(benchmark::State&, key_order, simd::level);
+    const std::pair<const char*, bench_function> operations[] = {
+        {"insert", bm_btree_insert},
+        {"search", bm_btree_search},
+    };
+    const std::pair<const char*, simd::level> kernel_levels[] = {
+        {"avx2", simd::level::avx2},
+        {"sse2", simd::level::sse2},
+        {"scalar", simd::level::scalar},
+    };
+
+    for(auto order : {key_order::sorted, key_order::random, key_order::zipfian})
+    {
+        for(const auto& [operation_name, function] : operations)
+        {
+            for(const auto& [level_name, kernel_level] : kernel_levels)
+            {
+                if(kernel_level > simd::supported_level())
+                    continue;
+
+                auto* bench = benchmark::RegisterBenchmark(
+                    (std::string(operation_name) + "/btree_" + level_name + "/" + key_order_name(order)).c_str(), function, order, kernel_level);
+                for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+                    bench->Arg(keys);
+            }
+        }
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    register_tree<plain_tree>("unbalanced", true);
+    register_tree<red_black_tree>("red_black", false);
+    register_tree<avl_tree>("avl", false);
+    register_tree<arena_red_black_tree>("red_black_arena", false);
+    register_batches<red_black_tree>("red_black");
+    register_batches<avl_tree>("avl");
+    register_frozen();
+    register_static();
+    register_btree();
+    register_sort();
+    register_startup();
+    register_set_operations();
+    register_duplicates();
+    register_skewed_search();
+    register_instrumentation();
+    register_export();
+    register_concurrent_benchmarks();
+    register_parallel_benchmarks();
+
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "bst.hpp"
+#include "bst_concurrent.hpp"
+#include "bst_persistent.hpp"
+#include "key_streams.hpp"
+
+#ifndef BST_BENCH_MAX_KEYS
+#define BST_BENCH_MAX_KEYS 1000000
+#endif
+
+namespace
+{
+using namespace BST;
+using namespace BST::bench;
+
+constexpr int key_count = 100000;
+
+/* The status quo: a red-black tree behind one global mutex */
+class locked_tree
+{
+ private:
+    binary_search_tree<int, red_black_policy> tree;
+    mutable std::mutex tree_mutex;
+
+ public:
+    bool contains(int key) const
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        return tree.search(key) != nullptr;
+    }
+
+    void insert(int key)
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        if(tree.search(key) == nullptr)
+            tree.insert(key);
+    }
+
+    void delete_node(int key)
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        tree.delete_node(key);
+    }
+};
+
+/*
+ * Every thread looks up random keys in a shared tree holding every other key of [0, 2 * key_count),
+ * and one lookup in write_period is replaced by an insert or a delete_node of a random key.
+ * write_period 0 means a read-only run.
+ */
+template<typename Tree>
+void bm_concurrent_mixed(benchmark::State& state, int write_period)
+{
+    static std::unique_ptr<Tree> shared_tree;
+    if(state.thread_index() == 0)
+    {
+        shared_tree = std::make_unique<Tree>();
+        for(int key : make_keys(key_order::random, key_count))
+            shared_tree->insert(2 * key);
+    }
+
+    std::mt19937 gen(static_cast<unsigned>(state.thread_index()) + 1);
+    std::uniform_int_distribution<int> key_distribution(0, 2 * key_count - 1);
+    std::size_t ops = 0;
+    for(auto _ : state)
+    {
+        Tree& tree = *shared_tree;
+        for(int i = 0; i < 64; ++i, ++ops)
+        {
+            int key = key_distribution(gen);
+            if(write_period != 0 && ops % static_cast<std::size_t>(write_period) == 0)
+            {
+                if(key & 1)
+                    tree.insert(key);
+                else
+                    tree.delete_node(key + 1);
+            }
+            else
+                benchmark::DoNotOptimize(tree.contains(key));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(ops));
+    if(state.thread_index() == 0)
+        state.counters["threads"] = static_cast<double>(state.threads());
+}
+
+/* A point-in-time view of a tree of state.range(0) keys, the way a report takes one: a copy of a red-black tree */
+void bm_snapshot_copy(benchmark::State& state)
+{
+    binary_search_tree<int, red_black_policy> tree;
+    for(int key : make_keys(key_order::random, static_cast<std::size_t>(state.range(0))))
+        tree.insert(key);
+
+    for(auto _ : state)
+    {
+        binary_search_tree<int, red_black_policy> view = tree;
+        benchmark::DoNotOptimize(view.get_root());
+    }
+}
+
+/* Same with versioned_bst::snapshot(), which shares the nodes instead */
+void bm_snapshot_versioned(benchmark::State& state)
+{
+    versioned_bst<int> tree;
+    for(int key : make_keys(key_order::random, static_cast<std::size_t>(state.range(0))))
+        tree.insert(key);
+
+    for(auto _ : state)
+    {
+        persistent_bst<int> view = tree.snapshot();
+        benchmark::DoNotOptimize(view.size());
+    }
+}
+
+int max_threads()
+{
+    return static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+}
+
+void register_concurrent(const char* tree_name, void (*function)(benchmark::State&, int))
+{
+    for(auto [workload, write_period] : {std::pair{"read_only", 0}, std::pair{"write_1pct", 100}, std::pair{"write_10pct", 10}})
+    {
+        benchmark::RegisterBenchmark((std::string("concurrent/") + tree_name + "/" + workload).c_str(), function, write_period)
+            ->ThreadRange(1, max_threads())
+            ->UseRealTime();
+    }
+}
+}
+
+/* Called from main in bst_bench.cpp */
+void register_concurrent_benchmarks()
+{
+    register_concurrent("mutex_red_black", bm_concurrent_mixed<locked_tree>);
+    register_concurrent("concurrent_bst", bm_concurrent_mixed<concurrent_bst<int>>);
+    register_concurrent("versioned_bst", bm_concurrent_mixed<versioned_bst<int>>);
+
+    using bench_function = void (*)(benchmark::State&);
+    for(auto [kind_name, function] : {std::pair<const char*, bench_function>{"copy", bm_snapshot_copy},
+                                      std::pair<const char*, bench_function>{"versioned", bm_snapshot_versioned}})
+    {
+        auto* bench = benchmark::RegisterBenchmark((std::string("snapshot/") + kind_name).c_str(), function);
+        for(std::int64_t keys = 1000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+            bench->Arg(keys);
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef BST_BENCH_KEY_STREAMS_HPP_INCLUDED
+#define BST_BENCH_KEY_STREAMS_HPP_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace BST::bench
+{
+enum class key_order
+{
+    sorted,
+    reverse_sorted,
+    random,
+    zipfian
+};
+
+inline const char* key_order_name(key_order order)
+{
+    switch(order)
+    {
+        case key_order::sorted:         return "sorted";
+        case key_order::reverse_sorted: return "reverse";
+        case key_order::random:         return "random";
+        case key_order::zipfian:        return "zipf";
+    }
+    return "?";
+}
+
+/*
+ * Zipf(exponent) over the ranks 1..element_count, sampled in O(1) by rejection-inversion
+ * (Hoermann & Derflinger, "Rejection-inversion to generate variates from monotone discrete distributions").
+ */
+class zipf_distribution
+{
+ private:
+    double exponent;
+    std::uint64_t element_count;
+    double h_integral_x1;
+    double h_integral_n;
+    double squeeze;
+
+    /* log1p(x) / x and expm1(x) / x, accurate near 0 */
+    static double helper1(double x) { return (std::abs(x) > 1e-8) ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x)); }
+    static double helper2(double x) { return (std::abs(x) > 1e-8) ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x)); }
+
+    double h(double x) const { return std::exp(-exponent * std::log(x)); }
+
+    double h_integral(double x) const
+    {
+        double log_x = std::log(x);
+        return helper2((1 - exponent) * log_x) * log_x;
+    }
+
+    double h_integral_inverse(double x) const
+    {
+        double t = std::max(x * (1 - exponent), -1.0);
+        return std::exp(helper1(t) * x);
+    }
+
+ public:
+    zipf_distribution(std::uint64_t element_count, double exponent)
+        : exponent(exponent), element_count(element_count),
+          h_integral_x1(h_integral(1.5) - 1), h_integral_n(h_integral(element_count + 0.5)),
+          squeeze(2 - h_integral_inverse(h_integral(2.5) - h(2))) {}
+
+    template<typename Generator> std::uint64_t operator()(Generator& gen)
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        while(true)
+        {
+            double u = h_integral_n + uniform(gen) * (h_integral_x1 - h_integral_n);
+            double x = h_integral_inverse(u);
+            std::uint64_t k = static_cast<std::uint64_t>(std::clamp(x + 0.5, 1.0, static_cast<double>(element_count)));
+            if(k - x <= squeeze || u >= h_integral(k + 0.5) - h(static_cast<double>(k)))
+                return k;
+        }
+    }
+};
+
+/* count keys in the given order. Zipfian streams draw ranks from [0, count) and so repeat hot keys. */
+inline std::vector<int> make_keys(key_order order, std::size_t count, double zipf_exponent = 1.0, std::uint64_t seed = 42)
+{
+    std::vector<int> keys(count);
+    std::mt19937_64 gen(seed);
+
+    switch(order)
+    {
+        case key_order::sorted:
+            std::iota(keys.begin(), keys.end(), 0);
+            break;
+        case key_order::reverse_sorted:
+            std::iota(keys.rbegin(), keys.rend(), 0);
+            break;
+        case key_order::random:
+            std::iota(keys.begin(), keys.end(), 0);
+            std::shuffle(keys.begin(), keys.end(), gen);
+            break;
+        case key_order::zipfian:
+        {
+            zipf_distribution zipf(count, zipf_exponent);
+            for(auto& key : keys)
+                key = static_cast<int>(zipf(gen) - 1);
+            break;
+        }
+    }
+
+    return keys;
+}
+}
+
+#endif // BST_BENCH_KEY_STREAMS_HPP_INCLUDED
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bst.hpp"
+#include "key_streams.hpp"
+
+#ifndef BST_BENCH_MAX_KEYS
+#define BST_BENCH_MAX_KEYS 1000000
+#endif
+
+namespace
+{
+using namespace BST;
+using namespace BST::bench;
+
+using tree_type = binary_search_tree<int, red_black_policy>;
+
+/* state.range(1) workers, or 0 for the single-threaded member the parallel one replaces */
+std::unique_ptr<task_pool> make_pool(const benchmark::State& state)
+{
+    return (state.range(1) != 0) ? std::make_unique<task_pool>(static_cast<unsigned>(state.range(1))) : nullptr;
+}
+
+void bm_parallel_count_if(benchmark::State& state)
+{
+    tree_type tree;
+    for(int key : make_keys(key_order::random, static_cast<std::size_t>(state.range(0))))
+        tree.insert(key);
+
+    std::unique_ptr<task_pool> pool = make_pool(state);
+    auto is_even = [](int key) { return key % 2 == 0; };
+    for(auto _ : state)
+        benchmark::DoNotOptimize(pool ? tree.parallel_count_if(is_even, *pool) : tree.count_if(is_even));
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void bm_parallel_reduce(benchmark::State& state)
+{
+    tree_type tree;
+    for(int key : make_keys(key_order::random, static_cast<std::size_t>(state.range(0))))
+        tree.insert(key);
+
+    std::unique_ptr<task_pool> pool = make_pool(state);
+    for(auto _ : state)
+    {
+        std::int64_t sum = 0;
+        if(pool)
+            sum = tree.parallel_reduce(std::int64_t(0), std::plus<std::int64_t>(), *pool);
+        else
+            for(int key : tree)
+                sum += key;
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void bm_parallel_clear(benchmark::State& state)
+{
+    std::vector<int> keys = make_keys(key_order::random, static_cast<std::size_t>(state.range(0)));
+    std::unique_ptr<task_pool> pool = make_pool(state);
+    tree_type tree;
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        for(int key : keys)
+            tree.insert(key);
+        state.ResumeTiming();
+
+        if(pool)
+            tree.parallel_clear(*pool);
+        else
+            tree.clear();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+}
+
+/* Called from main in bst_bench.cpp */
+void register_parallel_benchmarks()
+{
+    std::int64_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+    using bench_function = void (*)(benchmark::State&);
+    for(auto [name, function] : {std::pair<const char*, bench_function>{"count_if", bm_parallel_count_if},
+                                 std::pair<const char*, bench_function>{"reduce", bm_parallel_reduce},
+                                 std::pair<const char*, bench_function>{"clear", bm_parallel_clear}})
+    {
+        auto* benchmark = benchmark::RegisterBenchmark((std::string("parallel/") + name).c_str(), function)->ArgNames({"keys", "threads"})->UseRealTime();
+        for(std::int64_t keys = 100000; keys <= BST_BENCH_MAX_KEYS; keys *= 10)
+        {
+            benchmark->Args({keys, 0});
+            for(std::int64_t threads = 1; threads <= max_threads; threads *= 2)
+                benchmark->Args({keys, threads});
+        }
+    }
+}
@@ -1,673 +1,4639 @@
-#ifndef BINARY_SEARCH_TREE_HPP_INCLUDED
-#define BINARY_SEARCH_TREE_HPP_INCLUDED
-
-#include <iostream>
-
-namespace BST
-{
-template<typename _Tp>
-class binary_search_tree
-{
- public:
-    class node;
-    using value_type = _Tp;
-    using node_pointer = node*;
-
-    class node
-    {
-     private:
-        value_type* key;
-        node_pointer left;
-        node_pointer right;
-        node_pointer parent;
-
-     public:
-        constexpr node() : key(nullptr), left(nullptr), right(nullptr), parent(nullptr) {}
-
-        explicit constexpr node(value_type key) : node() { this->key = new value_type(key); }
-
-        virtual ~node() { this->clear(); }
-
-        constexpr node(const node& n) : key(nullptr), left(n.left), right(n.right), parent(n.parent)
-            { if(n.key != nullptr) key = new value_type(*n.key); }
-
-        constexpr node(node&& n) noexcept : key(n.key), left(n.left), right(n.right), parent(n.parent)
-            { n.key = nullptr; n.left = nullptr; n.right = nullptr; n.parent = nullptr; }
-
-        constexpr node& operator=(const node& n)
-        {
-            if(this == &n)
-                return *this;
-
-            clear();
-
-            key = (n.key != nullptr) ? new value_type(*n.key) : nullptr;
-            left = n.left;
-            right = n.right;
-            parent = n.parent;
-            return *this;
-        }
-
-        constexpr node& operator=(node&& n) noexcept
-        {
-            clear();
-
-            key = n.key;
-            left = n.left;
-            right = n.right;
-            parent = n.parent;
-
-            n.key = nullptr;
-            n.left = nullptr;
-            n.right = nullptr;
-            n.parent = nullptr;
-            return *this;
-        }
-
-        constexpr void clear()
-        {
-            if(key != nullptr)
-            {
-                delete key;
-                key = nullptr;
-            }
-
-            if(left != nullptr)
-                left->parent = nullptr;
-
-            if(right != nullptr)
-                right->parent = nullptr;
-
-            if(parent != nullptr)
-            {
-                if(parent->left == this)
-                    parent->left = nullptr;
-                else
-                    parent->right = nullptr;
-            }
-        }
-
-        constexpr void create_left(value_type key)
-        {
-            if(left != nullptr)
-                return;
-
-            left = new node(key);
-            left->parent = this;
-        }
-
-        constexpr void create_right(value_type key)
-        {
-            if(right != nullptr)
-                return;
-
-            right = new node(key);
-            right->parent = this;
-        }
-
-        constexpr void create_parent_left(value_type key)
-        {
-            if(parent != nullptr)
-                return;
-
-            parent = new node(key);
-            parent->left = this;
-        }
-
-        constexpr void create_parent_right(value_type key)
-        {
-            if(parent != nullptr)
-                return;
-
-            parent = new node(key);
-            parent->right = this;
-        }
-
-        constexpr void set_left(node_pointer new_left)
-        {
-            if(left != nullptr)
-                left->parent = nullptr;
-
-            left = new_left;
-
-            if(new_left != nullptr)
-                new_left->parent = this;
-        }
-
-        constexpr node_pointer get_left() const
-        {
-            return left;
-        }
-
-        constexpr void set_right(node_pointer new_right)
-        {
-            if(right != nullptr)
-                right->parent = nullptr;
-
-            right = new_right;
-
-            if(new_right != nullptr)
-                new_right->parent = this;
-        }
-
-        constexpr node_pointer get_right() const
-        {
-            return right;
-        }
-
-        constexpr void set_parent_left(node_pointer new_parent)
-        {
-            if(parent != nullptr)
-                (parent->get_left() == this) ? parent->set_left(nullptr) : parent->set_right(nullptr);
-
-            parent = new_parent;
-
-            if(new_parent != nullptr)
-                new_parent->set_left(this);
-        }
-
-        constexpr void set_parent_right(node_pointer new_parent)
-        {
-            if(parent != nullptr)
-                (parent->get_left() == this) ? parent->set_left(nullptr) : parent->set_right(nullptr);
-
-            parent = new_parent;
-
-            if(new_parent != nullptr)
-                new_parent->set_right(this);
-        }
-
-        constexpr node_pointer get_parent() const
-        {
-            return parent;
-        }
-
-        constexpr void set_key(value_type key)
-        {
-            if(this->key != nullptr)
-                *this->key = key;
-            else
-                this->key = new value_type(key);
-        }
-
-        constexpr value_type get_key() const
-        {
-            return *key;
-        }
-    };
-
-    static constexpr node_pointer make_node(value_type key)
-    {
-        return new node(key);
-    }
-
- protected:
-    node_pointer root;
-
- private:
-    static constexpr void preorder_traversal_inserter(binary_search_tree& dst_tree, node_pointer starting_node)
-    {
-        if(!starting_node)
-            return;
-
-        dst_tree.insert(starting_node->get_key());
-        preorder_traversal_inserter(dst_tree, starting_node->get_left());
-        preorder_traversal_inserter(dst_tree, starting_node->get_right());
-    }
-
-    static constexpr void tree_copy(binary_search_tree& dst_tree, const binary_search_tree& src_tree)
-    {
-        dst_tree.clear();
-        preorder_traversal_inserter(dst_tree, src_tree.get_root());
-    }
-
- public:
-    constexpr binary_search_tree() : root(nullptr) {}
-
-    explicit constexpr binary_search_tree(value_type root_key) : root(make_node(root_key)) {}
-
-    constexpr binary_search_tree(std::initializer_list<value_type> initList) : root(nullptr)
-    {
-        for(auto iter = initList.begin(), iter_end = initList.end(); iter != iter_end; iter++)
-            insert(*iter);
-    }
-
-    virtual ~binary_search_tree()
-    {
-        clear();
-    }
-
-    constexpr binary_search_tree(const binary_search_tree& bst) : root(nullptr) { tree_copy(*this, bst); }
-
-    constexpr binary_search_tree(binary_search_tree&& bst) noexcept : root(root = bst.root) { bst.root = nullptr; }
-
-    constexpr binary_search_tree& operator=(const binary_search_tree& bst)
-    {
-        if(this == &bst)
-            return *this;
-
-        tree_copy(*this, bst);
-        return *this;
-    }
-
-    constexpr binary_search_tree& operator=(binary_search_tree&& bst) noexcept
-    {
-        clear();
-        root = bst.root;
-        bst.root = nullptr;
-        return *this;
-    }
-
-    constexpr void clear()
-    {
-        if(root != nullptr)
-        {
-            delete_tree(root);
-            root = nullptr;
-        }
-    }
-
-    constexpr void set_root(value_type key)
-    {
-        if(root != nullptr)
-            clear();
-
-        root = make_node(key);
-    }
-
-    constexpr node_pointer get_root() const
-    {
-        return root;
-    }
-
-    constexpr unsigned count(node_pointer starting_node, value_type key) const
-    {
-        return (!starting_node) ? 0 :
-               (starting_node->get_key() == key) ? 1 + count(starting_node->get_left(), key) + count(starting_node->get_right(), key) :
-                                                   0 + count(starting_node->get_left(), key) + count(starting_node->get_right(), key);
-    }
-
-    constexpr unsigned count(value_type key) const
-    {
-        return count(root, key);
-    }
-
-    constexpr unsigned count(node_pointer starting_node) const
-    {
-        return (!starting_node) ? 0 : 1 + count(starting_node->get_left()) + count(starting_node->get_right());
-    }
-
-    constexpr unsigned count() const
-    {
-        return count(root);
-    }
-
-    template<typename Predicate> constexpr unsigned count_if(node_pointer starting_node, Predicate pred) const
-    {
-        return (!starting_node) ? 0 :
-               (pred(std::forward<value_type>(starting_node->get_key()))) ?
-                                                    1 + count_if(starting_node->get_left(), pred) + count_if(starting_node->get_right(), pred) :
-                                                    0 + count_if(starting_node->get_left(), pred) + count_if(starting_node->get_right(), pred);
-    }
-
-    template<typename Predicate> constexpr unsigned count_if(Predicate pred) const
-    {
-        return count_if(root, pred);
-    }
-
-    constexpr void inorder_traversal(node_pointer pivot_node) const
-    {
-        if(!pivot_node)
-            return;
-
-        inorder_traversal(pivot_node->get_left());
-        std::cout << pivot_node->get_key() << "  ";
-        inorder_traversal(pivot_node->get_right());
-    }
-
-    constexpr void inorder_traversal() const
-    {
-        inorder_traversal(root);
-    }
-
-    constexpr void preorder_traversal(node_pointer pivot_node) const
-    {
-        if(!pivot_node)
-            return;
-
-        std::cout << pivot_node->get_key() << "  ";
-        preorder_traversal(pivot_node->get_left());
-        preorder_traversal(pivot_node->get_right());
-    }
-
-    constexpr void preorder_traversal() const
-    {
-        preorder_traversal(root);
-    }
-
-    constexpr void postorder_traversal(node_pointer pivot_node) const
-    {
-        if(!pivot_node)
-            return;
-
-        postorder_traversal(pivot_node->get_left());
-        postorder_traversal(pivot_node->get_right());
-        std::cout << pivot_node->get_key() << "  ";
-    }
-
-    constexpr void postorder_traversal() const
-    {
-        postorder_traversal(root);
-    }
-
-    constexpr node_pointer search(node_pointer starting_node, value_type key) const
-    {
-        if(!starting_node || key == starting_node->get_key())
-            return starting_node;
-
-        if(key < starting_node->get_key())
-        {
-            return search(starting_node->get_left(), key);
-        }
-        else
-        {
-            return search(starting_node->get_right(), key);
-        }
-    }
-
-    constexpr node_pointer search(value_type key) const
-    {
-        return search(root, key);
-    }
-
-    constexpr node_pointer minimum(node_pointer starting_node) const
-    {
-        if(!starting_node)
-            return nullptr;
-
-        while(starting_node->get_left() != nullptr)
-        {
-            starting_node = starting_node->get_left();
-        }
-
-        return starting_node;
-    }
-
-    constexpr node_pointer minimum() const
-    {
-        return minimum(root);
-    }
-
-    constexpr node_pointer maximum(node_pointer starting_node) const
-    {
-        if(!starting_node)
-            return nullptr;
-
-        while(starting_node->get_right() != nullptr)
-        {
-            starting_node = starting_node->get_right();
-        }
-
-        return starting_node;
-    }
-
-    constexpr node_pointer maximum() const
-    {
-        return maximum(root);
-    }
-
-    constexpr node_pointer successor(node_pointer starting_node) const
-    {
-        if(!starting_node)
-        {
-            return nullptr;
-        }
-        else if(starting_node->get_right() != nullptr)
-        {
-            return minimum(starting_node->get_right());
-        }
-        else
-        {
-            node_pointer temp_node = starting_node->get_parent();
-            while(temp_node != nullptr && starting_node == temp_node->get_right())
-            {
-                starting_node = temp_node;
-                temp_node = temp_node->get_parent();
-            }
-
-            return temp_node;
-        }
-    }
-
-    constexpr node_pointer successor() const
-    {
-        return successor(root);
-    }
-
-    constexpr void insert(node inserted_node)
-    {
-        node_pointer new_node = make_node(inserted_node.get_key());
-        node_pointer pivot_node = nullptr;
-        node_pointer checking_node = root;
-        while(checking_node != nullptr)
-        {
-            pivot_node = checking_node;
-            if(new_node->get_key() < checking_node->get_key())
-            {
-                checking_node = checking_node->get_left();
-            }
-            else
-            {
-                checking_node = checking_node->get_right();
-            }
-        }
-
-        if(!pivot_node) /* Tree was empty */
-        {
-            set_root(new_node);
-        }
-        else if(new_node->get_key() < pivot_node->get_key())
-        {
-            pivot_node->set_left(new_node);
-        }
-        else
-        {
-            pivot_node->set_right(new_node);
-        }
-    }
-
-    constexpr void insert(value_type key)
-    {
-        node_pointer pivot_node = nullptr;
-        node_pointer checking_node = root;
-        while(checking_node != nullptr)
-        {
-            pivot_node = checking_node;
-            if(key < checking_node->get_key())
-            {
-                checking_node = checking_node->get_left();
-            }
-            else
-            {
-                checking_node = checking_node->get_right();
-            }
-        }
-
-        if(!pivot_node) /* Tree was empty */
-        {
-            set_root(key);
-        }
-        else if(key < pivot_node->get_key())
-        {
-            pivot_node->create_left(key);
-        }
-        else
-        {
-            pivot_node->create_right(key);
-        }
-    }
-
-    constexpr node_pointer delete_node(node_pointer starting_node, value_type key)
-    {
-        // Base case
-        if(!starting_node)
-            return starting_node;
-
-        // Recursive calls for ancestors of node to be deleted
-        if(key < starting_node->get_key())
-        {
-            starting_node->set_left(delete_node(starting_node->get_left(), key));
-            return starting_node;
-        }
-        else if(key > starting_node->get_key())
-        {
-            starting_node->set_right(delete_node(starting_node->get_right(), key));
-            return starting_node;
-        }
-
-        // We reach here when starting_node is the node to be deleted
-
-        // If both children are empty
-        if(!starting_node->get_left() && !starting_node->get_right())
-        {
-            // disconnect the current node with its parent
-            node_pointer current_parent = starting_node->get_parent();
-            if(current_parent != nullptr)
-                (starting_node == current_parent->get_left()) ? current_parent->set_left(nullptr) : current_parent->set_right(nullptr);
-
-            // Special case where the node to be deleted is the root, this mean tree only has one node
-            if(starting_node == root)
-                root = current_parent;
-
-            delete starting_node;
-
-            return nullptr;
-        }
-        // If only one of the children is empty
-        else if(!starting_node->get_left())
-        {
-            node_pointer temp = starting_node->get_right();
-
-            // Set new parent for temp
-            node_pointer new_parent = starting_node->get_parent();
-            if(new_parent != nullptr)
-                (starting_node == new_parent->get_left()) ? temp->set_parent_left(new_parent) : temp->set_parent_right(new_parent);
-
-            // Special case where the node to be deleted is the root, reset the root
-            if(starting_node == root)
-                root = temp;
-
-            delete starting_node;
-
-            return temp;
-        }
-        else if(!starting_node->get_right())
-        {
-            node_pointer temp = starting_node->get_left();
-
-            // Set new parent for temp
-            node_pointer new_parent = starting_node->get_parent();
-            if(new_parent != nullptr)
-                (starting_node == new_parent->get_left()) ? temp->set_parent_left(new_parent) : temp->set_parent_right(new_parent);
-
-            // Special case where the node to be deleted is the root, reset the root
-            if(starting_node == root)
-                root = temp;
-
-            delete starting_node;
-
-            return temp;
-        }
-        // If both children exist
-        else
-        {
-            node_pointer succ_parent = starting_node;
-
-            // Find successor
-            node_pointer succ = starting_node->get_right();
-            while(succ->get_left() != nullptr)
-            {
-                succ_parent = succ;
-                succ = succ->get_left();
-            }
-
-            // Delete successor. Since successor is always left child of its parent it is safe to make successor's right child as left of its parent.
-            // If there is no succ, then assign succ->right to succ_parent->right
-            if(succ_parent != starting_node)
-            {
-                succ_parent->set_left(succ->get_right());
-            }
-            else
-            {
-                succ_parent->set_right(succ->get_right());
-            }
-
-            // Copy Successor Data to starting_node before deleting it
-            starting_node->set_key(succ->get_key());
-
-            delete succ;
-
-            return starting_node;
-        }
-    }
-
-    constexpr node_pointer delete_node(value_type key)
-    {
-        return delete_node(root, key);
-    }
-
-    constexpr node_pointer delete_all_node(node_pointer starting_node, value_type key)
-    {
-        for(unsigned counter = count(starting_node, key); counter != 0; counter--)
-        {
-            starting_node = delete_node(starting_node, key);
-        }
-        return starting_node;
-    }
-
-    constexpr node_pointer delete_all_node(value_type key)
-    {
-        return delete_all_node(root, key);
-    }
-
-    constexpr void delete_tree(node_pointer root)
-    {
-        if(!root)
-            return;
-
-        /* first delete both subtrees */
-        delete_tree(root->get_left());
-        delete_tree(root->get_right());
-
-        /* then delete the node */
-
-        if(root->get_parent() != nullptr)
-        {
-            node_pointer root_parent = root->get_parent();
-            (root == root_parent->get_left()) ? root_parent->set_left(nullptr) : root_parent->set_right(nullptr);
-        }
-        else if(root == this->root)
-        {
-            this->root = nullptr;
-        }
-
-        delete root;
-    }
-};
-
-template<typename T> constexpr void bst_sort(T* arr, size_t length)
-{
-    binary_search_tree<T> tree;
-    for(size_t i = 0; i < length; i++)
-        tree.insert(arr[i]);
-    tree.inorder_traversal(tree.get_root());
-}
-
-template<typename T, size_t length> constexpr void bst_sort(T (&arr)[length])
-{
-    bst_sort(arr, length);
-}
-}
-
-#endif // BINARY_SEARCH_TREE_HPP_INCLUDED
-
+#ifndef BINARY_SEARCH_TREE_HPP_INCLUDED
+#define BINARY_SEARCH_TREE_HPP_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bst_frozen.hpp"
+#include "bst_io.hpp"
+#include "bst_stats.hpp"
+#include "bst_task_pool.hpp"
+
+namespace BST
+{
+/*
+ * Balancing policies for binary_search_tree.
+ *
+ * A policy is told when a node has just been linked into the tree and when a node has just been
+ * unlinked from it, and restores its shape invariant with the tree's rotate_left/rotate_right.
+ * It keeps its bookkeeping in the node's balance field (get_balance/set_balance).
+ * bulk_built_balance gives that field for a node of a perfectly balanced tree built from sorted keys:
+ * depth is the node's depth, deepest_level the depth of the last level and height_difference
+ * height(right subtree) - height(left subtree).
+ */
+struct unbalanced_policy
+{
+    static constexpr signed char bulk_built_balance(std::size_t, std::size_t, int) { return 0; }
+
+    template<typename Tree> static constexpr void rebalance_after_insert(Tree&, typename Tree::node_pointer) {}
+
+    template<typename Tree> static constexpr void rebalance_after_erase(Tree&, typename Tree::node_pointer, typename Tree::node_pointer, bool, signed char) {}
+};
+
+/* Red-black tree: the balance field holds the colour of the node. */
+struct red_black_policy
+{
+    static constexpr signed char black = 0;
+    static constexpr signed char red = 1;
+
+    /* Every root-to-leaf path has the same number of nodes above the last level, so only that level is red */
+    static constexpr signed char bulk_built_balance(std::size_t depth, std::size_t deepest_level, int)
+    {
+        return (depth == deepest_level && depth != 0) ? red : black;
+    }
+
+    template<typename NodePointer> static constexpr bool is_red(NodePointer checking_node)
+    {
+        return checking_node != nullptr && checking_node->get_balance() == red;
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_insert(Tree& tree, typename Tree::node_pointer inserted_node)
+    {
+        inserted_node->set_balance(red);
+        repair_double_red(tree, inserted_node);
+        tree.get_root()->set_balance(black);
+    }
+
+    /* Recolours and rotates upwards until inserted_node, just turned red, no longer has a red parent. The root may end up red. */
+    template<typename Tree> static constexpr void repair_double_red(Tree& tree, typename Tree::node_pointer inserted_node)
+    {
+        while(is_red(inserted_node->get_parent()))
+        {
+            auto parent_node = inserted_node->get_parent();
+            auto grandparent_node = parent_node->get_parent(); /* Exists, since a red node is never the root */
+
+            if(parent_node == grandparent_node->get_left())
+            {
+                auto uncle_node = grandparent_node->get_right();
+                if(is_red(uncle_node))
+                {
+                    parent_node->set_balance(black);
+                    uncle_node->set_balance(black);
+                    grandparent_node->set_balance(red);
+                    inserted_node = grandparent_node;
+                    continue;
+                }
+
+                if(inserted_node == parent_node->get_right())
+                {
+                    inserted_node = parent_node;
+                    tree.rotate_left(inserted_node);
+                    parent_node = inserted_node->get_parent();
+                }
+
+                parent_node->set_balance(black);
+                grandparent_node->set_balance(red);
+                tree.rotate_right(grandparent_node);
+            }
+            else
+            {
+                auto uncle_node = grandparent_node->get_left();
+                if(is_red(uncle_node))
+                {
+                    parent_node->set_balance(black);
+                    uncle_node->set_balance(black);
+                    grandparent_node->set_balance(red);
+                    inserted_node = grandparent_node;
+                    continue;
+                }
+
+                if(inserted_node == parent_node->get_left())
+                {
+                    inserted_node = parent_node;
+                    tree.rotate_right(inserted_node);
+                    parent_node = inserted_node->get_parent();
+                }
+
+                parent_node->set_balance(black);
+                grandparent_node->set_balance(red);
+                tree.rotate_left(grandparent_node);
+            }
+        }
+    }
+
+    /*
+     * Join support (see binary_search_tree::split and join). The height of a subtree cut loose from
+     * the tree is its black height: the number of black nodes on every path down from its root, which
+     * is made black when it is cut loose.
+     */
+    template<typename NodePointer> static constexpr int subtree_height(NodePointer subtree_root)
+    {
+        int height = 0;
+        for(; subtree_root != nullptr; subtree_root = subtree_root->get_left())
+            height += is_red(subtree_root) ? 0 : 1;
+
+        return height;
+    }
+
+    template<typename NodePointer> static constexpr int child_height(NodePointer parent_node, int parent_height, bool)
+    {
+        return parent_height - (is_red(parent_node) ? 0 : 1);
+    }
+
+    template<typename NodePointer> static constexpr int detached_height(NodePointer subtree_root, int height)
+    {
+        if(!is_red(subtree_root))
+            return height;
+
+        subtree_root->set_balance(black);
+        return height + 1;
+    }
+
+    /* Whether the middle node of a join takes the place of spine_node, reached walking down the taller side */
+    template<typename NodePointer> static constexpr bool joins_at(NodePointer spine_node, int spine_height, int shorter_height)
+    {
+        return spine_height == shorter_height && !is_red(spine_node);
+    }
+
+    /* middle_node has just replaced a black subtree of the same black height as its other child; returns the new height */
+    template<typename Tree> static constexpr int rebalance_after_join(Tree& tree, typename Tree::node_pointer middle_node, int, int, int taller_height)
+    {
+        middle_node->set_balance(red);
+        repair_double_red(tree, middle_node);
+
+        bool grew = is_red(tree.get_root());
+        tree.get_root()->set_balance(black);
+        return taller_height + (grew ? 1 : 0);
+    }
+
+    /* child took the place of the unlinked node (it may be null), parent_node is its parent and
+       left_side tells on which side of parent_node that place is. */
+    template<typename Tree> static constexpr void rebalance_after_erase(Tree& tree, typename Tree::node_pointer child,
+                                                                      typename Tree::node_pointer parent_node, bool left_side, signed char removed_balance)
+    {
+        if(removed_balance != black)
+            return;
+
+        while(parent_node != nullptr && !is_red(child))
+        {
+            if(left_side)
+            {
+                auto sibling_node = parent_node->get_right();
+                if(is_red(sibling_node))
+                {
+                    sibling_node->set_balance(black);
+                    parent_node->set_balance(red);
+                    tree.rotate_left(parent_node);
+                    sibling_node = parent_node->get_right();
+                }
+
+                if(!is_red(sibling_node->get_left()) && !is_red(sibling_node->get_right()))
+                {
+                    sibling_node->set_balance(red);
+                    child = parent_node;
+                    parent_node = child->get_parent();
+                    left_side = parent_node != nullptr && child == parent_node->get_left();
+                    continue;
+                }
+
+                if(!is_red(sibling_node->get_right()))
+                {
+                    sibling_node->get_left()->set_balance(black);
+                    sibling_node->set_balance(red);
+                    tree.rotate_right(sibling_node);
+                    sibling_node = parent_node->get_right();
+                }
+
+                sibling_node->set_balance(parent_node->get_balance());
+                parent_node->set_balance(black);
+                sibling_node->get_right()->set_balance(black);
+                tree.rotate_left(parent_node);
+            }
+            else
+            {
+                auto sibling_node = parent_node->get_left();
+                if(is_red(sibling_node))
+                {
+                    sibling_node->set_balance(black);
+                    parent_node->set_balance(red);
+                    tree.rotate_right(parent_node);
+                    sibling_node = parent_node->get_left();
+                }
+
+                if(!is_red(sibling_node->get_left()) && !is_red(sibling_node->get_right()))
+                {
+                    sibling_node->set_balance(red);
+                    child = parent_node;
+                    parent_node = child->get_parent();
+                    left_side = parent_node != nullptr && child == parent_node->get_left();
+                    continue;
+                }
+
+                if(!is_red(sibling_node->get_left()))
+                {
+                    sibling_node->get_right()->set_balance(black);
+                    sibling_node->set_balance(red);
+                    tree.rotate_left(sibling_node);
+                    sibling_node = parent_node->get_left();
+                }
+
+                sibling_node->set_balance(parent_node->get_balance());
+                parent_node->set_balance(black);
+                sibling_node->get_left()->set_balance(black);
+                tree.rotate_right(parent_node);
+            }
+
+            child = tree.get_root();
+            break;
+        }
+
+        if(child != nullptr)
+            child->set_balance(black);
+    }
+};
+
+/* AVL tree: the balance field holds height(right subtree) - height(left subtree). */
+struct avl_policy
+{
+    static constexpr signed char bulk_built_balance(std::size_t, std::size_t, int height_difference)
+    {
+        return static_cast<signed char>(height_difference);
+    }
+
+    /* Rotates a node whose balance has reached -2 or +2. Returns the new root of the subtree and
+       whether the subtree got shorter. */
+    template<typename Tree> static constexpr std::pair<typename Tree::node_pointer, bool> restore_balance(Tree& tree, typename Tree::node_pointer pivot_node, signed char balance)
+    {
+        if(balance < 0)
+        {
+            auto heavy_child = pivot_node->get_left();
+            if(heavy_child->get_balance() <= 0)
+            {
+                tree.rotate_right(pivot_node);
+                if(heavy_child->get_balance() == 0)
+                {
+                    pivot_node->set_balance(-1);
+                    heavy_child->set_balance(1);
+                    return {heavy_child, false};
+                }
+
+                pivot_node->set_balance(0);
+                heavy_child->set_balance(0);
+                return {heavy_child, true};
+            }
+
+            auto inner_child = heavy_child->get_right();
+            tree.rotate_left(heavy_child);
+            tree.rotate_right(pivot_node);
+            pivot_node->set_balance(inner_child->get_balance() < 0 ? 1 : 0);
+            heavy_child->set_balance(inner_child->get_balance() > 0 ? -1 : 0);
+            inner_child->set_balance(0);
+            return {inner_child, true};
+        }
+        else
+        {
+            auto heavy_child = pivot_node->get_right();
+            if(heavy_child->get_balance() >= 0)
+            {
+                tree.rotate_left(pivot_node);
+                if(heavy_child->get_balance() == 0)
+                {
+                    pivot_node->set_balance(1);
+                    heavy_child->set_balance(-1);
+                    return {heavy_child, false};
+                }
+
+                pivot_node->set_balance(0);
+                heavy_child->set_balance(0);
+                return {heavy_child, true};
+            }
+
+            auto inner_child = heavy_child->get_left();
+            tree.rotate_right(heavy_child);
+            tree.rotate_left(pivot_node);
+            pivot_node->set_balance(inner_child->get_balance() > 0 ? -1 : 0);
+            heavy_child->set_balance(inner_child->get_balance() < 0 ? 1 : 0);
+            inner_child->set_balance(0);
+            return {inner_child, true};
+        }
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_insert(Tree& tree, typename Tree::node_pointer inserted_node)
+    {
+        inserted_node->set_balance(0);
+        rebalance_after_growth(tree, inserted_node);
+    }
+
+    /* Walks up while the subtree rooted at grown_node, just one level taller, keeps growing. Returns whether the whole tree grew. */
+    template<typename Tree> static constexpr bool rebalance_after_growth(Tree& tree, typename Tree::node_pointer grown_node)
+    {
+        for(auto child = grown_node, parent_node = child->get_parent(); parent_node != nullptr; child = parent_node, parent_node = parent_node->get_parent())
+        {
+            signed char balance = parent_node->get_balance() + ((child == parent_node->get_left()) ? -1 : 1);
+            if(balance == 0)
+            {
+                parent_node->set_balance(0);
+                return false;
+            }
+            else if(balance == -1 || balance == 1)
+            {
+                parent_node->set_balance(balance);
+            }
+            else
+            {
+                /* After an insert the rotation always restores the old height; after a join it may not */
+                auto [new_subtree_root, shorter] = restore_balance(tree, parent_node, balance);
+                if(shorter)
+                    return false;
+
+                parent_node = new_subtree_root;
+            }
+        }
+
+        return true;
+    }
+
+    /* Join support (see binary_search_tree::split and join): the height of a subtree is its height */
+    template<typename NodePointer> static constexpr int subtree_height(NodePointer subtree_root)
+    {
+        int height = 0;
+        for(; subtree_root != nullptr; subtree_root = (subtree_root->get_balance() > 0) ? subtree_root->get_right() : subtree_root->get_left())
+            ++height;
+
+        return height;
+    }
+
+    template<typename NodePointer> static constexpr int child_height(NodePointer parent_node, int parent_height, bool left_child)
+    {
+        signed char balance = parent_node->get_balance();
+        return parent_height - 1 - ((left_child ? balance > 0 : balance < 0) ? 1 : 0);
+    }
+
+    template<typename NodePointer> static constexpr int detached_height(NodePointer, int height)
+    {
+        return height;
+    }
+
+    template<typename NodePointer> static constexpr bool joins_at(NodePointer, int spine_height, int shorter_height)
+    {
+        return spine_height <= shorter_height + 1;
+    }
+
+    /* middle_node has just replaced a subtree at most one level taller than its other child; returns the new height */
+    template<typename Tree> static constexpr int rebalance_after_join(Tree& tree, typename Tree::node_pointer middle_node, int left_height, int right_height, int taller_height)
+    {
+        middle_node->set_balance(static_cast<signed char>(right_height - left_height));
+        return taller_height + (rebalance_after_growth(tree, middle_node) ? 1 : 0);
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_erase(Tree& tree, typename Tree::node_pointer,
+                                                                      typename Tree::node_pointer parent_node, bool left_side, signed char)
+    {
+        /* Walk up while the subtree that lost a node has become shorter */
+        while(parent_node != nullptr)
+        {
+            auto subtree_root = parent_node;
+            signed char balance = parent_node->get_balance() + (left_side ? 1 : -1);
+            if(balance == -1 || balance == 1)
+            {
+                parent_node->set_balance(balance);
+                return;
+            }
+            else if(balance == 0)
+            {
+                parent_node->set_balance(0);
+            }
+            else
+            {
+                auto [new_subtree_root, shorter] = restore_balance(tree, parent_node, balance);
+                if(!shorter)
+                    return;
+
+                subtree_root = new_subtree_root;
+            }
+
+            parent_node = subtree_root->get_parent();
+            left_side = parent_node != nullptr && subtree_root == parent_node->get_left();
+        }
+    }
+};
+
+/*
+ * Splay tree: no balance field and no height bound. Every inserted node, the parent of every removed
+ * one and every node found by a non-const search is rotated up to the root, so keys accessed often
+ * stay within a few levels of it. A sequence of m operations costs O(m log n) in all, and a skewed
+ * access pattern far less; a single operation may still take O(n). Policies with an after_access
+ * hook are told of every node a non-const search finds.
+ */
+struct splay_policy
+{
+    static constexpr signed char bulk_built_balance(std::size_t, std::size_t, int) { return 0; }
+
+    /* One rotation that moves accessed_node above its parent */
+    template<typename Tree> static constexpr void rotate_up(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        typename Tree::node_pointer parent_node = accessed_node->get_parent();
+        if(accessed_node == parent_node->get_left())
+            tree.rotate_right(parent_node);
+        else
+            tree.rotate_left(parent_node);
+    }
+
+    /* Bottom-up splay through the parent links: zig-zig rotates the parent first, zig-zag the node twice */
+    template<typename Tree> static constexpr void splay(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        while(typename Tree::node_pointer parent_node = accessed_node->get_parent())
+        {
+            typename Tree::node_pointer grandparent_node = parent_node->get_parent();
+            if(grandparent_node != nullptr)
+            {
+                bool same_side = (accessed_node == parent_node->get_left()) == (parent_node == grandparent_node->get_left());
+                rotate_up(tree, same_side ? parent_node : accessed_node);
+            }
+            rotate_up(tree, accessed_node);
+        }
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_insert(Tree& tree, typename Tree::node_pointer inserted_node)
+    {
+        splay(tree, inserted_node);
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_erase(Tree& tree, typename Tree::node_pointer,
+        typename Tree::node_pointer parent_node, bool, signed char)
+    {
+        if(parent_node != nullptr)
+            splay(tree, parent_node);
+    }
+
+    template<typename Tree> static constexpr void after_access(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        splay(tree, accessed_node);
+    }
+};
+
+/*
+ * Semi-splay tree: as splay_policy, but a zig-zig step rotates only the parent and carries on from
+ * there, so an access roughly halves the depth of the nodes on its path instead of bringing the node
+ * to the root. Same amortized bounds with about half the rotations, which pays off when the hot set
+ * is wider than the few keys a full splay keeps at the top.
+ */
+struct semi_splay_policy : splay_policy
+{
+    template<typename Tree> static constexpr void splay(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        while(typename Tree::node_pointer parent_node = accessed_node->get_parent())
+        {
+            typename Tree::node_pointer grandparent_node = parent_node->get_parent();
+            if(grandparent_node == nullptr)
+            {
+                rotate_up(tree, accessed_node);
+            }
+            else if((accessed_node == parent_node->get_left()) == (parent_node == grandparent_node->get_left()))
+            {
+                rotate_up(tree, parent_node);
+                accessed_node = parent_node;
+            }
+            else
+            {
+                rotate_up(tree, accessed_node);
+                rotate_up(tree, accessed_node);
+            }
+        }
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_insert(Tree& tree, typename Tree::node_pointer inserted_node)
+    {
+        splay(tree, inserted_node);
+    }
+
+    template<typename Tree> static constexpr void rebalance_after_erase(Tree& tree, typename Tree::node_pointer,
+        typename Tree::node_pointer parent_node, bool, signed char)
+    {
+        if(parent_node != nullptr)
+            splay(tree, parent_node);
+    }
+
+    template<typename Tree> static constexpr void after_access(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        splay(tree, accessed_node);
+    }
+};
+
+/*
+ * Sampled splaying for splay_policy or semi_splay_policy: a non-const search splays the node it finds
+ * only once every _Period searches, while inserts and removals still splay every time. Hot keys still
+ * drift to the top, since they are most of the sample, but most lookups write nothing. The countdown
+ * is per thread and shared by all trees using the policy, which sampling does not mind.
+ */
+template<unsigned _Period = 16, typename _Splay = semi_splay_policy>
+struct sampled_splaying : _Splay
+{
+    static_assert(_Period != 0, "sampled_splaying needs a period of at least one search");
+
+    static inline thread_local unsigned countdown = _Period;
+
+    template<typename Tree> static void after_access(Tree& tree, typename Tree::node_pointer accessed_node)
+    {
+        if(--countdown != 0)
+            return;
+
+        countdown = _Period;
+        _Splay::splay(tree, accessed_node);
+    }
+};
+
+/*
+ * Order-statistics augmentation for any of the policies above: every node also records the size of
+ * its subtree, kept up to date by insert, delete_node and the rotations. That makes size() and count()
+ * O(1) and enables rank(), select() and count_range() in O(height).
+ */
+template<typename _Balance = unbalanced_policy>
+struct order_statistics : _Balance
+{
+    static constexpr bool counts_subtrees = true;
+};
+
+/* What insert does with a key equivalent to one already in the tree (see duplicate_handling) */
+enum class duplicate_keys
+{
+    chain,     /* Links one more node after the equivalent ones: a multiset, and the default */
+    reject,    /* Keeps the key already there: a set */
+    overwrite, /* Assigns the new key over the one already there: a set where the last insert wins */
+    count      /* Keeps one node per key with the number of times it was inserted: a multiset of counters */
+};
+
+/*
+ * Duplicate handling for any of the policies above, e.g. duplicate_handling<duplicate_keys::count,
+ * order_statistics<red_black_policy>>. Except under chain, every key has one node, so erase(key) and
+ * delete_all_node are a single O(height) removal however often the key was inserted. Under count the
+ * iterators, size() and the set operations see each key once, count(key) and delete_node see the
+ * occurrences, and the counter fits in the node's padding for keys of at most 4 bytes.
+ */
+template<duplicate_keys _Mode, typename _Balance = unbalanced_policy>
+struct duplicate_handling : _Balance
+{
+    static constexpr duplicate_keys duplicates = _Mode;
+};
+
+/*
+ * Instrumentation for any of the policies above: the tree keeps a tree_stats (bst_stats.hpp) of its
+ * searches, inserts and removals, the nodes and comparisons their descents take, its node allocations
+ * and a histogram of path lengths, read back with stats(). Without it none of this is compiled in.
+ * The counters are plain integers, so the parallel set operations and parallel_clear of an
+ * instrumented tree run on the calling thread.
+ */
+template<typename _Balance = unbalanced_policy>
+struct instrumented : _Balance
+{
+    static constexpr bool collects_stats = true;
+};
+
+/* Order in which binary_search_tree::copy_to writes the keys */
+enum class traversal_order
+{
+    inorder,    /* Ascending, as the iterators go */
+    preorder,   /* Each node before its subtrees: inserted in this order into an unbalanced tree, the keys rebuild the same shape */
+    postorder,  /* Each node after its subtrees */
+    level_order /* Breadth first, from the root down */
+};
+
+/*
+ * The memory behind an arena_allocator and all its copies and rebinds: one pool of equally sized blocks
+ * for each size and alignment allocated, so a tree's nodes and whatever else is allocated through a
+ * rebind of the same allocator come out of one arena.
+ */
+template<std::size_t _BlocksPerChunk>
+class node_arena
+{
+ public:
+    class block_pool
+    {
+     private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        std::size_t object_size;
+        std::size_t object_alignment;
+        std::size_t block_size;
+        std::align_val_t chunk_alignment;
+        std::vector<unsigned char*> chunks;
+        free_block* free_list = nullptr;
+        std::size_t used_blocks = _BlocksPerChunk; /* Blocks handed out from the newest chunk */
+
+     public:
+        block_pool(std::size_t size, std::size_t alignment)
+            : object_size(size), object_alignment(alignment),
+              chunk_alignment(static_cast<std::align_val_t>(std::max(alignment, alignof(free_block))))
+        {
+            const std::size_t step = static_cast<std::size_t>(chunk_alignment);
+            block_size = (std::max(size, sizeof(free_block)) + step - 1) / step * step;
+        }
+
+        block_pool(const block_pool&) = delete;
+        block_pool& operator=(const block_pool&) = delete;
+
+        ~block_pool() { release(); }
+
+        bool serves(std::size_t size, std::size_t alignment) const
+        {
+            return object_size == size && object_alignment == alignment;
+        }
+
+        void* allocate()
+        {
+            if(free_list != nullptr)
+            {
+                free_block* reused_block = free_list;
+                free_list = free_list->next;
+                return reused_block;
+            }
+
+            if(used_blocks == _BlocksPerChunk)
+            {
+                unsigned char* new_chunk = static_cast<unsigned char*>(::operator new(block_size * _BlocksPerChunk, chunk_alignment));
+                try
+                {
+                    chunks.push_back(new_chunk);
+                }
+                catch(...)
+                {
+                    ::operator delete(new_chunk, chunk_alignment);
+                    throw;
+                }
+
+                used_blocks = 0;
+            }
+
+            return chunks.back() + block_size * used_blocks++;
+        }
+
+        void deallocate(void* freed_block)
+        {
+            free_list = ::new(freed_block) free_block{free_list};
+        }
+
+        void release()
+        {
+            for(unsigned char* chunk : chunks)
+                ::operator delete(chunk, chunk_alignment);
+
+            chunks.clear();
+            free_list = nullptr;
+            used_blocks = _BlocksPerChunk;
+        }
+    };
+
+ private:
+    std::vector<std::unique_ptr<block_pool>> pools;
+
+ public:
+    node_arena() = default;
+    node_arena(const node_arena&) = delete;
+    node_arena& operator=(const node_arena&) = delete;
+
+    block_pool& pool_for(std::size_t size, std::size_t alignment)
+    {
+        for(const std::unique_ptr<block_pool>& pool : pools)
+        {
+            if(pool->serves(size, alignment))
+                return *pool;
+        }
+
+        return *pools.emplace_back(std::make_unique<block_pool>(size, alignment));
+    }
+
+    void release()
+    {
+        for(const std::unique_ptr<block_pool>& pool : pools)
+            pool->release();
+    }
+};
+
+/*
+ * Pool allocator for tree nodes. Single-object allocations are carved out of large chunks and
+ * recycled through a free list, larger requests go straight to operator new. release() hands all
+ * chunks back at once, which binary_search_tree::clear() uses instead of freeing node by node
+ * when the keys need no destructor and no one else holds the arena.
+ *
+ * Copies and rebinds share one node_arena, which lives until its last holder is gone: a tree built
+ * from an allocator, a tree returned by split() or an extracted node handle keeps it alive, and
+ * compares equal to the allocators it shares it with.
+ */
+template<typename _Tp, std::size_t _BlocksPerChunk = 1024>
+class arena_allocator
+{
+ private:
+    using arena = node_arena<_BlocksPerChunk>;
+    using block_pool = typename arena::block_pool;
+
+    template<typename, std::size_t> friend class arena_allocator;
+
+    std::shared_ptr<arena> pool;
+    block_pool* blocks = nullptr; /* The block pool serving _Tp, looked up on first use */
+
+    block_pool& blocks_for_type()
+    {
+        if(blocks == nullptr)
+            blocks = &pool->pool_for(sizeof(_Tp), alignof(_Tp));
+
+        return *blocks;
+    }
+
+ public:
+    using value_type = _Tp;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template<typename _Up> struct rebind { using other = arena_allocator<_Up, _BlocksPerChunk>; };
+
+    arena_allocator() : pool(std::make_shared<arena>()) {}
+
+    template<typename _Up> arena_allocator(const arena_allocator<_Up, _BlocksPerChunk>& other) : pool(other.pool) {}
+
+    /* A copied container gets an arena of its own */
+    arena_allocator select_on_container_copy_construction() const
+    {
+        return arena_allocator();
+    }
+
+    _Tp* allocate(std::size_t n)
+    {
+        if(n != 1)
+            return std::allocator<_Tp>().allocate(n);
+
+        if(!pool) /* Moved-from allocator */
+        {
+            pool = std::make_shared<arena>();
+            blocks = nullptr;
+        }
+
+        return static_cast<_Tp*>(blocks_for_type().allocate());
+    }
+
+    void deallocate(_Tp* p, std::size_t n)
+    {
+        if(n != 1)
+            std::allocator<_Tp>().deallocate(p, n);
+        else
+            blocks_for_type().deallocate(p);
+    }
+
+    /* Frees every chunk at once. Objects still living in the arena must not be touched afterwards. */
+    void release()
+    {
+        if(pool)
+            pool->release();
+    }
+
+    /* True when no other copy or rebind of this allocator shares its arena, so release() frees only what this one allocated */
+    bool owns_arena() const
+    {
+        return !pool || pool.use_count() == 1;
+    }
+
+    template<typename _Up>
+    bool operator==(const arena_allocator<_Up, _BlocksPerChunk>& other) const
+    {
+        return pool == other.pool;
+    }
+};
+
+/* Tag telling the range constructor and assign() that the keys are already in ascending order */
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+/* Tag telling the batch operations that the keys are in ascending order; unlike sorted_unique, equal keys may repeat */
+struct sorted_equivalent_t { explicit sorted_equivalent_t() = default; };
+inline constexpr sorted_equivalent_t sorted_equivalent{};
+
+/*
+ * Keys are ordered by _Compare. When it declares is_transparent (std::less<> does), search, count,
+ * the bounds, visit_range, erase, delete_node, delete_all_node, extract, split, rank and count_range also
+ * accept any type the comparator can compare with the key, e.g. std::string_view for std::string
+ * keys, without building a key.
+ */
+template<typename _Tp, typename _Balance = unbalanced_policy, typename _Alloc = std::allocator<_Tp>, typename _Compare = std::less<>>
+class binary_search_tree
+{
+ public:
+    class node;
+    using value_type = _Tp;
+    using balance_policy = _Balance;
+    using allocator_type = _Alloc;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+    using node_pointer = node*;
+
+    static constexpr bool transparent_compare = requires { typename _Compare::is_transparent; };
+
+    /* Nodes carry their subtree size when the policy asks for it (see order_statistics) */
+    static constexpr bool counts_subtrees = requires { requires _Balance::counts_subtrees; };
+
+    /* split, join and the set operations need a policy that can join trees of different heights: red_black_policy or avl_policy */
+    static constexpr bool joins_subtrees = requires(node_pointer subtree_root) { _Balance::joins_at(subtree_root, 0, 0); };
+
+    /* What insert does with equivalent keys: the policy's duplicates (see duplicate_handling), chain by default */
+    static constexpr duplicate_keys duplicate_mode = []
+    {
+        if constexpr(requires { _Balance::duplicates; })
+            return _Balance::duplicates;
+        else
+            return duplicate_keys::chain;
+    }();
+
+    /* Nodes carry an occurrence counter under duplicate_keys::count */
+    static constexpr bool counts_occurrences = duplicate_mode == duplicate_keys::count;
+
+    /* The tree counts its operations when the policy asks for it (see instrumented) */
+    static constexpr bool collects_stats = requires { requires _Balance::collects_stats; };
+
+    /* Non-const searches let the policy restructure around the node they find (see splay_policy) */
+    static constexpr bool adjusts_on_access = requires(binary_search_tree& tree, node_pointer accessed_node) { _Balance::after_access(tree, accessed_node); };
+
+    /*
+     * The key is stored inline and the node has no vtable. The balancing policy's bookkeeping
+     * (at most two bits: a colour or a balance factor in -1..1) lives in the low bits of the
+     * parent pointer, which are always zero since nodes are at least pointer aligned.
+     */
+    class node
+    {
+        friend class binary_search_tree;
+
+     private:
+        static constexpr std::uintptr_t balance_mask = 3;
+
+        struct no_subtree_size {};
+        using subtree_size_type = std::conditional_t<counts_subtrees, size_type, no_subtree_size>;
+
+        struct no_occurrences {};
+        using occurrence_type = std::conditional_t<counts_occurrences, std::uint32_t, no_occurrences>;
+
+        static constexpr subtree_size_type single_node_size()
+        {
+            if constexpr(counts_subtrees)
+                return 1;
+            else
+                return {};
+        }
+
+        static constexpr occurrence_type single_occurrence()
+        {
+            if constexpr(counts_occurrences)
+                return 1;
+            else
+                return {};
+        }
+
+        node_pointer left;
+        node_pointer right;
+        std::uintptr_t parent_and_balance;
+        value_type key;
+        [[no_unique_address]] occurrence_type occurrences; /* Right after the key, to fill the padding behind a small one */
+        [[no_unique_address]] subtree_size_type subtree_size;
+
+        constexpr void link_parent(node_pointer new_parent)
+        {
+            parent_and_balance = reinterpret_cast<std::uintptr_t>(new_parent) | (parent_and_balance & balance_mask);
+        }
+
+     public:
+        constexpr node() : left(nullptr), right(nullptr), parent_and_balance(0), key(), occurrences(single_occurrence()), subtree_size(single_node_size()) {}
+
+        explicit constexpr node(const value_type& key)
+            : left(nullptr), right(nullptr), parent_and_balance(0), key(key), occurrences(single_occurrence()), subtree_size(single_node_size()) {}
+
+        explicit constexpr node(value_type&& key)
+            : left(nullptr), right(nullptr), parent_and_balance(0), key(std::move(key)), occurrences(single_occurrence()), subtree_size(single_node_size()) {}
+
+        /* Constructs the key in place from args */
+        template<typename... _Args>
+        explicit constexpr node(std::in_place_t, _Args&&... args)
+            : left(nullptr), right(nullptr), parent_and_balance(0), key(std::forward<_Args>(args)...), occurrences(single_occurrence()), subtree_size(single_node_size()) {}
+
+        ~node() { this->clear(); }
+
+        constexpr node(const node& n)
+            : left(n.left), right(n.right), parent_and_balance(n.parent_and_balance), key(n.key), occurrences(n.occurrences), subtree_size(n.subtree_size) {}
+
+        constexpr node(node&& n) noexcept
+            : left(n.left), right(n.right), parent_and_balance(n.parent_and_balance), key(std::move(n.key)), occurrences(n.occurrences), subtree_size(n.subtree_size)
+            { n.left = nullptr; n.right = nullptr; n.parent_and_balance = 0; }
+
+        constexpr node& operator=(const node& n)
+        {
+            if(this == &n)
+                return *this;
+
+            clear();
+
+            key = n.key;
+            left = n.left;
+            right = n.right;
+            parent_and_balance = n.parent_and_balance;
+            occurrences = n.occurrences;
+            subtree_size = n.subtree_size;
+            return *this;
+        }
+
+        constexpr node& operator=(node&& n) noexcept
+        {
+            clear();
+
+            key = std::move(n.key);
+            left = n.left;
+            right = n.right;
+            parent_and_balance = n.parent_and_balance;
+            occurrences = n.occurrences;
+            subtree_size = n.subtree_size;
+
+            n.left = nullptr;
+            n.right = nullptr;
+            n.parent_and_balance = 0;
+            return *this;
+        }
+
+        /* Detaches the node from its neighbours */
+        constexpr void clear()
+        {
+            if(left != nullptr)
+                left->link_parent(nullptr);
+
+            if(right != nullptr)
+                right->link_parent(nullptr);
+
+            node_pointer parent = get_parent();
+            if(parent != nullptr)
+            {
+                if(parent->left == this)
+                    parent->left = nullptr;
+                else
+                    parent->right = nullptr;
+            }
+
+            left = nullptr;
+            right = nullptr;
+            link_parent(nullptr);
+        }
+
+        constexpr void set_left(node_pointer new_left)
+        {
+            if(left != nullptr)
+                left->link_parent(nullptr);
+
+            left = new_left;
+
+            if(new_left != nullptr)
+                new_left->link_parent(this);
+        }
+
+        constexpr node_pointer get_left() const
+        {
+            return left;
+        }
+
+        constexpr void set_right(node_pointer new_right)
+        {
+            if(right != nullptr)
+                right->link_parent(nullptr);
+
+            right = new_right;
+
+            if(new_right != nullptr)
+                new_right->link_parent(this);
+        }
+
+        constexpr node_pointer get_right() const
+        {
+            return right;
+        }
+
+        constexpr void set_parent_left(node_pointer new_parent)
+        {
+            node_pointer parent = get_parent();
+            if(parent != nullptr)
+                (parent->get_left() == this) ? parent->set_left(nullptr) : parent->set_right(nullptr);
+
+            link_parent(new_parent);
+
+            if(new_parent != nullptr)
+                new_parent->set_left(this);
+        }
+
+        constexpr void set_parent_right(node_pointer new_parent)
+        {
+            node_pointer parent = get_parent();
+            if(parent != nullptr)
+                (parent->get_left() == this) ? parent->set_left(nullptr) : parent->set_right(nullptr);
+
+            link_parent(new_parent);
+
+            if(new_parent != nullptr)
+                new_parent->set_right(this);
+        }
+
+        constexpr node_pointer get_parent() const
+        {
+            return reinterpret_cast<node_pointer>(parent_and_balance & ~balance_mask);
+        }
+
+        constexpr void set_key(const value_type& key)
+        {
+            this->key = key;
+        }
+
+        constexpr const value_type& get_key() const
+        {
+            return key;
+        }
+
+        constexpr value_type& get_key()
+        {
+            return key;
+        }
+
+        constexpr void set_balance(signed char new_balance)
+        {
+            parent_and_balance = (parent_and_balance & ~balance_mask) | (static_cast<std::uintptr_t>(new_balance) & balance_mask);
+        }
+
+        constexpr signed char get_balance() const
+        {
+            /* Sign-extend the two stored bits */
+            signed char balance = static_cast<signed char>(parent_and_balance & balance_mask);
+            return (balance & 2) ? balance - 4 : balance;
+        }
+
+        /* Number of nodes in the subtree rooted here, this one included */
+        constexpr size_type get_subtree_size() const requires counts_subtrees
+        {
+            return subtree_size;
+        }
+
+        /* How many times the key was inserted; always 1 unless the tree counts occurrences */
+        constexpr size_type get_occurrences() const
+        {
+            if constexpr(counts_occurrences)
+                return occurrences;
+            else
+                return 1;
+        }
+    };
+
+    /*
+     * Bidirectional in-order iterator. It walks the parent links through successor/predecessor, so a
+     * full pass touches every edge twice and each step is amortized O(1). The past-the-end position is
+     * a null node; it remembers its tree so that it can step back to the maximum.
+     * Writing through an iterator must not change the key's position in the order, as with set_key.
+     */
+    template<bool _Const>
+    class tree_iterator
+    {
+        friend class binary_search_tree;
+        template<bool> friend class tree_iterator;
+
+     public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = _Tp;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<_Const, const _Tp&, _Tp&>;
+        using pointer = std::conditional_t<_Const, const _Tp*, _Tp*>;
+
+     private:
+        node_pointer current;
+        const binary_search_tree* tree;
+
+        constexpr tree_iterator(node_pointer current, const binary_search_tree* tree) : current(current), tree(tree) {}
+
+     public:
+        constexpr tree_iterator() : current(nullptr), tree(nullptr) {}
+
+        /* iterator converts to const_iterator */
+        template<bool _OtherConst> requires (_Const && !_OtherConst)
+        constexpr tree_iterator(const tree_iterator<_OtherConst>& it) : current(it.current), tree(it.tree) {}
+
+        constexpr node_pointer get_node() const
+        {
+            return current;
+        }
+
+        constexpr reference operator*() const
+        {
+            return current->key;
+        }
+
+        constexpr pointer operator->() const
+        {
+            return &current->key;
+        }
+
+        constexpr tree_iterator& operator++()
+        {
+            current = tree->successor(current);
+            return *this;
+        }
+
+        constexpr tree_iterator operator++(int)
+        {
+            tree_iterator old_position = *this;
+            ++*this;
+            return old_position;
+        }
+
+        constexpr tree_iterator& operator--()
+        {
+            current = (current != nullptr) ? tree->predecessor(current) : tree->maximum();
+            return *this;
+        }
+
+        constexpr tree_iterator operator--(int)
+        {
+            tree_iterator old_position = *this;
+            --*this;
+            return old_position;
+        }
+
+        friend constexpr bool operator==(const tree_iterator& lhs, const tree_iterator& rhs)
+        {
+            return lhs.current == rhs.current;
+        }
+    };
+
+    using iterator = tree_iterator<false>;
+    using const_iterator = tree_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+ private:
+    using node_allocator_type = typename std::allocator_traits<_Alloc>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator_type>;
+
+    /* clear() may drop the whole arena instead of visiting every node, when the tree is its only holder */
+    static constexpr bool releases_in_bulk = std::is_trivially_destructible_v<value_type> &&
+                                             requires(node_allocator_type& node_alloc) { node_alloc.release(); node_alloc.owns_arena(); };
+
+    /* Nodes may be freed from several threads at once: std::allocator is the only allocator known to allow it,
+       and the allocation counters of an instrumented tree do not */
+    static constexpr bool frees_concurrently = std::is_same_v<node_allocator_type, std::allocator<node>> && !collects_stats;
+
+    /* What an instrumented tree counts: the totals, and the path of the operation in progress */
+    struct operation_counters
+    {
+        tree_stats totals;
+        std::uint64_t path_nodes = 0;
+        std::uint64_t path_comparisons = 0;
+    };
+
+    struct no_counters {};
+
+    [[no_unique_address]] node_allocator_type node_alloc;
+    [[no_unique_address]] key_compare compare;
+    [[no_unique_address]] mutable std::conditional_t<collects_stats, operation_counters, no_counters> counters;
+
+ protected:
+    enum class counted_operation { search, insert, erase };
+
+    /* Counts one operation, with the nodes the descents made between construction and destruction visit */
+    class operation_probe
+    {
+     public:
+        constexpr operation_probe(const binary_search_tree& tree, counted_operation operation) : tree(tree), operation(operation)
+        {
+            if constexpr(collects_stats)
+            {
+                tree.counters.path_nodes = 0;
+                tree.counters.path_comparisons = 0;
+            }
+        }
+
+        operation_probe(const operation_probe&) = delete;
+        operation_probe& operator=(const operation_probe&) = delete;
+
+        constexpr ~operation_probe()
+        {
+            if constexpr(collects_stats)
+                tree.record_operation(operation);
+        }
+
+     private:
+        const binary_search_tree& tree;
+        counted_operation operation;
+    };
+
+ private:
+    /* Called by the descents for every node they visit, with the comparisons spent on it */
+    constexpr void note_visit(std::uint64_t comparisons) const
+    {
+        if constexpr(collects_stats)
+        {
+            ++counters.path_nodes;
+            counters.path_comparisons += comparisons;
+        }
+    }
+
+    constexpr void record_operation(counted_operation operation) const requires collects_stats
+    {
+        tree_stats& totals = counters.totals;
+        switch(operation)
+        {
+            case counted_operation::search:
+                ++totals.searches;
+                totals.search_nodes_visited += counters.path_nodes;
+                break;
+            case counted_operation::insert:
+                ++totals.inserts;
+                totals.insert_nodes_visited += counters.path_nodes;
+                break;
+            case counted_operation::erase:
+                ++totals.erases;
+                totals.erase_nodes_visited += counters.path_nodes;
+                break;
+        }
+
+        totals.comparisons += counters.path_comparisons;
+        ++totals.path_lengths[std::min<std::uint64_t>(counters.path_nodes, tree_stats::histogram_size - 1)];
+    }
+
+ protected:
+    node_pointer root;
+
+    /* Where a key goes: below parent_node on the given side, unless an equivalent key already sits in existing_node */
+    struct insert_position
+    {
+        node_pointer parent_node;
+        bool left_side;
+        node_pointer existing_node;
+    };
+
+    /* Allocates a detached node and constructs its key in place from args, exactly once */
+    template<typename... _Args>
+    constexpr node_pointer create_node(_Args&&... args)
+    {
+        node_pointer new_node = node_traits::allocate(node_alloc, 1);
+        try
+        {
+            node_traits::construct(node_alloc, new_node, std::in_place, std::forward<_Args>(args)...);
+        }
+        catch(...)
+        {
+            node_traits::deallocate(node_alloc, new_node, 1);
+            throw;
+        }
+
+        if constexpr(collects_stats)
+            ++counters.totals.allocations;
+        return new_node;
+    }
+
+    constexpr void destroy_node(node_pointer old_node)
+    {
+        old_node->left = nullptr;
+        old_node->right = nullptr;
+        old_node->parent_and_balance = 0;
+        node_traits::destroy(node_alloc, old_node);
+        node_traits::deallocate(node_alloc, old_node, 1);
+        if constexpr(collects_stats)
+            ++counters.totals.deallocations;
+    }
+
+    template<typename _Key>
+    constexpr insert_position find_unique_position(const _Key& key) const
+    {
+        insert_position position{nullptr, false, nullptr};
+        node_pointer checking_node = root;
+        while(checking_node != nullptr)
+        {
+            position.parent_node = checking_node;
+            if(compare(key, checking_node->key))
+            {
+                note_visit(1);
+                position.left_side = true;
+                checking_node = checking_node->get_left();
+            }
+            else if(compare(checking_node->key, key))
+            {
+                note_visit(2);
+                position.left_side = false;
+                checking_node = checking_node->get_right();
+            }
+            else
+            {
+                note_visit(2);
+                position.existing_node = checking_node;
+                break;
+            }
+        }
+
+        return position;
+    }
+
+    /* Hangs new_node at an empty position found by a lookup, then updates sizes and rebalances */
+    constexpr void link_at(const insert_position& position, node_pointer new_node)
+    {
+        node_pointer pivot_node = position.parent_node;
+        if(!pivot_node) /* Tree was empty */
+        {
+            root = new_node;
+        }
+        else if(position.left_side)
+        {
+            pivot_node->set_left(new_node);
+        }
+        else
+        {
+            pivot_node->set_right(new_node);
+        }
+
+        if constexpr(counts_subtrees)
+        {
+            for(node_pointer ancestor = pivot_node; ancestor != nullptr; ancestor = ancestor->get_parent())
+                ancestor->subtree_size++;
+        }
+
+        _Balance::rebalance_after_insert(*this, new_node);
+    }
+
+    constexpr iterator make_iterator(node_pointer position)
+    {
+        return iterator(position, this);
+    }
+
+    constexpr const_iterator make_iterator(node_pointer position) const
+    {
+        return const_iterator(position, this);
+    }
+
+ private:
+
+    static constexpr size_type subtree_size_of(node_pointer subtree_root)
+    {
+        return (subtree_root != nullptr) ? subtree_root->subtree_size : 0;
+    }
+
+    /* Recomputes the subtree sizes from changed_node up to the root */
+    static constexpr void refresh_subtree_sizes(node_pointer changed_node)
+    {
+        for(; changed_node != nullptr; changed_node = changed_node->get_parent())
+            changed_node->subtree_size = 1 + subtree_size_of(changed_node->left) + subtree_size_of(changed_node->right);
+    }
+
+    template<typename _Key>
+    constexpr bool equivalent(const value_type& node_key, const _Key& key) const
+    {
+        return !compare(node_key, key) && !compare(key, node_key);
+    }
+
+    /* Number of keys in the tree that are smaller than key, or not greater than it when inclusive */
+    template<typename _Key>
+    constexpr size_type count_before(const _Key& key, bool inclusive) const requires counts_subtrees
+    {
+        size_type preceding = 0;
+        node_pointer checking_node = root;
+        while(checking_node != nullptr)
+        {
+            if(compare(checking_node->key, key) || (inclusive && !compare(key, checking_node->key)))
+            {
+                preceding += 1 + subtree_size_of(checking_node->left);
+                checking_node = checking_node->right;
+            }
+            else
+            {
+                checking_node = checking_node->left;
+            }
+        }
+
+        return preceding;
+    }
+
+    /*
+     * Stackless in-order walk over the subtree under subtree_root, following the parent links back up.
+     * Returns the node after current_node, or nullptr once the subtree is exhausted.
+     */
+    static constexpr node_pointer next_inorder_within(node_pointer current_node, node_pointer subtree_root)
+    {
+        if(current_node->get_right() != nullptr)
+        {
+            current_node = current_node->get_right();
+            while(current_node->get_left() != nullptr)
+                current_node = current_node->get_left();
+
+            return current_node;
+        }
+
+        while(current_node != subtree_root && current_node == current_node->get_parent()->get_right())
+            current_node = current_node->get_parent();
+
+        return (current_node == subtree_root) ? nullptr : current_node->get_parent();
+    }
+
+    /* Node after current_node in a preorder walk of the subtree under subtree_root, or nullptr */
+    static constexpr node_pointer next_preorder_within(node_pointer current_node, node_pointer subtree_root)
+    {
+        if(current_node->get_left() != nullptr)
+            return current_node->get_left();
+
+        if(current_node->get_right() != nullptr)
+            return current_node->get_right();
+
+        // Climb until coming up from a left child whose parent has a right subtree left to walk
+        while(current_node != subtree_root)
+        {
+            node_pointer parent_node = current_node->get_parent();
+            if(current_node == parent_node->get_left() && parent_node->get_right() != nullptr)
+                return parent_node->get_right();
+
+            current_node = parent_node;
+        }
+
+        return nullptr;
+    }
+
+    /* First node of a postorder walk of the subtree under starting_node: its leftmost leaf */
+    static constexpr node_pointer first_postorder(node_pointer starting_node)
+    {
+        if(!starting_node)
+            return nullptr;
+
+        for(;;)
+        {
+            if(starting_node->get_left() != nullptr)
+                starting_node = starting_node->get_left();
+            else if(starting_node->get_right() != nullptr)
+                starting_node = starting_node->get_right();
+            else
+                return starting_node;
+        }
+    }
+
+    /* Node after current_node in a postorder walk of the subtree under subtree_root, or nullptr */
+    static constexpr node_pointer next_postorder_within(node_pointer current_node, node_pointer subtree_root)
+    {
+        if(current_node == subtree_root)
+            return nullptr;
+
+        node_pointer parent_node = current_node->get_parent();
+        if(current_node == parent_node->get_left() && parent_node->get_right() != nullptr)
+            return first_postorder(parent_node->get_right());
+
+        return parent_node;
+    }
+
+    /* Calls visit on the key of current_node and tells whether the walk goes on: a visitor returning bool stops it with false */
+    template<typename _Visitor>
+    static constexpr bool visit_and_continue(_Visitor& visit, node_pointer current_node)
+    {
+        if constexpr(std::is_convertible_v<std::invoke_result_t<_Visitor&, const value_type&>, bool>)
+        {
+            return static_cast<bool>(visit(std::as_const(current_node->key)));
+        }
+        else
+        {
+            visit(std::as_const(current_node->key));
+            return true;
+        }
+    }
+
+    /* Subtrees smaller than this are walked on one thread by the parallel algorithms */
+    static constexpr size_type parallel_grain = 4096;
+
+    /* Fork depth of the parallel algorithms: about eight tasks per worker on a balanced tree */
+    static unsigned parallel_depth(const task_pool& pool)
+    {
+        return static_cast<unsigned>(std::bit_width(pool.size())) + 3;
+    }
+
+    /* The parallel algorithms hand a subtree this small (or this deep) to a single task */
+    static bool walks_sequentially(node_pointer subtree_root, unsigned depth)
+    {
+        if constexpr(counts_subtrees)
+            return depth == 0 || subtree_root->get_subtree_size() < parallel_grain;
+        else
+            return depth == 0;
+    }
+
+    /*
+     * Splits the subtree onto pool: each subtree below the fork depth goes to on_subtree on one thread,
+     * and on_node sees every node above it once both of its subtrees are done.
+     */
+    template<typename _OnSubtree, typename _OnNode>
+    void fork_subtrees(node_pointer subtree_root, unsigned depth, task_pool& pool, const _OnSubtree& on_subtree, const _OnNode& on_node) const
+    {
+        if(subtree_root == nullptr)
+            return;
+
+        if(walks_sequentially(subtree_root, depth))
+        {
+            on_subtree(subtree_root);
+            return;
+        }
+
+        {
+            task_pool::task_group group(pool);
+            node_pointer right_child = subtree_root->get_right();
+            group.spawn([&, right_child] { fork_subtrees(right_child, depth - 1, pool, on_subtree, on_node); });
+            fork_subtrees(subtree_root->get_left(), depth - 1, pool, on_subtree, on_node);
+            group.wait();
+        }
+
+        on_node(subtree_root);
+    }
+
+    /* Like fork_subtrees, but joins the results of the left subtree, the node and the right subtree in that order */
+    template<typename _Result, typename _OnSubtree, typename _OnNode, typename _Reduce>
+    std::optional<_Result> fork_reduce(node_pointer subtree_root, unsigned depth, task_pool& pool, const _OnSubtree& on_subtree, const _OnNode& on_node, const _Reduce& reduce) const
+    {
+        if(subtree_root == nullptr)
+            return std::nullopt;
+
+        if(walks_sequentially(subtree_root, depth))
+            return on_subtree(subtree_root);
+
+        std::optional<_Result> right_result;
+        std::optional<_Result> result;
+        {
+            task_pool::task_group group(pool);
+            node_pointer right_child = subtree_root->get_right();
+            group.spawn([&, right_child] { right_result = fork_reduce<_Result>(right_child, depth - 1, pool, on_subtree, on_node, reduce); });
+            result = fork_reduce<_Result>(subtree_root->get_left(), depth - 1, pool, on_subtree, on_node, reduce);
+            group.wait();
+        }
+
+        result = result ? reduce(std::move(*result), on_node(subtree_root)) : on_node(subtree_root);
+        if(right_result)
+            result = reduce(std::move(*result), std::move(*right_result));
+
+        return result;
+    }
+
+    static constexpr void tree_copy(binary_search_tree& dst_tree, const binary_search_tree& src_tree)
+    {
+        dst_tree.clear();
+        dst_tree.root = dst_tree.clone_subtree(src_tree.get_root());
+    }
+
+    constexpr node_pointer clone_node(node_pointer src_node)
+    {
+        node_pointer new_node = create_node(src_node->key);
+        new_node->set_balance(src_node->get_balance());
+        new_node->occurrences = src_node->occurrences;
+        new_node->subtree_size = src_node->subtree_size;
+        return new_node;
+    }
+
+    /* Copies the shape, keys and balancing data of src_root node for node, walking both trees in lockstep */
+    constexpr node_pointer clone_subtree(node_pointer src_root)
+    {
+        if(!src_root)
+            return nullptr;
+
+        node_pointer dst_root = clone_node(src_root);
+        node_pointer src_node = src_root;
+        node_pointer dst_node = dst_root;
+        while(true)
+        {
+            if(src_node->left != nullptr && dst_node->left == nullptr)
+            {
+                dst_node->left = clone_node(src_node->left);
+                dst_node->left->link_parent(dst_node);
+                src_node = src_node->left;
+                dst_node = dst_node->left;
+            }
+            else if(src_node->right != nullptr && dst_node->right == nullptr)
+            {
+                dst_node->right = clone_node(src_node->right);
+                dst_node->right->link_parent(dst_node);
+                src_node = src_node->right;
+                dst_node = dst_node->right;
+            }
+            else if(src_node != src_root)
+            {
+                src_node = src_node->get_parent();
+                dst_node = dst_node->get_parent();
+            }
+            else
+            {
+                return dst_root;
+            }
+        }
+    }
+
+    /*
+     * Builds a perfectly balanced subtree out of the next node_count keys of a sorted sequence and returns
+     * its root. Each key is read and allocated exactly once; the recursion is only log2(node_count) deep.
+     */
+    template<typename ForwardIt>
+    constexpr node_pointer build_balanced(ForwardIt& key_iter, size_type node_count, size_type depth, size_type deepest_level, int& height)
+    {
+        if(node_count == 0)
+        {
+            height = 0;
+            return nullptr;
+        }
+
+        int left_height = 0;
+        int right_height = 0;
+        size_type left_count = (node_count - 1) / 2;
+
+        node_pointer left_child = build_balanced(key_iter, left_count, depth + 1, deepest_level, left_height);
+        node_pointer new_node = create_node(*key_iter);
+        ++key_iter;
+        node_pointer right_child = build_balanced(key_iter, node_count - 1 - left_count, depth + 1, deepest_level, right_height);
+
+        new_node->left = left_child;
+        if(left_child != nullptr)
+            left_child->link_parent(new_node);
+
+        new_node->right = right_child;
+        if(right_child != nullptr)
+            right_child->link_parent(new_node);
+
+        new_node->set_balance(_Balance::bulk_built_balance(depth, deepest_level, right_height - left_height));
+        if constexpr(counts_subtrees)
+            new_node->subtree_size = node_count;
+
+        height = 1 + std::max(left_height, right_height);
+        return new_node;
+    }
+
+    /* Whether assign_sorted can take [first, last) as it is: sorted, and outside chain without equivalent neighbours */
+    template<typename ForwardIt>
+    constexpr bool loads_in_bulk(ForwardIt first, ForwardIt last) const
+    {
+        if constexpr(duplicate_mode == duplicate_keys::chain)
+            return std::is_sorted(first, last, compare);
+        else
+            return std::adjacent_find(first, last, [this](const auto& lhs, const auto& rhs) { return !compare(lhs, rhs); }) == last;
+    }
+
+    template<typename ForwardIt>
+    constexpr void assign_sorted(ForwardIt first, size_type node_count)
+    {
+        clear();
+
+        if constexpr(requires { _Balance::bulk_built_balance(size_type(), size_type(), 0); })
+        {
+            int height = 0;
+            if(node_count != 0)
+                root = build_balanced(first, node_count, 0, std::bit_width(node_count) - 1, height);
+        }
+        else
+        {
+            for(; node_count != 0; --node_count, ++first)
+                insert(*first);
+        }
+    }
+
+    /* Puts new_node (possibly null) where old_node hangs from its parent, or in top_node when old_node has none */
+    static constexpr void replace_child(node_pointer& top_node, node_pointer old_node, node_pointer new_node)
+    {
+        node_pointer old_parent = old_node->get_parent();
+        if(!old_parent)
+            top_node = new_node;
+        else if(old_node == old_parent->left)
+            old_parent->left = new_node;
+        else
+            old_parent->right = new_node;
+
+        if(new_node != nullptr)
+            new_node->link_parent(old_parent);
+    }
+
+    /* Puts new_node (possibly null) where old_node hangs from its parent */
+    constexpr void transplant(node_pointer old_node, node_pointer new_node)
+    {
+        replace_child(root, old_node, new_node);
+    }
+
+    static constexpr void rotate_left_in(node_pointer& top_node, node_pointer pivot_node)
+    {
+        node_pointer new_top = pivot_node->right;
+        pivot_node->right = new_top->left;
+        if(new_top->left != nullptr)
+            new_top->left->link_parent(pivot_node);
+
+        replace_child(top_node, pivot_node, new_top);
+        new_top->left = pivot_node;
+        pivot_node->link_parent(new_top);
+
+        if constexpr(counts_subtrees)
+        {
+            new_top->subtree_size = pivot_node->subtree_size;
+            pivot_node->subtree_size = 1 + subtree_size_of(pivot_node->left) + subtree_size_of(pivot_node->right);
+        }
+    }
+
+    static constexpr void rotate_right_in(node_pointer& top_node, node_pointer pivot_node)
+    {
+        node_pointer new_top = pivot_node->left;
+        pivot_node->left = new_top->right;
+        if(new_top->right != nullptr)
+            new_top->right->link_parent(pivot_node);
+
+        replace_child(top_node, pivot_node, new_top);
+        new_top->right = pivot_node;
+        pivot_node->link_parent(new_top);
+
+        if constexpr(counts_subtrees)
+        {
+            new_top->subtree_size = pivot_node->subtree_size;
+            pivot_node->subtree_size = 1 + subtree_size_of(pivot_node->left) + subtree_size_of(pivot_node->right);
+        }
+    }
+
+    constexpr void link_node(node_pointer new_node)
+    {
+        link_node_below(root, new_node);
+    }
+
+    /* Inserts key as duplicate_mode asks. Outside chain the lookup comes first, so a duplicate builds no node. */
+    template<typename _Value>
+    constexpr std::pair<iterator, bool> insert_value(_Value&& key)
+    {
+        operation_probe probe(*this, counted_operation::insert);
+        if constexpr(duplicate_mode == duplicate_keys::chain)
+        {
+            node_pointer new_node = create_node(std::forward<_Value>(key));
+            link_node(new_node);
+            return {iterator(new_node, this), true};
+        }
+        else
+        {
+            insert_position position = find_unique_position(key);
+            if(position.existing_node != nullptr)
+            {
+                absorb_duplicate(position.existing_node, std::forward<_Value>(key), 1);
+                note_access(position.existing_node);
+                return {iterator(position.existing_node, this), false};
+            }
+
+            node_pointer new_node = create_node(std::forward<_Value>(key));
+            link_at(position, new_node);
+            return {iterator(new_node, this), true};
+        }
+    }
+
+    /* Same as insert_value for a node built before its key could be looked up; a node that is not linked is freed */
+    constexpr std::pair<iterator, bool> link_new_node(node_pointer new_node)
+    {
+        operation_probe probe(*this, counted_operation::insert);
+        if constexpr(duplicate_mode == duplicate_keys::chain)
+        {
+            link_node(new_node);
+        }
+        else
+        {
+            insert_position position = find_unique_position(new_node->key);
+            if(position.existing_node != nullptr)
+            {
+                try
+                {
+                    absorb_duplicate(position.existing_node, std::move(new_node->key), new_node->get_occurrences());
+                }
+                catch(...)
+                {
+                    destroy_node(new_node);
+                    throw;
+                }
+
+                destroy_node(new_node);
+                note_access(position.existing_node);
+                return {iterator(position.existing_node, this), false};
+            }
+
+            link_at(position, new_node);
+        }
+
+        return {iterator(new_node, this), true};
+    }
+
+    /* Tells a self-adjusting policy that accessed_node was just found */
+    constexpr void note_access(node_pointer accessed_node)
+    {
+        if constexpr(adjusts_on_access)
+            _Balance::after_access(*this, accessed_node);
+    }
+
+    /* Folds added_occurrences of a key equivalent to existing_node's into it: overwrite stores the key, count adds to the counter */
+    template<typename _Value>
+    constexpr void absorb_duplicate(node_pointer existing_node, _Value&& key, size_type added_occurrences)
+    {
+        if constexpr(duplicate_mode == duplicate_keys::overwrite)
+        {
+            existing_node->key = std::forward<_Value>(key);
+        }
+        else if constexpr(counts_occurrences)
+        {
+            if(added_occurrences > std::numeric_limits<std::uint32_t>::max() - existing_node->occurrences)
+                throw std::length_error("binary_search_tree::insert: too many occurrences of one key");
+
+            existing_node->occurrences += static_cast<std::uint32_t>(added_occurrences);
+        }
+    }
+
+    /* Same as link_node with the search starting at starting_node, which must be root or have a subtree the key belongs in */
+    constexpr void link_node_below(node_pointer starting_node, node_pointer new_node)
+    {
+        insert_position position{nullptr, false, nullptr};
+        node_pointer checking_node = starting_node;
+        while(checking_node != nullptr)
+        {
+            position.parent_node = checking_node;
+            position.left_side = compare(new_node->key, checking_node->key);
+            note_visit(1);
+            if(position.left_side)
+            {
+                checking_node = checking_node->get_left();
+            }
+            else
+            {
+                checking_node = checking_node->get_right();
+            }
+        }
+
+        link_at(position, new_node);
+    }
+
+    /* Unlinks erased_node and frees it */
+    constexpr void erase_node(node_pointer erased_node)
+    {
+        unlink_node(erased_node);
+        destroy_node(erased_node);
+    }
+
+    /* Unlinks erased_node by relinking its successor into its place (keys are never copied between nodes)
+       and lets the balancing policy repair the tree. The node is left detached, as a fresh node. */
+    constexpr void unlink_node(node_pointer erased_node)
+    {
+        node_pointer child;
+        node_pointer child_parent;
+        bool left_side;
+        signed char removed_balance = erased_node->get_balance();
+
+        if(!erased_node->left || !erased_node->right)
+        {
+            child = (erased_node->left != nullptr) ? erased_node->left : erased_node->right;
+            child_parent = erased_node->get_parent();
+            left_side = child_parent != nullptr && erased_node == child_parent->left;
+            transplant(erased_node, child);
+        }
+        else
+        {
+            node_pointer succ = minimum(erased_node->right);
+            removed_balance = succ->get_balance();
+            child = succ->right;
+
+            if(succ->get_parent() == erased_node)
+            {
+                child_parent = succ;
+                left_side = false;
+            }
+            else
+            {
+                child_parent = succ->get_parent();
+                left_side = true;
+                transplant(succ, succ->right);
+                succ->right = erased_node->right;
+                succ->right->link_parent(succ);
+            }
+
+            transplant(erased_node, succ);
+            succ->left = erased_node->left;
+            succ->left->link_parent(succ);
+            succ->set_balance(erased_node->get_balance());
+        }
+
+        erased_node->left = nullptr;
+        erased_node->right = nullptr;
+        erased_node->parent_and_balance = 0;
+        erased_node->subtree_size = node::single_node_size();
+
+        if constexpr(counts_subtrees)
+            refresh_subtree_sizes(child_parent);
+
+        _Balance::rebalance_after_erase(*this, child, child_parent, left_side, removed_balance);
+    }
+
+    template<typename _Key>
+    constexpr node_pointer find_node(node_pointer starting_node, const _Key& key) const
+    {
+        while(starting_node != nullptr)
+        {
+            if(compare(key, starting_node->key))
+            {
+                note_visit(1);
+                starting_node = starting_node->get_left();
+            }
+            else if(compare(starting_node->key, key))
+            {
+                note_visit(2);
+                starting_node = starting_node->get_right();
+            }
+            else
+            {
+                note_visit(2);
+                break;
+            }
+        }
+
+        return starting_node;
+    }
+
+    /* Lookups a batch operation walks together. Each round moves every one of them down one level and
+       prefetches the node it lands on, so the cache misses of the group overlap instead of queueing. */
+    static constexpr std::size_t batch_group = 16;
+
+    static constexpr void prefetch_node(node_pointer target_node)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        if(!std::is_constant_evaluated())
+            __builtin_prefetch(target_node);
+#else
+        (void)target_node;
+#endif
+    }
+
+    /* Deepest node whose subtree every key in [low_key, high_key] falls in: the top of the paths they share */
+    template<typename _Key>
+    constexpr node_pointer shared_subtree(const _Key& low_key, const _Key& high_key) const
+    {
+        node_pointer checking_node = root;
+        while(checking_node != nullptr)
+        {
+            if(compare(high_key, checking_node->key))
+                checking_node = checking_node->get_left();
+            else if(compare(checking_node->key, low_key))
+                checking_node = checking_node->get_right();
+            else
+                break;
+        }
+
+        return checking_node;
+    }
+
+    /* found[i] = find_node(root, keys[i]), walking batch_group lookups at a time. With sorted_keys
+       the keys ascend, and every group starts below the path its keys share instead of at the root.
+       gaps, when given, receives for each key not found the empty slot its lookup fell off at. */
+    template<typename _Key>
+    constexpr void find_nodes(const _Key* keys, std::size_t key_count, node_pointer* found, bool sorted_keys, insert_position* gaps = nullptr) const
+    {
+        for(std::size_t group_start = 0; group_start < key_count; group_start += batch_group)
+        {
+            const std::size_t group_size = std::min(batch_group, key_count - group_start);
+            node_pointer group_root = sorted_keys ? shared_subtree(keys[group_start], keys[group_start + group_size - 1]) : root;
+            if(group_root == nullptr && gaps != nullptr) /* The whole group falls in one gap, which the slots below root tell apart */
+                group_root = root;
+
+            node_pointer cursors[batch_group];
+            std::uint32_t pending = (std::uint32_t(1) << group_size) - 1;
+            for(std::size_t i = 0; i < group_size; ++i)
+                cursors[i] = group_root;
+
+            while(pending != 0)
+            {
+                for(std::uint32_t walking = pending; walking != 0; walking &= walking - 1)
+                {
+                    const unsigned i = static_cast<unsigned>(std::countr_zero(walking));
+                    const _Key& key = keys[group_start + i];
+                    const node_pointer parent_node = cursors[i];
+                    node_pointer checking_node = parent_node;
+                    bool left_side = false;
+                    if(checking_node != nullptr)
+                    {
+                        if(compare(key, checking_node->key))
+                        {
+                            checking_node = checking_node->get_left();
+                            left_side = true;
+                        }
+                        else if(compare(checking_node->key, key))
+                            checking_node = checking_node->get_right();
+                        else
+                        {
+                            found[group_start + i] = checking_node;
+                            pending &= ~(std::uint32_t(1) << i);
+                            continue;
+                        }
+                    }
+
+                    if(checking_node == nullptr)
+                    {
+                        found[group_start + i] = nullptr;
+                        if(gaps != nullptr)
+                            gaps[group_start + i] = insert_position{parent_node, left_side, nullptr};
+                        pending &= ~(std::uint32_t(1) << i);
+                        continue;
+                    }
+
+                    prefetch_node(checking_node);
+                    cursors[i] = checking_node;
+                }
+            }
+        }
+    }
+
+    /* Smallest subtree around last_node that a key not less than last_node's key belongs in:
+       climbs until it leaves a left subtree whose parent is greater than key */
+    template<typename _Key>
+    constexpr node_pointer climb_for(node_pointer last_node, const _Key& key) const
+    {
+        if(last_node == nullptr)
+            return root;
+
+        for(node_pointer parent_node = last_node->get_parent(); parent_node != nullptr; parent_node = last_node->get_parent())
+        {
+            if(last_node == parent_node->left && compare(key, parent_node->key))
+                break;
+            last_node = parent_node;
+        }
+
+        return last_node;
+    }
+
+    /* The group's lookups are walked together, then the nodes they found are erased. Erasing relinks nodes
+       rather than moving keys between them, so those nodes stay put through the group's erases; only a key
+       whose node an equivalent key earlier in the group already took is looked up again. */
+    template<typename _Key>
+    constexpr size_type erase_keys(const _Key* keys, std::size_t key_count, bool sorted_keys)
+    {
+        node_pointer found[batch_group];
+        size_type erased_count = 0;
+        for(std::size_t group_start = 0; group_start < key_count; group_start += batch_group)
+        {
+            const std::size_t group_size = std::min(batch_group, key_count - group_start);
+            find_nodes(keys + group_start, group_size, found, sorted_keys);
+
+            for(std::size_t i = 0; i < group_size; ++i)
+            {
+                node_pointer erased_node = found[i];
+                if(erased_node != nullptr && std::find(found, found + i, erased_node) != found + i)
+                    erased_node = found[i] = find_node(root, keys[group_start + i]);
+
+                if(erased_node != nullptr)
+                {
+                    erase_occurrence(erased_node);
+                    ++erased_count;
+                }
+            }
+        }
+
+        return erased_count;
+    }
+
+    /*
+     * Inserts a group of keys that find_nodes has looked up. Outside chain a key it found is folded into
+     * that node. A key it did not find is linked into the empty slot its lookup fell off at: the gap
+     * between two neighbouring keys, which rebalancing may move to the other neighbour but nothing else
+     * than an insert into the gap closes. A key is looked up again from the root only when its gap is
+     * no longer free: an earlier key of the group went into it, a chain duplicate went next to its
+     * equivalents and may have, or the slot has moved.
+     */
+    constexpr void insert_group(const value_type* keys, std::size_t group_size, const node_pointer* found, const insert_position* gaps)
+    {
+        insert_position filled_gaps[batch_group];
+        std::size_t filled_count = 0;
+        bool gaps_trusted = true;
+        for(std::size_t i = 0; i < group_size; ++i)
+        {
+            const value_type& key = keys[i];
+            if(found[i] != nullptr)
+            {
+                if constexpr(duplicate_mode == duplicate_keys::chain)
+                {
+                    insert_value(key);
+                    gaps_trusted = false;
+                }
+                else
+                {
+                    operation_probe probe(*this, counted_operation::insert);
+                    absorb_duplicate(found[i], key, 1);
+                    note_access(found[i]);
+                }
+                continue;
+            }
+
+            const insert_position& gap = gaps[i];
+            const bool gap_free = gaps_trusted && std::none_of(filled_gaps, filled_gaps + filled_count, [&](const insert_position& filled_gap)
+                                                               { return filled_gap.parent_node == gap.parent_node && filled_gap.left_side == gap.left_side; });
+            filled_gaps[filled_count++] = gap;
+
+            const node_pointer slot = (gap.parent_node == nullptr) ? root : gap.left_side ? gap.parent_node->get_left() : gap.parent_node->get_right();
+            if(gap_free && slot == nullptr)
+            {
+                operation_probe probe(*this, counted_operation::insert);
+                link_at(gap, create_node(key));
+            }
+            else
+            {
+                insert_value(key);
+            }
+        }
+    }
+
+    static constexpr void check_batch_output(std::size_t key_count, std::size_t found_count)
+    {
+        if(found_count < key_count)
+            throw std::length_error("binary_search_tree::search_batch: output span is shorter than the key batch");
+    }
+
+    /* First node of the subtree whose key is not less than key (greater than key when upper), or nullptr */
+    template<typename _Key>
+    constexpr node_pointer bound_node(node_pointer starting_node, const _Key& key, bool upper) const
+    {
+        node_pointer bound = nullptr;
+        while(starting_node != nullptr)
+        {
+            note_visit(1);
+            if(upper ? compare(key, starting_node->key) : !compare(starting_node->key, key))
+            {
+                bound = starting_node;
+                starting_node = starting_node->get_left();
+            }
+            else
+            {
+                starting_node = starting_node->get_right();
+            }
+        }
+
+        return bound;
+    }
+
+    /* Last node whose key is not greater than key, or nullptr */
+    template<typename _Key>
+    constexpr node_pointer floor_node(const _Key& key) const
+    {
+        node_pointer bound = nullptr;
+        for(node_pointer checking_node = root; checking_node != nullptr;)
+        {
+            if(compare(key, checking_node->key))
+            {
+                checking_node = checking_node->get_left();
+            }
+            else
+            {
+                bound = checking_node;
+                checking_node = checking_node->get_right();
+            }
+        }
+
+        return bound;
+    }
+
+    /* O(height) outside chain or with order_statistics over the whole tree, otherwise O(height + count) along the equal keys */
+    template<typename _Key>
+    constexpr unsigned count_key(node_pointer starting_node, const _Key& key) const
+    {
+        if constexpr(duplicate_mode != duplicate_keys::chain)
+        {
+            node_pointer found_node = find_node(starting_node, key);
+            return (found_node != nullptr) ? static_cast<unsigned>(found_node->get_occurrences()) : 0;
+        }
+
+        if constexpr(counts_subtrees)
+        {
+            if(starting_node == root)
+                return static_cast<unsigned>(count_before(key, true) - count_before(key, false));
+        }
+
+        unsigned counter = 0;
+        for(node_pointer current_node = bound_node(starting_node, key, false);
+            current_node != nullptr && !compare(key, current_node->key);
+            current_node = next_inorder_within(current_node, starting_node))
+        {
+            counter++;
+        }
+        return counter;
+    }
+
+    /* Calls visit on the keys in [low_key, high_key] in order; a visit returning false ends the walk */
+    template<typename _Low, typename _High, typename _Visitor>
+    constexpr void visit_keys(const _Low& low_key, const _High& high_key, _Visitor& visit) const
+    {
+        for(node_pointer current_node = bound_node(root, low_key, false);
+            current_node != nullptr && !compare(high_key, current_node->key);
+            current_node = successor(current_node))
+        {
+            if(!visit_and_continue(visit, current_node))
+                return;
+        }
+    }
+
+    /* Removes one occurrence of the key of erased_node: under duplicate_keys::count the node goes with the last one */
+    constexpr void erase_occurrence(node_pointer erased_node)
+    {
+        if constexpr(counts_occurrences)
+        {
+            if(erased_node->occurrences > 1)
+            {
+                --erased_node->occurrences;
+                return;
+            }
+        }
+
+        erase_node(erased_node);
+    }
+
+    /* Returns the node that takes the place of starting_node once the key, or with every_occurrence all of its occurrences, is gone */
+    template<typename _Key>
+    constexpr node_pointer erase_key(node_pointer starting_node, const _Key& key, bool every_occurrence = false)
+    {
+        operation_probe probe(*this, counted_operation::erase);
+        node_pointer erased_node = find_node(starting_node, key);
+        if(!erased_node)
+            return starting_node;
+
+        // Rebalancing may rotate starting_node away, so remember the slot it hangs from instead.
+        // Splaying rotates past that slot up to the root, which is then the only subtree left to go on from.
+        node_pointer anchor_node = starting_node->get_parent();
+        bool anchor_left = anchor_node != nullptr && starting_node == anchor_node->get_left();
+
+        if(every_occurrence)
+            erase_node(erased_node);
+        else
+            erase_occurrence(erased_node);
+
+        if constexpr(adjusts_on_access)
+            return root;
+
+        return (!anchor_node) ? root : (anchor_left) ? anchor_node->get_left() : anchor_node->get_right();
+    }
+
+    template<typename _Key>
+    constexpr node_pointer erase_all_keys(node_pointer starting_node, const _Key& key)
+    {
+        if constexpr(duplicate_mode != duplicate_keys::chain)
+        {
+            return erase_key(starting_node, key, true);
+        }
+        else
+        {
+            if(starting_node == root)
+            {
+                erase_equivalent(key);
+                return root;
+            }
+
+            for(unsigned counter = count_key(starting_node, key); counter != 0; counter--)
+            {
+                starting_node = erase_key(starting_node, key);
+            }
+            return starting_node;
+        }
+    }
+
+    /*
+     * Removes every key equivalent to key and returns how many there were: one O(height) removal outside
+     * chain, whatever the count; under chain one descent, then each equal key unlinked in the in-order
+     * walk, O(height + count) in all.
+     */
+    template<typename _Key>
+    constexpr size_type erase_equivalent(const _Key& key)
+    {
+        operation_probe probe(*this, counted_operation::erase);
+        if constexpr(duplicate_mode != duplicate_keys::chain)
+        {
+            node_pointer erased_node = find_node(root, key);
+            if(!erased_node)
+                return 0;
+
+            size_type erased_count = erased_node->get_occurrences();
+            erase_node(erased_node);
+            return erased_count;
+        }
+        else
+        {
+            size_type erased_count = 0;
+            node_pointer erased_node = bound_node(root, key, false);
+            while(erased_node != nullptr && !compare(key, erased_node->key))
+            {
+                /* Unlinking relinks nodes but never moves keys between them, so the successor stays valid */
+                node_pointer next_node = successor(erased_node);
+                erase_node(erased_node);
+                erased_node = next_node;
+                ++erased_count;
+            }
+
+            return erased_count;
+        }
+    }
+
+    /*
+     * A subtree cut loose from the tree (its root has no parent) and its height as the balancing policy
+     * measures it. split, join and the set operations take the tree apart into such subtrees and join
+     * them back together. The policy repairs a joined subtree through the rotate_left, rotate_right and
+     * get_root below, which never touch the tree's root, so tasks may work on disjoint subtrees at once.
+     */
+    struct detached_subtree
+    {
+        using node_pointer = typename binary_search_tree::node_pointer;
+
+        node_pointer root = nullptr;
+        int height = 0;
+
+        constexpr void rotate_left(node_pointer pivot_node)
+        {
+            rotate_left_in(root, pivot_node);
+        }
+
+        constexpr void rotate_right(node_pointer pivot_node)
+        {
+            rotate_right_in(root, pivot_node);
+        }
+
+        constexpr node_pointer get_root() const
+        {
+            return root;
+        }
+    };
+
+    /* Subtrees at least this tall have the two halves of a set operation forked onto the pool */
+    static constexpr int parallel_join_height = std::bit_width(parallel_grain);
+
+    /* Takes every node out of the tree, leaving it empty */
+    constexpr detached_subtree detach_all()
+    {
+        int height = _Balance::subtree_height(root);
+        return {std::exchange(root, nullptr), height};
+    }
+
+    /* Cuts both children off the root of subtree, which is left without links */
+    static constexpr std::pair<detached_subtree, detached_subtree> detach_children(const detached_subtree& subtree)
+    {
+        node_pointer parent_node = subtree.root;
+        detached_subtree left{parent_node->left, _Balance::child_height(parent_node, subtree.height, true)};
+        detached_subtree right{parent_node->right, _Balance::child_height(parent_node, subtree.height, false)};
+        parent_node->left = nullptr;
+        parent_node->right = nullptr;
+
+        auto cut_loose = [](detached_subtree& child)
+        {
+            if(child.root != nullptr)
+            {
+                child.root->link_parent(nullptr);
+                child.height = _Balance::detached_height(child.root, child.height);
+            }
+        };
+        cut_loose(left);
+        cut_loose(right);
+        return {left, right};
+    }
+
+    /*
+     * Joins left, middle_node and right, where no key of left is greater than middle_node's and no key of
+     * right is less. middle_node takes the place of the subtree on the inner edge of the taller side that
+     * is as tall as the shorter side, and the policy repairs the path above it, so a join costs
+     * O(|left.height - right.height|).
+     */
+    static constexpr detached_subtree join_subtrees(detached_subtree left, node_pointer middle_node, detached_subtree right)
+    {
+        const bool left_taller = left.height >= right.height;
+        const detached_subtree& taller = left_taller ? left : right;
+        const int shorter_height = left_taller ? right.height : left.height;
+
+        node_pointer spine_parent = nullptr;
+        node_pointer spine_node = taller.root;
+        int spine_height = taller.height;
+        while(!_Balance::joins_at(spine_node, spine_height, shorter_height))
+        {
+            spine_parent = spine_node;
+            spine_node = left_taller ? spine_parent->right : spine_parent->left;
+            spine_height = _Balance::child_height(spine_parent, spine_height, !left_taller);
+        }
+
+        middle_node->left = left_taller ? spine_node : left.root;
+        middle_node->right = left_taller ? right.root : spine_node;
+        if(middle_node->left != nullptr)
+            middle_node->left->link_parent(middle_node);
+
+        if(middle_node->right != nullptr)
+            middle_node->right->link_parent(middle_node);
+
+        middle_node->link_parent(spine_parent);
+        if(spine_parent != nullptr)
+            (left_taller ? spine_parent->right : spine_parent->left) = middle_node;
+
+        if constexpr(counts_subtrees)
+            refresh_subtree_sizes(middle_node);
+
+        detached_subtree joined{(spine_parent != nullptr) ? taller.root : middle_node, 0};
+        joined.height = _Balance::rebalance_after_join(joined, middle_node, left_taller ? spine_height : left.height,
+                                                       left_taller ? right.height : spine_height, taller.height);
+        return joined;
+    }
+
+    /* Links new_node, a single detached node, into subtree after the equivalent keys, as insert would */
+    constexpr detached_subtree insert_leaf(const detached_subtree& subtree, node_pointer new_node) const
+    {
+        node_pointer parent_node = nullptr;
+        bool left_side = false;
+        for(node_pointer checking_node = subtree.root; checking_node != nullptr; checking_node = left_side ? checking_node->left : checking_node->right)
+        {
+            parent_node = checking_node;
+            left_side = compare(new_node->key, checking_node->key);
+        }
+
+        if(parent_node == nullptr)
+            return join_subtrees(detached_subtree{}, new_node, detached_subtree{});
+
+        (left_side ? parent_node->left : parent_node->right) = new_node;
+        new_node->link_parent(parent_node);
+        if constexpr(counts_subtrees)
+            refresh_subtree_sizes(parent_node);
+
+        /* A leaf is joined in between two empty subtrees */
+        detached_subtree joined{subtree.root, 0};
+        joined.height = _Balance::rebalance_after_join(joined, new_node, 0, 0, subtree.height);
+        return joined;
+    }
+
+    /* Unlinks the last node of subtree and returns the rest, in O(log n) */
+    static constexpr std::pair<detached_subtree, node_pointer> split_last(const detached_subtree& subtree)
+    {
+        auto [left, right] = detach_children(subtree);
+        if(right.root == nullptr)
+            return {left, subtree.root};
+
+        auto [rest, last_node] = split_last(right);
+        return {join_subtrees(left, subtree.root, rest), last_node};
+    }
+
+    /* Joins two subtrees with no middle node, the keys of left coming first */
+    static constexpr detached_subtree concatenate(const detached_subtree& left, const detached_subtree& right)
+    {
+        if(left.root == nullptr)
+            return right;
+
+        if(right.root == nullptr)
+            return left;
+
+        auto [rest, last_node] = split_last(left);
+        return join_subtrees(rest, last_node, right);
+    }
+
+    /*
+     * Splits subtree into the nodes whose key satisfies goes_left, which must all come before the others
+     * in key order, and the others, in O(log n): the nodes on the path down to the split point are joined
+     * with the subtrees hanging off it on either side.
+     */
+    template<typename _GoesLeft>
+    static constexpr std::pair<detached_subtree, detached_subtree> split_subtree(const detached_subtree& subtree, const _GoesLeft& goes_left)
+    {
+        if(subtree.root == nullptr)
+            return {subtree, subtree};
+
+        node_pointer middle_node = subtree.root;
+        auto [left, right] = detach_children(subtree);
+        if(goes_left(std::as_const(middle_node->key)))
+        {
+            auto [lower, upper] = split_subtree(right, goes_left);
+            return {join_subtrees(left, middle_node, lower), upper};
+        }
+
+        auto [lower, upper] = split_subtree(left, goes_left);
+        return {lower, join_subtrees(upper, middle_node, right)};
+    }
+
+    /* Splits subtree into the keys less than key, the ones equivalent to it and the greater ones */
+    template<typename _Key>
+    constexpr std::tuple<detached_subtree, detached_subtree, detached_subtree> split_around(const detached_subtree& subtree, const _Key& key) const
+    {
+        auto [less, rest] = split_subtree(subtree, [&](const value_type& node_key) { return compare(node_key, key); });
+        auto [equivalent, greater] = split_subtree(rest, [&](const value_type& node_key) { return !compare(key, node_key); });
+        return {less, equivalent, greater};
+    }
+
+    /* Runs both halves of a set operation, the second on pool when one is given, depth allows and subtree is tall enough */
+    template<typename _First, typename _Second>
+    static constexpr void run_halves(task_pool* pool, unsigned depth, const detached_subtree& subtree, const _First& first_half, const _Second& second_half)
+    {
+        if(pool != nullptr && depth != 0 && subtree.height >= parallel_join_height)
+        {
+            fork_halves(*pool, first_half, second_half);
+        }
+        else
+        {
+            first_half();
+            second_half();
+        }
+    }
+
+    template<typename _First, typename _Second>
+    static void fork_halves(task_pool& pool, const _First& first_half, const _Second& second_half)
+    {
+        task_pool::task_group group(pool);
+        group.spawn([&] { second_half(); });
+        first_half();
+        group.wait();
+    }
+
+    /* Joins every node of from into into: split from around the root of into and merge the halves */
+    constexpr detached_subtree merge_subtrees(const detached_subtree& into, const detached_subtree& from, task_pool* pool, unsigned depth) const
+    {
+        if(into.root == nullptr)
+            return from;
+
+        if(from.root == nullptr)
+            return into;
+
+        /* One key left: walking it down beats splitting and joining at every level on the way */
+        if(from.root->left == nullptr && from.root->right == nullptr)
+            return insert_leaf(into, from.root);
+
+        node_pointer middle_node = into.root;
+        std::pair<detached_subtree, detached_subtree> into_halves = detach_children(into);
+        std::pair<detached_subtree, detached_subtree> from_halves =
+            split_subtree(from, [&](const value_type& node_key) { return compare(node_key, middle_node->key); });
+
+        const unsigned next_depth = (depth != 0) ? depth - 1 : 0;
+        detached_subtree left;
+        detached_subtree right;
+        run_halves(pool, depth, into,
+                   [&] { left = merge_subtrees(into_halves.first, from_halves.first, pool, next_depth); },
+                   [&] { right = merge_subtrees(into_halves.second, from_halves.second, pool, next_depth); });
+
+        return join_subtrees(left, middle_node, right);
+    }
+
+    /* Like merge_subtrees, but the nodes of from equivalent to a node of into are returned apart */
+    constexpr std::pair<detached_subtree, detached_subtree> unite_subtrees(const detached_subtree& into, const detached_subtree& from, task_pool* pool, unsigned depth) const
+    {
+        if(into.root == nullptr || from.root == nullptr)
+            return {(into.root != nullptr) ? into : from, detached_subtree{}};
+
+        if(from.root->left == nullptr && from.root->right == nullptr)
+        {
+            if(find_node(into.root, from.root->key) != nullptr)
+                return {into, from};
+
+            return {insert_leaf(into, from.root), detached_subtree{}};
+        }
+
+        node_pointer middle_node = into.root;
+        std::pair<detached_subtree, detached_subtree> into_halves = detach_children(into);
+        detached_subtree less;
+        detached_subtree equivalent;
+        detached_subtree greater;
+        std::tie(less, equivalent, greater) = split_around(from, middle_node->key);
+
+        const unsigned next_depth = (depth != 0) ? depth - 1 : 0;
+        std::pair<detached_subtree, detached_subtree> left;
+        std::pair<detached_subtree, detached_subtree> right;
+        run_halves(pool, depth, into,
+                   [&] { left = unite_subtrees(into_halves.first, less, pool, next_depth); },
+                   [&] { right = unite_subtrees(into_halves.second, greater, pool, next_depth); });
+
+        return {join_subtrees(left.first, middle_node, right.first), concatenate(concatenate(left.second, equivalent), right.second)};
+    }
+
+    /* Keeps the nodes of kept whose key is equivalent to one in the subtree of other_root, of another tree, and frees the rest */
+    constexpr detached_subtree intersect_subtrees(const detached_subtree& kept, node_pointer other_root, task_pool* pool, unsigned depth)
+    {
+        if(kept.root == nullptr)
+            return kept;
+
+        if(other_root == nullptr)
+        {
+            delete_tree(kept.root);
+            return detached_subtree{};
+        }
+
+        detached_subtree less;
+        detached_subtree equivalent;
+        detached_subtree greater;
+        std::tie(less, equivalent, greater) = split_around(kept, other_root->key);
+
+        const unsigned next_depth = (depth != 0) ? depth - 1 : 0;
+        run_halves(pool, depth, kept,
+                   [&] { less = intersect_subtrees(less, other_root->left, pool, next_depth); },
+                   [&] { greater = intersect_subtrees(greater, other_root->right, pool, next_depth); });
+
+        return concatenate(concatenate(less, equivalent), greater);
+    }
+
+    /* Frees the nodes of kept whose key is equivalent to one in the subtree of other_root, of another tree */
+    constexpr detached_subtree subtract_subtrees(const detached_subtree& kept, node_pointer other_root, task_pool* pool, unsigned depth)
+    {
+        if(kept.root == nullptr || other_root == nullptr)
+            return kept;
+
+        detached_subtree less;
+        detached_subtree equivalent;
+        detached_subtree greater;
+        std::tie(less, equivalent, greater) = split_around(kept, other_root->key);
+        delete_tree(equivalent.root);
+
+        const unsigned next_depth = (depth != 0) ? depth - 1 : 0;
+        run_halves(pool, depth, kept,
+                   [&] { less = subtract_subtrees(less, other_root->left, pool, next_depth); },
+                   [&] { greater = subtract_subtrees(greater, other_root->right, pool, next_depth); });
+
+        return concatenate(less, greater);
+    }
+
+    /* Unlinks extracted (possibly null) into a handle. Stats count the node as freed here, since the handle
+       may outlive the tree, and splice() counts it as allocated by the tree it joins. */
+    constexpr auto hand_out(node_pointer extracted)
+    {
+        if(extracted != nullptr)
+        {
+            unlink_node(extracted);
+            if constexpr(collects_stats)
+                ++counters.totals.deallocations;
+        }
+
+        return extracted_node(extracted, node_alloc);
+    }
+
+    template<typename _Key>
+    constexpr auto extract_key(const _Key& key)
+    {
+        return hand_out(find_node(root, key));
+    }
+
+    template<typename _Key>
+    constexpr binary_search_tree split_at(const _Key& key)
+    {
+        binary_search_tree upper_tree(compare);
+        upper_tree.node_alloc = node_alloc;
+
+        auto [lower, upper] = split_subtree(detach_all(), [&](const value_type& node_key) { return compare(node_key, key); });
+        root = lower.root;
+        upper_tree.root = upper.root;
+        return upper_tree;
+    }
+
+    constexpr void merge_from(binary_search_tree& other, task_pool* pool, unsigned depth)
+    {
+        if(&other == this || other.root == nullptr)
+            return;
+
+        if(!(node_alloc == other.node_alloc))
+        {
+            /* Our allocator can't free other's nodes, so the keys have to be copied over */
+            for(const value_type& key : other)
+                insert(key);
+
+            other.clear();
+            return;
+        }
+
+        root = merge_subtrees(detach_all(), other.detach_all(), pool, depth).root;
+    }
+
+    constexpr void unite_from(binary_search_tree& other, task_pool* pool, unsigned depth)
+    {
+        if(&other == this || other.root == nullptr)
+            return;
+
+        if(!(node_alloc == other.node_alloc))
+        {
+            std::vector<node_pointer> moving_nodes;
+            for(node_pointer other_node = other.minimum(); other_node != nullptr; other_node = other.successor(other_node))
+            {
+                if(find_node(root, other_node->key) == nullptr)
+                    moving_nodes.push_back(other_node);
+            }
+
+            for(node_pointer other_node : moving_nodes)
+            {
+                insert(other_node->key);
+                other.erase_node(other_node);
+            }
+            return;
+        }
+
+        auto [kept, rejected] = unite_subtrees(detach_all(), other.detach_all(), pool, depth);
+        root = kept.root;
+        other.root = rejected.root;
+    }
+
+    constexpr void intersect_with(const binary_search_tree& other, task_pool* pool, unsigned depth)
+    {
+        if(&other != this)
+            root = intersect_subtrees(detach_all(), other.root, pool, depth).root;
+    }
+
+    constexpr void subtract(const binary_search_tree& other, task_pool* pool, unsigned depth)
+    {
+        if(&other == this)
+            clear();
+        else
+            root = subtract_subtrees(detach_all(), other.root, pool, depth).root;
+    }
+
+ public:
+    constexpr binary_search_tree() : node_alloc(), compare(), root(nullptr) {}
+
+    explicit constexpr binary_search_tree(const allocator_type& alloc) : node_alloc(alloc), compare(), root(nullptr) {}
+
+    explicit constexpr binary_search_tree(const key_compare& comp, const allocator_type& alloc = allocator_type())
+        : node_alloc(alloc), compare(comp), root(nullptr) {}
+
+    explicit constexpr binary_search_tree(const value_type& root_key, const allocator_type& alloc = allocator_type())
+        : node_alloc(alloc), compare(), root(create_node(root_key)) {}
+
+    constexpr binary_search_tree(std::initializer_list<value_type> initList, const allocator_type& alloc = allocator_type())
+        : node_alloc(alloc), root(nullptr)
+    {
+        assign(initList.begin(), initList.end());
+    }
+
+    template<std::input_iterator InputIt>
+    constexpr binary_search_tree(InputIt first, InputIt last, const allocator_type& alloc = allocator_type())
+        : node_alloc(alloc), root(nullptr)
+    {
+        assign(first, last);
+    }
+
+    template<std::forward_iterator ForwardIt>
+    constexpr binary_search_tree(sorted_unique_t, ForwardIt first, ForwardIt last, const allocator_type& alloc = allocator_type())
+        : node_alloc(alloc), root(nullptr)
+    {
+        assign(sorted_unique, first, last);
+    }
+
+    virtual ~binary_search_tree()
+    {
+        clear();
+    }
+
+    constexpr binary_search_tree(const binary_search_tree& bst)
+        : node_alloc(node_traits::select_on_container_copy_construction(bst.node_alloc)), compare(bst.compare), root(nullptr) { tree_copy(*this, bst); }
+
+    constexpr binary_search_tree(binary_search_tree&& bst) noexcept
+        : node_alloc(std::move(bst.node_alloc)), compare(bst.compare), root(bst.root) { bst.root = nullptr; }
+
+    constexpr binary_search_tree& operator=(const binary_search_tree& bst)
+    {
+        if(this == &bst)
+            return *this;
+
+        compare = bst.compare;
+        tree_copy(*this, bst);
+        return *this;
+    }
+
+    constexpr binary_search_tree& operator=(binary_search_tree&& bst) noexcept(node_traits::propagate_on_container_move_assignment::value)
+    {
+        clear();
+        compare = bst.compare;
+
+        if constexpr(node_traits::propagate_on_container_move_assignment::value)
+        {
+            node_alloc = std::move(bst.node_alloc);
+        }
+        else if(!(node_alloc == bst.node_alloc))
+        {
+            /* Our allocator can't free bst's nodes, so they have to be copied over */
+            tree_copy(*this, bst);
+            bst.clear();
+            return *this;
+        }
+
+        root = bst.root;
+        bst.root = nullptr;
+        return *this;
+    }
+
+    constexpr void clear()
+    {
+        if(root != nullptr)
+        {
+            if constexpr(releases_in_bulk)
+            {
+                /* A split-off tree or an extracted node may still live in the same arena */
+                if(node_alloc.owns_arena())
+                {
+                    if constexpr(collects_stats)
+                        counters.totals.deallocations += size();
+
+                    root = nullptr;
+                    node_alloc.release();
+                    return;
+                }
+            }
+
+            delete_tree(root);
+            root = nullptr;
+        }
+    }
+
+    /*
+     * clear() with the nodes freed by the workers of pool, for trees whose teardown would otherwise keep
+     * one core busy for seconds. Falls back to clear() when the arena can drop every node at once, and
+     * when the allocator is not std::allocator, which is the only one known to be safe to call from
+     * several threads at once.
+     */
+    void parallel_clear(task_pool& pool = task_pool::shared())
+    {
+        if constexpr(releases_in_bulk || !frees_concurrently)
+        {
+            clear();
+        }
+        else
+        {
+            node_pointer old_root = std::exchange(root, nullptr);
+            fork_subtrees(old_root, parallel_depth(pool), pool,
+                          [this](node_pointer subtree_root)
+                          {
+                              /* Detach first, so that delete_tree does not touch the parent another task may be unlinking */
+                              subtree_root->link_parent(nullptr);
+                              delete_tree(subtree_root);
+                          },
+                          [this](node_pointer old_node) { destroy_node(old_node); });
+        }
+    }
+
+    /*
+     * Replaces the contents with the keys in [first, last). A sorted forward range (strictly ascending
+     * outside duplicate_keys::chain) is bulk-loaded into a perfectly balanced tree in O(n); anything else
+     * is inserted key by key.
+     */
+    template<std::input_iterator InputIt>
+    constexpr void assign(InputIt first, InputIt last)
+    {
+        if constexpr(std::forward_iterator<InputIt>)
+        {
+            if(loads_in_bulk(first, last))
+            {
+                assign_sorted(first, static_cast<size_type>(std::distance(first, last)));
+                return;
+            }
+        }
+
+        clear();
+        for(; first != last; ++first)
+            insert(*first);
+    }
+
+    /* Same as above for a range the caller knows to be sorted; the order is not checked */
+    template<std::forward_iterator ForwardIt>
+    constexpr void assign(sorted_unique_t, ForwardIt first, ForwardIt last)
+    {
+        assign_sorted(first, static_cast<size_type>(std::distance(first, last)));
+    }
+
+    constexpr allocator_type get_allocator() const
+    {
+        return allocator_type(node_alloc);
+    }
+
+    constexpr key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    /* Copies the keys into a contiguous read-only snapshot laid out for fast lookups (see frozen_bst) */
+    frozen_bst<value_type, key_compare> freeze() const
+    {
+        return frozen_bst<value_type, key_compare>(cbegin(), size(), compare);
+    }
+
+    /* Writes the keys to path as a snapshot (see bst_io.hpp). Throws std::runtime_error when the file cannot be written. */
+    void save(const std::filesystem::path& path) const requires std::is_trivially_copyable_v<value_type>
+    {
+        write_snapshot(path, freeze());
+    }
+
+    /*
+     * Replaces the contents with a snapshot written by save(), bulk-loaded in O(n) straight from the
+     * mapped file. Throws std::runtime_error, leaving the tree as it was, when the file is not a valid
+     * snapshot of value_type keys or its keys are out of order for this tree's comparison.
+     */
+    void load(const std::filesystem::path& path) requires std::is_trivially_copyable_v<value_type>
+    {
+        mapped_bst<value_type, key_compare> snapshot(path, snapshot_check::full, compare);
+
+        /* One walk checks the order and, outside chain, finds the equivalent neighbours that rule out bulk loading */
+        bool bulk_loadable = true;
+        if(!snapshot.empty())
+        {
+            auto previous_key = snapshot.begin();
+            for(auto next_key = std::next(previous_key); next_key != snapshot.end(); previous_key = next_key++)
+            {
+                if(compare(*next_key, *previous_key))
+                    throw std::runtime_error("bst: " + path.string() + " is not ordered by this tree's comparison");
+
+                if constexpr(duplicate_mode != duplicate_keys::chain)
+                    bulk_loadable = bulk_loadable && compare(*previous_key, *next_key);
+            }
+        }
+
+        if(bulk_loadable)
+        {
+            assign_sorted(snapshot.begin(), snapshot.size());
+        }
+        else
+        {
+            clear();
+            for(const value_type& key : snapshot)
+                insert(key);
+        }
+    }
+
+    constexpr void set_root(const value_type& key)
+    {
+        if(root != nullptr)
+            clear();
+
+        root = create_node(key);
+    }
+
+    constexpr node_pointer get_root() const
+    {
+        return root;
+    }
+
+    constexpr unsigned count(node_pointer starting_node, const value_type& key) const
+    {
+        return count_key(starting_node, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr unsigned count(node_pointer starting_node, const _Key& key) const
+    {
+        return count_key(starting_node, key);
+    }
+
+    constexpr unsigned count(const value_type& key) const
+    {
+        return count_key(root, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr unsigned count(const _Key& key) const
+    {
+        return count_key(root, key);
+    }
+
+    constexpr unsigned count(node_pointer starting_node) const
+    {
+        if constexpr(counts_subtrees)
+            return subtree_size_of(starting_node);
+        else
+            return count_if(starting_node, [](const value_type&) { return true; });
+    }
+
+    constexpr unsigned count() const
+    {
+        return count(root);
+    }
+
+    /* O(1) with order_statistics, a full count otherwise */
+    constexpr size_type size() const
+    {
+        if constexpr(counts_subtrees)
+            return subtree_size_of(root);
+        else
+            return count(root);
+    }
+
+    constexpr bool empty() const
+    {
+        return root == nullptr;
+    }
+
+    /* Height, depths and nodes per level, measured in one O(n) walk along the parent links without recursion */
+    tree_shape shape_report() const
+    {
+        tree_shape shape;
+        std::size_t depth_sum = 0;
+        std::size_t depth = 0;
+        node_pointer current_node = root;
+        while(current_node != nullptr)
+        {
+            if(shape.level_counts.size() == depth)
+                shape.level_counts.push_back(0);
+            ++shape.level_counts[depth];
+            ++shape.node_count;
+            depth_sum += depth;
+
+            if(current_node->get_left() != nullptr || current_node->get_right() != nullptr)
+            {
+                current_node = (current_node->get_left() != nullptr) ? current_node->get_left() : current_node->get_right();
+                ++depth;
+                continue;
+            }
+
+            /* Climb to the nearest ancestor entered from the left whose right subtree is still to come; its right child is at the same depth */
+            node_pointer parent_node = current_node->get_parent();
+            while(parent_node != nullptr && (current_node == parent_node->get_right() || parent_node->get_right() == nullptr))
+            {
+                current_node = parent_node;
+                parent_node = current_node->get_parent();
+                --depth;
+            }
+
+            current_node = (parent_node != nullptr) ? parent_node->get_right() : nullptr;
+        }
+
+        shape.height = shape.level_counts.size();
+        if(shape.node_count != 0)
+        {
+            shape.average_depth = static_cast<double>(depth_sum) / static_cast<double>(shape.node_count);
+            shape.balance_factor = static_cast<double>(shape.height) / static_cast<double>(std::bit_width(shape.node_count));
+        }
+
+        return shape;
+    }
+
+    /* What an instrumented tree has counted since it was built or its stats were reset */
+    constexpr const tree_stats& stats() const requires collects_stats
+    {
+        return counters.totals;
+    }
+
+    constexpr void reset_stats() requires collects_stats
+    {
+        counters.totals = tree_stats();
+    }
+
+    /* Number of keys smaller than key */
+    constexpr size_type rank(const value_type& key) const requires counts_subtrees
+    {
+        return count_before(key, false);
+    }
+
+    template<typename _Key> requires counts_subtrees && transparent_compare
+    constexpr size_type rank(const _Key& key) const
+    {
+        return count_before(key, false);
+    }
+
+    /* The node holding the k-th smallest key (counting from 0), or nullptr when k >= size() */
+    constexpr node_pointer select(size_type k) const requires counts_subtrees
+    {
+        node_pointer checking_node = root;
+        while(checking_node != nullptr)
+        {
+            size_type left_size = subtree_size_of(checking_node->get_left());
+            if(k < left_size)
+            {
+                checking_node = checking_node->get_left();
+            }
+            else if(k == left_size)
+            {
+                return checking_node;
+            }
+            else
+            {
+                k -= left_size + 1;
+                checking_node = checking_node->get_right();
+            }
+        }
+
+        return nullptr;
+    }
+
+    /* Number of keys in [low_key, high_key] */
+    constexpr size_type count_range(const value_type& low_key, const value_type& high_key) const requires counts_subtrees
+    {
+        if(compare(high_key, low_key))
+            return 0;
+
+        return count_before(high_key, true) - count_before(low_key, false);
+    }
+
+    template<typename _Low, typename _High> requires counts_subtrees && transparent_compare
+    constexpr size_type count_range(const _Low& low_key, const _High& high_key) const
+    {
+        size_type up_to_high = count_before(high_key, true);
+        size_type below_low = count_before(low_key, false);
+        return (up_to_high > below_low) ? up_to_high - below_low : 0;
+    }
+
+    template<typename Predicate> constexpr unsigned count_if(node_pointer starting_node, Predicate pred) const
+    {
+        unsigned counter = 0;
+        for(node_pointer current_node = minimum(starting_node); current_node != nullptr; current_node = next_inorder_within(current_node, starting_node))
+        {
+            if(pred(current_node->key))
+                counter++;
+        }
+
+        return counter;
+    }
+
+    template<typename Predicate> constexpr unsigned count_if(Predicate pred) const
+    {
+        return count_if(root, pred);
+    }
+
+    /*
+     * Parallel whole-tree scans. The tree is split at subtree boundaries onto the workers of pool, each
+     * subtree below the fork depth being walked on one thread. The tree must not change until they return,
+     * and pred, visit, reduce and transform are called from several threads at once.
+     */
+    template<typename Predicate>
+    size_type parallel_count_if(Predicate pred, task_pool& pool = task_pool::shared()) const
+    {
+        return parallel_reduce(size_type(0), std::plus<size_type>(),
+                               [&pred](const value_type& key) -> size_type { return pred(key) ? 1 : 0; }, pool);
+    }
+
+    size_type parallel_count(task_pool& pool = task_pool::shared()) const
+    {
+        if constexpr(counts_subtrees)
+            return size();
+        else
+            return parallel_count_if([](const value_type&) { return true; }, pool);
+    }
+
+    /* Calls visit(key) once for every key, in no particular order */
+    template<typename _Visitor>
+    void parallel_for_each(_Visitor visit, task_pool& pool = task_pool::shared()) const
+    {
+        fork_subtrees(root, parallel_depth(pool), pool,
+                      [this, &visit](node_pointer subtree_root)
+                      {
+                          for(node_pointer current_node = minimum(subtree_root); current_node != nullptr; current_node = next_inorder_within(current_node, subtree_root))
+                              visit(std::as_const(current_node->key));
+                      },
+                      [&visit](node_pointer current_node) { visit(std::as_const(current_node->key)); });
+    }
+
+    /*
+     * Folds transform(key) over every key with reduce, starting from init. Keys are joined in key order,
+     * so reduce must be associative but need not be commutative.
+     */
+    template<typename _Result, typename _Reduce, typename _Transform> requires std::invocable<_Transform&, const value_type&>
+    _Result parallel_reduce(_Result init, _Reduce reduce, _Transform transform, task_pool& pool = task_pool::shared()) const
+    {
+        auto on_subtree = [&](node_pointer subtree_root) -> _Result
+        {
+            node_pointer current_node = minimum(subtree_root);
+            _Result result = transform(std::as_const(current_node->key));
+            while((current_node = next_inorder_within(current_node, subtree_root)) != nullptr)
+                result = reduce(std::move(result), transform(std::as_const(current_node->key)));
+
+            return result;
+        };
+        auto on_node = [&](node_pointer current_node) -> _Result { return transform(std::as_const(current_node->key)); };
+
+        std::optional<_Result> result = fork_reduce<_Result>(root, parallel_depth(pool), pool, on_subtree, on_node, reduce);
+        return result ? reduce(std::move(init), std::move(*result)) : init;
+    }
+
+    template<typename _Result, typename _Reduce>
+    _Result parallel_reduce(_Result init, _Reduce reduce, task_pool& pool = task_pool::shared()) const
+    {
+        return parallel_reduce(std::move(init), reduce, [](const value_type& key) -> _Result { return key; }, pool);
+    }
+
+    /*
+     * Visitor walks: visit(key) is called on each key under starting_node (or the whole tree) with a const
+     * reference, and if it returns bool, false ends the walk. The walks follow the parent links instead of
+     * recursing or keeping a stack, and neither the keys nor the visitor are copied.
+     */
+    template<typename _Visitor>
+    constexpr void for_each_inorder(node_pointer starting_node, _Visitor&& visit) const
+    {
+        for(node_pointer current_node = minimum(starting_node); current_node != nullptr; current_node = next_inorder_within(current_node, starting_node))
+        {
+            if(!visit_and_continue(visit, current_node))
+                return;
+        }
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_inorder(_Visitor&& visit) const
+    {
+        for_each_inorder(root, visit);
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_preorder(node_pointer starting_node, _Visitor&& visit) const
+    {
+        for(node_pointer current_node = starting_node; current_node != nullptr; current_node = next_preorder_within(current_node, starting_node))
+        {
+            if(!visit_and_continue(visit, current_node))
+                return;
+        }
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_preorder(_Visitor&& visit) const
+    {
+        for_each_preorder(root, visit);
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_postorder(node_pointer starting_node, _Visitor&& visit) const
+    {
+        for(node_pointer current_node = first_postorder(starting_node); current_node != nullptr; current_node = next_postorder_within(current_node, starting_node))
+        {
+            if(!visit_and_continue(visit, current_node))
+                return;
+        }
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_postorder(_Visitor&& visit) const
+    {
+        for_each_postorder(root, visit);
+    }
+
+    /* Breadth-first queue of for_each_levelorder. Passing the same one to every walk reuses its storage. */
+    using level_order_queue = std::vector<node_pointer>;
+
+    /* Level by level from starting_node, left to right within a level. queue holds at most two levels at a time. */
+    template<typename _Visitor>
+    constexpr void for_each_levelorder(node_pointer starting_node, _Visitor&& visit, level_order_queue& queue) const
+    {
+        queue.clear();
+        if(starting_node != nullptr)
+            queue.push_back(starting_node);
+
+        while(!queue.empty())
+        {
+            const std::size_t level_size = queue.size();
+            for(std::size_t index = 0; index < level_size; ++index)
+            {
+                node_pointer current_node = queue[index];
+                if(!visit_and_continue(visit, current_node))
+                {
+                    queue.clear();
+                    return;
+                }
+
+                if(current_node->get_left() != nullptr)
+                    queue.push_back(current_node->get_left());
+                if(current_node->get_right() != nullptr)
+                    queue.push_back(current_node->get_right());
+            }
+
+            queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(level_size));
+        }
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_levelorder(_Visitor&& visit, level_order_queue& queue) const
+    {
+        for_each_levelorder(root, visit, queue);
+    }
+
+    template<typename _Visitor>
+    constexpr void for_each_levelorder(_Visitor&& visit) const
+    {
+        level_order_queue queue;
+        for_each_levelorder(root, visit, queue);
+    }
+
+    /* Copies every key to out in the given order and returns the iterator past the last one written */
+    template<std::output_iterator<const _Tp&> OutputIt>
+    constexpr OutputIt copy_to(OutputIt out, traversal_order order = traversal_order::inorder) const
+    {
+        auto write = [&out](const value_type& key)
+        {
+            *out = key;
+            ++out;
+        };
+
+        switch(order)
+        {
+            case traversal_order::inorder:     for_each_inorder(root, write); break;
+            case traversal_order::preorder:    for_each_preorder(root, write); break;
+            case traversal_order::postorder:   for_each_postorder(root, write); break;
+            case traversal_order::level_order: for_each_levelorder(write); break;
+        }
+
+        return out;
+    }
+
+    /* Writes the keys under pivot_node to out, each followed by two spaces */
+    void inorder_traversal(node_pointer pivot_node, std::ostream& out = std::cout) const
+    {
+        for_each_inorder(pivot_node, [&out](const value_type& key) { out << key << "  "; });
+    }
+
+    void inorder_traversal(std::ostream& out = std::cout) const
+    {
+        inorder_traversal(root, out);
+    }
+
+    void preorder_traversal(node_pointer pivot_node, std::ostream& out = std::cout) const
+    {
+        for_each_preorder(pivot_node, [&out](const value_type& key) { out << key << "  "; });
+    }
+
+    void preorder_traversal(std::ostream& out = std::cout) const
+    {
+        preorder_traversal(root, out);
+    }
+
+    void postorder_traversal(node_pointer pivot_node, std::ostream& out = std::cout) const
+    {
+        for_each_postorder(pivot_node, [&out](const value_type& key) { out << key << "  "; });
+    }
+
+    void postorder_traversal(std::ostream& out = std::cout) const
+    {
+        postorder_traversal(root, out);
+    }
+
+    constexpr node_pointer search(node_pointer starting_node, const value_type& key) const
+    {
+        operation_probe probe(*this, counted_operation::search);
+        return find_node(starting_node, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer search(node_pointer starting_node, const _Key& key) const
+    {
+        operation_probe probe(*this, counted_operation::search);
+        return find_node(starting_node, key);
+    }
+
+    constexpr node_pointer search(const value_type& key) const
+    {
+        operation_probe probe(*this, counted_operation::search);
+        return find_node(root, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer search(const _Key& key) const
+    {
+        operation_probe probe(*this, counted_operation::search);
+        return find_node(root, key);
+    }
+
+    /* Under a self-adjusting policy a search through a non-const tree also moves the node it finds up;
+       the const overloads above leave the shape alone, so concurrent readers may still share the tree */
+    constexpr node_pointer search(const value_type& key) requires adjusts_on_access
+    {
+        node_pointer found_node = std::as_const(*this).search(key);
+        if(found_node != nullptr)
+            note_access(found_node);
+        return found_node;
+    }
+
+    template<typename _Key> requires transparent_compare && adjusts_on_access
+    constexpr node_pointer search(const _Key& key)
+    {
+        node_pointer found_node = std::as_const(*this).search(key);
+        if(found_node != nullptr)
+            note_access(found_node);
+        return found_node;
+    }
+
+    /* found[i] = search(keys[i]) for every key. The lookups run batch_group at a time, interleaved level by
+       level with prefetching, so one lookup's cache miss overlaps the others'. found must be at least as long as keys. */
+    constexpr void search_batch(std::span<const value_type> keys, std::span<node_pointer> found) const
+    {
+        check_batch_output(keys.size(), found.size());
+        find_nodes(keys.data(), keys.size(), found.data(), false);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr void search_batch(std::span<const _Key> keys, std::span<node_pointer> found) const
+    {
+        check_batch_output(keys.size(), found.size());
+        find_nodes(keys.data(), keys.size(), found.data(), false);
+    }
+
+    /* Keys in ascending order: each group of lookups starts where their paths part instead of at the root */
+    constexpr void search_batch(sorted_equivalent_t, std::span<const value_type> keys, std::span<node_pointer> found) const
+    {
+        check_batch_output(keys.size(), found.size());
+        find_nodes(keys.data(), keys.size(), found.data(), true);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr void search_batch(sorted_equivalent_t, std::span<const _Key> keys, std::span<node_pointer> found) const
+    {
+        check_batch_output(keys.size(), found.size());
+        find_nodes(keys.data(), keys.size(), found.data(), true);
+    }
+
+    /* The first node whose key is not less than key, or nullptr */
+    constexpr node_pointer lower_bound(const value_type& key) const
+    {
+        return bound_node(root, key, false);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer lower_bound(const _Key& key) const
+    {
+        return bound_node(root, key, false);
+    }
+
+    /* The first node whose key is greater than key, or nullptr */
+    constexpr node_pointer upper_bound(const value_type& key) const
+    {
+        return bound_node(root, key, true);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer upper_bound(const _Key& key) const
+    {
+        return bound_node(root, key, true);
+    }
+
+    /* The nodes holding keys equivalent to key, from first up to (not including) second; nullptr ends the tree */
+    constexpr std::pair<node_pointer, node_pointer> equal_range(const value_type& key) const
+    {
+        return {bound_node(root, key, false), bound_node(root, key, true)};
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr std::pair<node_pointer, node_pointer> equal_range(const _Key& key) const
+    {
+        return {bound_node(root, key, false), bound_node(root, key, true)};
+    }
+
+    /* The node with the greatest key not greater than key (the last of equal keys), or nullptr */
+    constexpr node_pointer floor(const value_type& key) const
+    {
+        return floor_node(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer floor(const _Key& key) const
+    {
+        return floor_node(key);
+    }
+
+    /* The node with the smallest key not less than key (the first of equal keys), or nullptr */
+    constexpr node_pointer ceil(const value_type& key) const
+    {
+        return bound_node(root, key, false);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer ceil(const _Key& key) const
+    {
+        return bound_node(root, key, false);
+    }
+
+    /* Calls visit(key) on every key in [low_key, high_key] in ascending order, without touching the
+       subtrees outside the range: O(height + keys visited). If visit returns bool, false stops the walk. */
+    template<typename _Visitor>
+    constexpr void visit_range(const value_type& low_key, const value_type& high_key, _Visitor&& visit) const
+    {
+        visit_keys(low_key, high_key, visit);
+    }
+
+    template<typename _Low, typename _High, typename _Visitor> requires transparent_compare
+    constexpr void visit_range(const _Low& low_key, const _High& high_key, _Visitor&& visit) const
+    {
+        visit_keys(low_key, high_key, visit);
+    }
+
+    constexpr node_pointer minimum(node_pointer starting_node) const
+    {
+        if(!starting_node)
+            return nullptr;
+
+        while(starting_node->get_left() != nullptr)
+        {
+            starting_node = starting_node->get_left();
+        }
+
+        return starting_node;
+    }
+
+    constexpr node_pointer minimum() const
+    {
+        return minimum(root);
+    }
+
+    constexpr node_pointer maximum(node_pointer starting_node) const
+    {
+        if(!starting_node)
+            return nullptr;
+
+        while(starting_node->get_right() != nullptr)
+        {
+            starting_node = starting_node->get_right();
+        }
+
+        return starting_node;
+    }
+
+    constexpr node_pointer maximum() const
+    {
+        return maximum(root);
+    }
+
+    constexpr node_pointer successor(node_pointer starting_node) const
+    {
+        if(!starting_node)
+        {
+            return nullptr;
+        }
+        else if(starting_node->get_right() != nullptr)
+        {
+            return minimum(starting_node->get_right());
+        }
+        else
+        {
+            node_pointer temp_node = starting_node->get_parent();
+            while(temp_node != nullptr && starting_node == temp_node->get_right())
+            {
+                starting_node = temp_node;
+                temp_node = temp_node->get_parent();
+            }
+
+            return temp_node;
+        }
+    }
+
+    constexpr node_pointer successor() const
+    {
+        return successor(root);
+    }
+
+    constexpr node_pointer predecessor(node_pointer starting_node) const
+    {
+        if(!starting_node)
+        {
+            return nullptr;
+        }
+        else if(starting_node->get_left() != nullptr)
+        {
+            return maximum(starting_node->get_left());
+        }
+        else
+        {
+            node_pointer temp_node = starting_node->get_parent();
+            while(temp_node != nullptr && starting_node == temp_node->get_left())
+            {
+                starting_node = temp_node;
+                temp_node = temp_node->get_parent();
+            }
+
+            return temp_node;
+        }
+    }
+
+    constexpr node_pointer predecessor() const
+    {
+        return predecessor(root);
+    }
+
+    constexpr iterator begin()
+    {
+        return iterator(minimum(), this);
+    }
+
+    constexpr const_iterator begin() const
+    {
+        return const_iterator(minimum(), this);
+    }
+
+    constexpr const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    constexpr iterator end()
+    {
+        return iterator(nullptr, this);
+    }
+
+    constexpr const_iterator end() const
+    {
+        return const_iterator(nullptr, this);
+    }
+
+    constexpr const_iterator cend() const
+    {
+        return end();
+    }
+
+    constexpr reverse_iterator rbegin()
+    {
+        return reverse_iterator(end());
+    }
+
+    constexpr const_reverse_iterator rbegin() const
+    {
+        return const_reverse_iterator(end());
+    }
+
+    constexpr const_reverse_iterator crbegin() const
+    {
+        return rbegin();
+    }
+
+    constexpr reverse_iterator rend()
+    {
+        return reverse_iterator(begin());
+    }
+
+    constexpr const_reverse_iterator rend() const
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    constexpr const_reverse_iterator crend() const
+    {
+        return rend();
+    }
+
+    /* Left rotation around pivot_node; its right child takes its place. Used by the balancing policies. */
+    constexpr void rotate_left(node_pointer pivot_node)
+    {
+        rotate_left_in(root, pivot_node);
+    }
+
+    /* Right rotation around pivot_node; its left child takes its place. Used by the balancing policies. */
+    constexpr void rotate_right(node_pointer pivot_node)
+    {
+        rotate_right_in(root, pivot_node);
+    }
+
+    /*
+     * Inserts key as duplicate_mode asks and returns the node now holding it, with false when an
+     * equivalent key was already there: the new key was then rejected, stored over the old one or
+     * counted. Under duplicate_keys::chain a node is always added.
+     */
+    constexpr std::pair<iterator, bool> insert(node inserted_node)
+    {
+        return insert_value(inserted_node.get_key());
+    }
+
+    constexpr std::pair<iterator, bool> insert(const value_type& key)
+    {
+        return insert_value(key);
+    }
+
+    constexpr std::pair<iterator, bool> insert(value_type&& key)
+    {
+        return insert_value(std::move(key));
+    }
+
+    /* Constructs the key in place from args and inserts it as insert does. Outside chain the node is built before the lookup and freed when it is not needed. */
+    template<typename... _Args>
+    constexpr std::pair<iterator, bool> emplace(_Args&&... args)
+    {
+        return link_new_node(create_node(std::forward<_Args>(args)...));
+    }
+
+    /* Inserts every key, batch_group at a time: the group's insert paths are walked together as in
+       search_batch, and each key then goes where its walk ended (see insert_group). Keys inserted
+       before an exception stay. */
+    constexpr void insert_batch(std::span<const value_type> keys)
+    {
+        node_pointer found[batch_group];
+        insert_position gaps[batch_group];
+        for(std::size_t group_start = 0; group_start < keys.size(); group_start += batch_group)
+        {
+            const std::size_t group_size = std::min(batch_group, keys.size() - group_start);
+            find_nodes(keys.data() + group_start, group_size, found, false, gaps);
+            insert_group(keys.data() + group_start, group_size, found, gaps);
+        }
+    }
+
+    /* Keys in ascending order: groups are walked from where their paths part. Under chain each insert
+       starts from the previously inserted node rather than the root. A key that sorts before the successor
+       of the previous node hangs straight off that node when its right slot is free, so appending to the
+       maximum takes O(1) before rebalancing, even on an unbalanced tree that degenerates into a chain.
+       Outside chain each group goes in as insert_group places it. */
+    constexpr void insert_batch(sorted_equivalent_t, std::span<const value_type> keys)
+    {
+        node_pointer found[batch_group];
+        if constexpr(duplicate_mode != duplicate_keys::chain)
+        {
+            insert_position gaps[batch_group];
+            for(std::size_t group_start = 0; group_start < keys.size(); group_start += batch_group)
+            {
+                const std::size_t group_size = std::min(batch_group, keys.size() - group_start);
+                find_nodes(keys.data() + group_start, group_size, found, true, gaps);
+                insert_group(keys.data() + group_start, group_size, found, gaps);
+            }
+        }
+        else
+        {
+            node_pointer last_node = nullptr;
+            node_pointer next_node = nullptr; /* successor(last_node); rotations keep it, since they keep the order */
+            for(std::size_t group_start = 0; group_start < keys.size(); group_start += batch_group)
+            {
+                const std::size_t group_size = std::min(batch_group, keys.size() - group_start);
+                const bool group_appends = last_node != nullptr && (next_node == nullptr || compare(keys[group_start + group_size - 1], next_node->key));
+                if(!group_appends)
+                    find_nodes(keys.data() + group_start, group_size, found, true);
+
+                for(std::size_t i = 0; i < group_size; ++i)
+                {
+                    const value_type& key = keys[group_start + i];
+                    node_pointer new_node = create_node(key);
+                    if(last_node != nullptr && last_node->get_right() == nullptr && (next_node == nullptr || compare(key, next_node->key)))
+                    {
+                        link_at(insert_position{last_node, false, nullptr}, new_node);
+                    }
+                    else
+                    {
+                        link_node_below(climb_for(last_node, key), new_node);
+                        next_node = successor(new_node);
+                    }
+                    last_node = new_node;
+                }
+            }
+        }
+    }
+
+    /* Removes one key equivalent to each of keys, as delete_node would, walking groups together first as
+       insert_batch does. Returns the number of keys removed. */
+    constexpr size_type erase_batch(std::span<const value_type> keys)
+    {
+        return erase_keys(keys.data(), keys.size(), false);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr size_type erase_batch(std::span<const _Key> keys)
+    {
+        return erase_keys(keys.data(), keys.size(), false);
+    }
+
+    /* Keys in ascending order: each group's paths are walked from where they part */
+    constexpr size_type erase_batch(sorted_equivalent_t, std::span<const value_type> keys)
+    {
+        return erase_keys(keys.data(), keys.size(), true);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr size_type erase_batch(sorted_equivalent_t, std::span<const _Key> keys)
+    {
+        return erase_keys(keys.data(), keys.size(), true);
+    }
+
+    /* Removes the key at position, with all its occurrences, and returns the iterator following it */
+    constexpr iterator erase(const_iterator position)
+    {
+        node_pointer next_node = successor(position.current);
+        erase_node(position.current);
+        return iterator(next_node, this);
+    }
+
+    /* Removes every key equivalent to key, counting each occurrence, and returns how many were removed (see erase_equivalent) */
+    constexpr size_type erase(const value_type& key)
+    {
+        return erase_equivalent(key);
+    }
+
+    template<typename _Key> requires transparent_compare && (!std::is_convertible_v<const _Key&, const_iterator>)
+    constexpr size_type erase(const _Key& key)
+    {
+        return erase_equivalent(key);
+    }
+
+    /* Returns the node that takes the place of starting_node once the key is gone */
+    constexpr node_pointer delete_node(node_pointer starting_node, const value_type& key)
+    {
+        return erase_key(starting_node, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer delete_node(node_pointer starting_node, const _Key& key)
+    {
+        return erase_key(starting_node, key);
+    }
+
+    constexpr node_pointer delete_node(const value_type& key)
+    {
+        return erase_key(root, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer delete_node(const _Key& key)
+    {
+        return erase_key(root, key);
+    }
+
+    constexpr node_pointer delete_all_node(node_pointer starting_node, const value_type& key)
+    {
+        return erase_all_keys(starting_node, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer delete_all_node(node_pointer starting_node, const _Key& key)
+    {
+        return erase_all_keys(starting_node, key);
+    }
+
+    constexpr node_pointer delete_all_node(const value_type& key)
+    {
+        return erase_all_keys(root, key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr node_pointer delete_all_node(const _Key& key)
+    {
+        return erase_all_keys(root, key);
+    }
+
+    /*
+     * A node taken out of a tree by extract(). It owns the key, which may be changed here (unlike
+     * through an iterator), until splice() links the node into a tree; otherwise it is freed with the
+     * handle.
+     */
+    class extracted_node
+    {
+        friend class binary_search_tree;
+
+     public:
+        constexpr extracted_node() = default;
+
+        constexpr extracted_node(extracted_node&& other) noexcept
+            : held_node(std::exchange(other.held_node, nullptr)), node_alloc(other.node_alloc) {}
+
+        constexpr extracted_node& operator=(extracted_node&& other) noexcept
+        {
+            if(this != &other)
+            {
+                reset();
+                held_node = std::exchange(other.held_node, nullptr);
+                node_alloc = other.node_alloc;
+            }
+            return *this;
+        }
+
+        ~extracted_node()
+        {
+            reset();
+        }
+
+        constexpr bool empty() const
+        {
+            return held_node == nullptr;
+        }
+
+        explicit constexpr operator bool() const
+        {
+            return held_node != nullptr;
+        }
+
+        constexpr value_type& value() const
+        {
+            return held_node->key;
+        }
+
+     private:
+        node_pointer held_node = nullptr;
+        [[no_unique_address]] node_allocator_type node_alloc;
+
+        constexpr extracted_node(node_pointer held_node, const node_allocator_type& node_alloc) : held_node(held_node), node_alloc(node_alloc) {}
+
+        constexpr void reset()
+        {
+            if(held_node != nullptr)
+            {
+                node_traits::destroy(node_alloc, held_node);
+                node_traits::deallocate(node_alloc, std::exchange(held_node, nullptr), 1);
+            }
+        }
+    };
+
+    /* Unlinks the node at position without freeing it */
+    constexpr extracted_node extract(const_iterator position)
+    {
+        return hand_out(position.current);
+    }
+
+    /* Extracts a node holding a key equivalent to key, or returns an empty handle */
+    constexpr extracted_node extract(const value_type& key)
+    {
+        return extract_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare && (!std::is_convertible_v<const _Key&, const_iterator>)
+    constexpr extracted_node extract(const _Key& key)
+    {
+        return extract_key(key);
+    }
+
+    /*
+     * Links the node held by handle into the tree as insert would and returns the same pair, or end()
+     * for an empty handle. Under duplicate_keys::reject a node whose key is already present stays in
+     * handle. A node extracted from a tree with another allocator has its key moved into a new node
+     * instead.
+     */
+    constexpr std::pair<iterator, bool> splice(extracted_node&& handle)
+    {
+        if(handle.empty())
+            return {end(), false};
+
+        if constexpr(duplicate_mode == duplicate_keys::reject)
+        {
+            if(node_pointer existing_node = find_node(root, handle.held_node->key))
+                return {iterator(existing_node, this), false};
+        }
+
+        node_pointer new_node;
+        if(node_alloc == handle.node_alloc)
+        {
+            new_node = std::exchange(handle.held_node, nullptr);
+            if constexpr(collects_stats)
+                ++counters.totals.allocations;
+        }
+        else
+        {
+            new_node = create_node(std::move(handle.held_node->key));
+            new_node->occurrences = handle.held_node->occurrences;
+            handle.reset();
+        }
+
+        return link_new_node(new_node);
+    }
+
+    /*
+     * Moves the keys not less than key into the returned tree, which shares this tree's allocator, and
+     * keeps the smaller ones, in O(log n). Nodes are relinked, never copied.
+     */
+    constexpr binary_search_tree split(const value_type& key) requires joins_subtrees
+    {
+        return split_at(key);
+    }
+
+    template<typename _Key> requires joins_subtrees && transparent_compare
+    constexpr binary_search_tree split(const _Key& key)
+    {
+        return split_at(key);
+    }
+
+    /*
+     * Appends the keys of right, none of which may be less than a key of this tree (this is not
+     * checked), in O(log n) and leaves right empty. When the allocators differ the keys are copied.
+     */
+    constexpr void join(binary_search_tree&& right) requires joins_subtrees
+    {
+        if(&right == this || right.root == nullptr)
+            return;
+
+        if(!(node_alloc == right.node_alloc))
+        {
+            for(const value_type& key : right)
+                insert(key);
+
+            right.clear();
+            return;
+        }
+
+        root = concatenate(detach_all(), right.detach_all()).root;
+    }
+
+    /*
+     * Set operations built on split and join. For trees of m and n keys, m <= n, each takes
+     * O(m log(n/m + 1)) rather than the O(m log n) of inserting or erasing key by key, and relinks nodes
+     * instead of copying keys. Nodes only move between trees sharing an allocator; from any other tree
+     * merge and union_with copy the keys. The comparison must not throw.
+     */
+
+    /* Moves every node of other into this tree, after the equivalent keys already here. The other modes use union_with. */
+    constexpr void merge(binary_search_tree& other) requires joins_subtrees && (duplicate_mode == duplicate_keys::chain)
+    {
+        merge_from(other, nullptr, 0);
+    }
+
+    /* Moves the nodes of other whose key is not equivalent to a key of this tree; the others stay in other */
+    constexpr void union_with(binary_search_tree& other) requires joins_subtrees
+    {
+        unite_from(other, nullptr, 0);
+    }
+
+    /* Removes the keys that are not equivalent to a key of other */
+    constexpr void intersect(const binary_search_tree& other) requires joins_subtrees
+    {
+        intersect_with(other, nullptr, 0);
+    }
+
+    /* Removes the keys equivalent to a key of other */
+    constexpr void difference(const binary_search_tree& other) requires joins_subtrees
+    {
+        subtract(other, nullptr, 0);
+    }
+
+    /*
+     * The set operations with the two halves left by every split of a large subtree handled by different
+     * workers of pool. parallel_intersect and parallel_difference free nodes as they go, so they run on the
+     * calling thread unless the allocator is std::allocator, like parallel_clear.
+     */
+    void parallel_merge(binary_search_tree& other, task_pool& pool = task_pool::shared()) requires joins_subtrees && (duplicate_mode == duplicate_keys::chain)
+    {
+        merge_from(other, collects_stats ? nullptr : &pool, parallel_depth(pool));
+    }
+
+    void parallel_union_with(binary_search_tree& other, task_pool& pool = task_pool::shared()) requires joins_subtrees
+    {
+        unite_from(other, collects_stats ? nullptr : &pool, parallel_depth(pool));
+    }
+
+    void parallel_intersect(const binary_search_tree& other, task_pool& pool = task_pool::shared()) requires joins_subtrees
+    {
+        intersect_with(other, frees_concurrently ? &pool : nullptr, parallel_depth(pool));
+    }
+
+    void parallel_difference(const binary_search_tree& other, task_pool& pool = task_pool::shared()) requires joins_subtrees
+    {
+        subtract(other, frees_concurrently ? &pool : nullptr, parallel_depth(pool));
+    }
+
+    constexpr void delete_tree(node_pointer root)
+    {
+        if(!root)
+            return;
+
+        /* first detach the subtree from the rest of the tree */
+        if(root->get_parent() != nullptr)
+        {
+            node_pointer root_parent = root->get_parent();
+            (root == root_parent->get_left()) ? root_parent->left = nullptr : root_parent->right = nullptr;
+            root->link_parent(nullptr);
+        }
+        else if(root == this->root)
+        {
+            this->root = nullptr;
+        }
+
+        /* then delete it in postorder: descend to a leaf, free it and resume from its parent */
+        node_pointer current_node = root;
+        while(current_node != nullptr)
+        {
+            if(current_node->left != nullptr)
+            {
+                current_node = current_node->left;
+            }
+            else if(current_node->right != nullptr)
+            {
+                current_node = current_node->right;
+            }
+            else
+            {
+                node_pointer parent_node = current_node->get_parent();
+                if(parent_node != nullptr)
+                    (current_node == parent_node->left) ? parent_node->left = nullptr : parent_node->right = nullptr;
+
+                destroy_node(current_node);
+                current_node = parent_node;
+            }
+        }
+    }
+};
+
+/*
+ * Orders the entries of a bst_map by key. It is transparent, so the underlying tree can be searched
+ * with a bare key (or anything _Compare accepts) instead of a whole entry.
+ */
+template<typename _Key, typename _Tp, typename _Compare>
+struct map_key_compare
+{
+    using is_transparent = void;
+
+    [[no_unique_address]] _Compare key_less;
+
+    static constexpr const _Key& key_of(const std::pair<const _Key, _Tp>& entry)
+    {
+        return entry.first;
+    }
+
+    template<typename _Other> static constexpr const _Other& key_of(const _Other& key)
+    {
+        return key;
+    }
+
+    template<typename _Lhs, typename _Rhs> constexpr bool operator()(const _Lhs& lhs, const _Rhs& rhs) const
+    {
+        return key_less(key_of(lhs), key_of(rhs));
+    }
+};
+
+/*
+ * Key-value map with unique keys, built on the binary_search_tree node machinery: each node holds a
+ * std::pair<const _Key, _Tp>. emplace, try_emplace and insert_or_assign construct the entry inside its
+ * node exactly once, and the accessors hand out references into the node.
+ */
+template<typename _Key, typename _Tp, typename _Balance = unbalanced_policy,
+         typename _Alloc = std::allocator<std::pair<const _Key, _Tp>>, typename _Compare = std::less<>>
+class bst_map : private binary_search_tree<std::pair<const _Key, _Tp>, _Balance, _Alloc, map_key_compare<_Key, _Tp, _Compare>>
+{
+ private:
+    using tree_type = binary_search_tree<std::pair<const _Key, _Tp>, _Balance, _Alloc, map_key_compare<_Key, _Tp, _Compare>>;
+    using typename tree_type::insert_position;
+
+    template<typename _Lookup>
+    constexpr std::pair<typename tree_type::iterator, bool> try_emplace_at(const _Lookup& key, auto&& make_node)
+    {
+        typename tree_type::operation_probe probe(*this, tree_type::counted_operation::insert);
+        insert_position position = this->find_unique_position(key);
+        if(position.existing_node != nullptr)
+            return {this->make_iterator(position.existing_node), false};
+
+        node_pointer new_node = make_node();
+        this->link_at(position, new_node);
+        return {this->make_iterator(new_node), true};
+    }
+
+ public:
+    using key_type = _Key;
+    using mapped_type = _Tp;
+    using typename tree_type::value_type;
+    using typename tree_type::size_type;
+    using typename tree_type::allocator_type;
+    using typename tree_type::node;
+    using typename tree_type::node_pointer;
+    using typename tree_type::iterator;
+    using typename tree_type::const_iterator;
+    using typename tree_type::reverse_iterator;
+    using typename tree_type::const_reverse_iterator;
+
+    using tree_type::begin;
+    using tree_type::cbegin;
+    using tree_type::end;
+    using tree_type::cend;
+    using tree_type::rbegin;
+    using tree_type::crbegin;
+    using tree_type::rend;
+    using tree_type::crend;
+    using tree_type::size;
+    using tree_type::empty;
+    using tree_type::clear;
+    using tree_type::parallel_clear;
+    using tree_type::parallel_count;
+    using tree_type::parallel_count_if;
+    using tree_type::parallel_for_each;
+    using tree_type::for_each_inorder;
+    using tree_type::for_each_preorder;
+    using tree_type::for_each_postorder;
+    using tree_type::for_each_levelorder;
+    using tree_type::copy_to;
+    using typename tree_type::level_order_queue;
+    using tree_type::parallel_reduce;
+    using tree_type::get_root;
+    using tree_type::get_allocator;
+    using tree_type::freeze;
+    using tree_type::search;
+    using tree_type::minimum;
+    using tree_type::maximum;
+    using tree_type::successor;
+    using tree_type::predecessor;
+    using tree_type::delete_node;
+    using tree_type::search_batch;
+    using tree_type::erase_batch;
+    using tree_type::floor;
+    using tree_type::ceil;
+    using tree_type::visit_range;
+    using tree_type::shape_report;
+    using tree_type::stats;
+    using tree_type::reset_stats;
+
+    constexpr bst_map() = default;
+
+    explicit constexpr bst_map(const allocator_type& alloc) : tree_type(alloc) {}
+
+    constexpr bst_map(std::initializer_list<value_type> initList, const allocator_type& alloc = allocator_type()) : tree_type(alloc)
+    {
+        insert(initList.begin(), initList.end());
+    }
+
+    template<std::input_iterator InputIt>
+    constexpr bst_map(InputIt first, InputIt last, const allocator_type& alloc = allocator_type()) : tree_type(alloc)
+    {
+        insert(first, last);
+    }
+
+    template<typename... _Args>
+    constexpr std::pair<iterator, bool> emplace(_Args&&... args)
+    {
+        /* The key is only known once the entry exists, so build it first and drop it on a clash */
+        typename tree_type::operation_probe probe(*this, tree_type::counted_operation::insert);
+        node_pointer new_node = this->create_node(std::forward<_Args>(args)...);
+        insert_position position = this->find_unique_position(new_node->get_key().first);
+        if(position.existing_node != nullptr)
+        {
+            this->destroy_node(new_node);
+            return {this->make_iterator(position.existing_node), false};
+        }
+
+        this->link_at(position, new_node);
+        return {this->make_iterator(new_node), true};
+    }
+
+    /* Does nothing, and leaves args untouched, when key is already present */
+    template<typename... _Args>
+    constexpr std::pair<iterator, bool> try_emplace(const key_type& key, _Args&&... args)
+    {
+        return try_emplace_at(key, [&] { return this->create_node(std::piecewise_construct, std::forward_as_tuple(key),
+                                                                  std::forward_as_tuple(std::forward<_Args>(args)...)); });
+    }
+
+    template<typename... _Args>
+    constexpr std::pair<iterator, bool> try_emplace(key_type&& key, _Args&&... args)
+    {
+        return try_emplace_at(key, [&] { return this->create_node(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                                                  std::forward_as_tuple(std::forward<_Args>(args)...)); });
+    }
+
+    template<typename _Mapped>
+    constexpr std::pair<iterator, bool> insert_or_assign(const key_type& key, _Mapped&& value)
+    {
+        auto result = try_emplace(key, std::forward<_Mapped>(value));
+        if(!result.second)
+            result.first->second = std::forward<_Mapped>(value);
+
+        return result;
+    }
+
+    template<typename _Mapped>
+    constexpr std::pair<iterator, bool> insert_or_assign(key_type&& key, _Mapped&& value)
+    {
+        auto result = try_emplace(std::move(key), std::forward<_Mapped>(value));
+        if(!result.second)
+            result.first->second = std::forward<_Mapped>(value);
+
+        return result;
+    }
+
+    constexpr std::pair<iterator, bool> insert(const value_type& entry)
+    {
+        return try_emplace_at(entry.first, [&] { return this->create_node(entry); });
+    }
+
+    constexpr std::pair<iterator, bool> insert(value_type&& entry)
+    {
+        return try_emplace_at(entry.first, [&] { return this->create_node(std::move(entry)); });
+    }
+
+    template<std::input_iterator InputIt>
+    constexpr void insert(InputIt first, InputIt last)
+    {
+        for(; first != last; ++first)
+            insert(*first);
+    }
+
+    constexpr mapped_type& operator[](const key_type& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    constexpr mapped_type& operator[](key_type&& key)
+    {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template<typename _Lookup>
+    constexpr mapped_type& at(const _Lookup& key)
+    {
+        node_pointer found_node = search(key);
+        if(!found_node)
+            throw std::out_of_range("bst_map::at: key not found");
+
+        return found_node->get_key().second;
+    }
+
+    template<typename _Lookup>
+    constexpr const mapped_type& at(const _Lookup& key) const
+    {
+        node_pointer found_node = search(key);
+        if(!found_node)
+            throw std::out_of_range("bst_map::at: key not found");
+
+        return found_node->get_key().second;
+    }
+
+    template<typename _Lookup>
+    constexpr iterator find(const _Lookup& key)
+    {
+        return this->make_iterator(search(key));
+    }
+
+    template<typename _Lookup>
+    constexpr const_iterator find(const _Lookup& key) const
+    {
+        return this->make_iterator(search(key));
+    }
+
+    template<typename _Lookup>
+    constexpr bool contains(const _Lookup& key) const
+    {
+        return search(key) != nullptr;
+    }
+
+    /* The first entry whose key is not less than key, or end() */
+    template<typename _Lookup>
+    constexpr iterator lower_bound(const _Lookup& key)
+    {
+        return this->make_iterator(tree_type::lower_bound(key));
+    }
+
+    template<typename _Lookup>
+    constexpr const_iterator lower_bound(const _Lookup& key) const
+    {
+        return this->make_iterator(tree_type::lower_bound(key));
+    }
+
+    /* The first entry whose key is greater than key, or end() */
+    template<typename _Lookup>
+    constexpr iterator upper_bound(const _Lookup& key)
+    {
+        return this->make_iterator(tree_type::upper_bound(key));
+    }
+
+    template<typename _Lookup>
+    constexpr const_iterator upper_bound(const _Lookup& key) const
+    {
+        return this->make_iterator(tree_type::upper_bound(key));
+    }
+
+    template<typename _Lookup>
+    constexpr std::pair<iterator, iterator> equal_range(const _Lookup& key)
+    {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    template<typename _Lookup>
+    constexpr std::pair<const_iterator, const_iterator> equal_range(const _Lookup& key) const
+    {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    template<typename _Lookup>
+    constexpr size_type count(const _Lookup& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr iterator erase(const_iterator position)
+    {
+        return tree_type::erase(position);
+    }
+
+    /* Returns the number of entries removed, 0 or 1 */
+    template<typename _Lookup>
+    constexpr size_type erase(const _Lookup& key) requires (!std::is_convertible_v<const _Lookup&, const_iterator>)
+    {
+        node_pointer found_node = search(key);
+        if(!found_node)
+            return 0;
+
+        erase(this->make_iterator(found_node));
+        return 1;
+    }
+};
+
+/* Node footprint guard: two child links, the parent link with the balancing bits folded in and the key itself */
+static_assert(sizeof(binary_search_tree<int>::node) <= 4 * sizeof(void*), "binary_search_tree node grew");
+static_assert(sizeof(binary_search_tree<int, red_black_policy>::node) == sizeof(binary_search_tree<int>::node), "red-black colour must not take node space");
+static_assert(sizeof(binary_search_tree<int, avl_policy>::node) == sizeof(binary_search_tree<int>::node), "AVL balance factor must not take node space");
+static_assert(sizeof(binary_search_tree<int, duplicate_handling<duplicate_keys::count>>::node) == sizeof(binary_search_tree<int>::node), "occurrence counter of a small key must fit in the node padding");
+static_assert(!std::is_polymorphic_v<binary_search_tree<int>::node>, "binary_search_tree node must not carry a vtable");
+
+/* The tree bst_sort builds: balanced, with its nodes in an arena that is dropped in one go */
+template<typename _Tp, typename _Compare>
+using sort_tree = binary_search_tree<_Tp, red_black_policy, arena_allocator<_Tp>, _Compare>;
+
+/* Moves the keys out of tree in order; the tree is left with moved-from keys and should be dropped */
+template<typename _Tree, typename OutputIt>
+OutputIt drain_sort_tree(_Tree& tree, OutputIt out)
+{
+    for(auto& key : tree)
+        *out++ = std::move(key);
+
+    return out;
+}
+
+/* Runs task(0) .. task(count - 1) on the workers of pool, or one after the other on this thread without one */
+template<typename _Task>
+void run_tasks(task_pool* pool, std::size_t count, const _Task& task)
+{
+    if(pool == nullptr)
+    {
+        for(std::size_t index = 0; index < count; ++index)
+            task(index);
+        return;
+    }
+
+    task_pool::task_group group(*pool);
+    for(std::size_t index = 0; index < count; ++index)
+        group.spawn([&task, index] { task(index); });
+    group.wait();
+}
+
+/*
+ * The body of bst_sort. A sample of the input picks splitters that cut the key range into buckets of
+ * about bucket_keys elements, and each bucket is sorted in a tree of its own, small enough to stay in
+ * cache. As the buckets are ordered ranges of keys, the trees are written out one after the other.
+ * With a pool, the chunks of the partition and the buckets are spread over its workers.
+ *
+ * Trivially copyable elements are copied into bucket order first, so a bucket's tree is built from
+ * contiguous memory. Other elements are reached through their index instead of being copied twice;
+ * then, when out aliases the input, every tree is built before any is written out.
+ */
+template<std::random_access_iterator RandomIt, std::random_access_iterator OutputIt, typename _Compare>
+OutputIt partition_sort(task_pool* pool, RandomIt first, RandomIt last, OutputIt out, _Compare comp, bool out_aliases_input)
+{
+    using value_type = std::iter_value_t<RandomIt>;
+    using tree_type = sort_tree<value_type, _Compare>;
+    constexpr std::size_t bucket_keys = 1024;
+    constexpr std::size_t samples_per_bucket = 32;
+    constexpr bool scatters_keys = std::is_trivially_copyable_v<value_type>;
+    using slot_type = std::conditional_t<scatters_keys, value_type, std::size_t>;
+
+    const std::size_t element_count = static_cast<std::size_t>(last - first);
+    const std::size_t worker_count = (pool != nullptr) ? pool->size() : 1;
+    const std::size_t bucket_count = std::max(element_count / bucket_keys, 4 * worker_count);
+    if(element_count < 4 * bucket_keys || element_count < bucket_count * samples_per_bucket)
+    {
+        tree_type tree(comp);
+        for(; first != last; ++first)
+            tree.insert(*first);
+        return drain_sort_tree(tree, out);
+    }
+
+    /* Splitters: evenly spaced picks from a sorted, evenly spaced sample */
+    std::vector<value_type> splitters;
+    splitters.reserve(bucket_count - 1);
+    {
+        const std::size_t sample_size = bucket_count * samples_per_bucket;
+        std::vector<value_type> sample;
+        sample.reserve(sample_size);
+        for(std::size_t i = 0; i < sample_size; ++i)
+            sample.push_back(first[static_cast<std::ptrdiff_t>(i * (element_count / sample_size))]);
+
+        partition_sort(nullptr, sample.begin(), sample.end(), sample.begin(), comp, true);
+        for(std::size_t bucket = 1; bucket < bucket_count; ++bucket)
+            splitters.push_back(sample[bucket * samples_per_bucket]);
+    }
+
+    /* Number of splitters not greater than key, found without branching on the comparisons */
+    auto bucket_for = [&](const value_type& key) -> std::size_t
+    {
+        const value_type* base = splitters.data();
+        for(std::size_t remaining = splitters.size(); remaining > 1; remaining -= remaining / 2)
+            base = comp(key, base[remaining / 2]) ? base : base + remaining / 2;
+
+        return static_cast<std::size_t>(base - splitters.data()) + (comp(key, *base) ? 0 : 1);
+    };
+
+    /* Every chunk counts its elements per bucket; the counts then give each element its slot in bucket
+       order, chunk after chunk, so that equal elements keep their input order */
+    const std::size_t chunk_count = worker_count * 4;
+    auto chunk_begin = [&](std::size_t chunk) { return chunk * element_count / chunk_count; };
+    std::vector<std::uint32_t> bucket_of(element_count);
+    std::vector<std::size_t> next_slot(chunk_count * bucket_count, 0);
+    run_tasks(pool, chunk_count, [&](std::size_t chunk)
+    {
+        std::size_t* chunk_counts = next_slot.data() + chunk * bucket_count;
+        for(std::size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i)
+        {
+            std::size_t bucket = bucket_for(first[static_cast<std::ptrdiff_t>(i)]);
+            bucket_of[i] = static_cast<std::uint32_t>(bucket);
+            ++chunk_counts[bucket];
+        }
+    });
+
+    std::vector<std::size_t> bucket_begin(bucket_count + 1);
+    for(std::size_t bucket = 0, slot = 0; bucket < bucket_count; ++bucket)
+    {
+        bucket_begin[bucket] = slot;
+        for(std::size_t chunk = 0; chunk < chunk_count; ++chunk)
+            slot += std::exchange(next_slot[chunk * bucket_count + bucket], slot);
+    }
+    bucket_begin[bucket_count] = element_count;
+
+    /* Filled by construct_at, which cannot throw for either slot type, and never destroyed as neither needs it */
+    struct slot_deleter
+    {
+        std::size_t slot_count;
+        void operator()(slot_type* old_slots) const { std::allocator<slot_type>().deallocate(old_slots, slot_count); }
+    };
+    std::unique_ptr<slot_type[], slot_deleter> slots(std::allocator<slot_type>().allocate(element_count), slot_deleter{element_count});
+    run_tasks(pool, chunk_count, [&](std::size_t chunk)
+    {
+        std::size_t* chunk_slots = next_slot.data() + chunk * bucket_count;
+        for(std::size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i)
+        {
+            if constexpr(scatters_keys)
+                std::construct_at(slots.get() + chunk_slots[bucket_of[i]]++, first[static_cast<std::ptrdiff_t>(i)]);
+            else
+                std::construct_at(slots.get() + chunk_slots[bucket_of[i]]++, i);
+        }
+    });
+
+    auto build_tree = [&](tree_type& tree, std::size_t bucket)
+    {
+        for(std::size_t slot = bucket_begin[bucket]; slot < bucket_begin[bucket + 1]; ++slot)
+        {
+            if constexpr(scatters_keys)
+                tree.insert(slots[slot]);
+            else
+                tree.insert(first[static_cast<std::ptrdiff_t>(slots[slot])]);
+        }
+    };
+    auto bucket_out = [&](std::size_t bucket) { return out + static_cast<std::ptrdiff_t>(bucket_begin[bucket]); };
+
+    if(!scatters_keys && out_aliases_input)
+    {
+        std::vector<tree_type> trees;
+        trees.reserve(bucket_count);
+        for(std::size_t bucket = 0; bucket < bucket_count; ++bucket)
+            trees.emplace_back(comp);
+
+        run_tasks(pool, bucket_count, [&](std::size_t bucket) { build_tree(trees[bucket], bucket); });
+        run_tasks(pool, bucket_count, [&](std::size_t bucket) { drain_sort_tree(trees[bucket], bucket_out(bucket)); });
+    }
+    else
+    {
+        run_tasks(pool, bucket_count, [&](std::size_t bucket)
+        {
+            tree_type tree(comp);
+            build_tree(tree, bucket);
+            drain_sort_tree(tree, bucket_out(bucket));
+        });
+    }
+
+    return out + static_cast<std::ptrdiff_t>(element_count);
+}
+
+/* partition_sort behind an O(n) check for input already in ascending or strictly descending order */
+template<std::random_access_iterator RandomIt, std::random_access_iterator OutputIt, typename _Compare>
+OutputIt sort_into(task_pool* pool, RandomIt first, RandomIt last, OutputIt out, _Compare comp, bool out_aliases_input)
+{
+    if(std::is_sorted(first, last, comp))
+        return out_aliases_input ? out + (last - first) : std::copy(first, last, out);
+
+    if(std::adjacent_find(first, last, [&](const auto& lhs, const auto& rhs) { return !comp(rhs, lhs); }) == last)
+    {
+        if(!out_aliases_input)
+            return std::reverse_copy(first, last, out);
+
+        std::reverse(out, out + (last - first));
+        return out + (last - first);
+    }
+
+    return partition_sort(pool, first, last, out, comp, out_aliases_input);
+}
+
+/*
+ * Writes the elements of [first, last) to out in ascending order by comp and returns the end of the
+ * output. Equal elements keep their input order. Any input order costs O(n log n), and input already
+ * in ascending or strictly descending order only O(n). Ranges that are not random access are buffered.
+ */
+template<std::input_iterator InputIt, typename OutputIt, typename _Compare = std::less<>>
+OutputIt bst_sort_copy(InputIt first, InputIt last, OutputIt out, _Compare comp = _Compare())
+{
+    if constexpr(std::random_access_iterator<InputIt> && std::random_access_iterator<OutputIt>)
+    {
+        return sort_into(nullptr, first, last, out, comp, false);
+    }
+    else
+    {
+        std::vector<std::iter_value_t<InputIt>> buffer(first, last);
+        sort_into(nullptr, buffer.begin(), buffer.end(), buffer.begin(), comp, true);
+        return std::move(buffer.begin(), buffer.end(), out);
+    }
+}
+
+/* Sorts [first, last) in place */
+template<std::forward_iterator ForwardIt, typename _Compare = std::less<>>
+void bst_sort(ForwardIt first, ForwardIt last, _Compare comp = _Compare())
+{
+    if constexpr(std::random_access_iterator<ForwardIt>)
+    {
+        sort_into(nullptr, first, last, first, comp, true);
+    }
+    else
+    {
+        std::vector<std::iter_value_t<ForwardIt>> buffer(first, last);
+        sort_into(nullptr, buffer.begin(), buffer.end(), buffer.begin(), comp, true);
+        std::move(buffer.begin(), buffer.end(), first);
+    }
+}
+
+template<typename T> void bst_sort(T* arr, size_t length)
+{
+    bst_sort(arr, arr + length);
+}
+
+template<typename T, size_t length> void bst_sort(T (&arr)[length])
+{
+    bst_sort(arr, arr + length);
+}
+
+/* bst_sort_copy with the partition and the buckets spread over the workers of pool */
+template<std::random_access_iterator RandomIt, std::random_access_iterator OutputIt, typename _Compare = std::less<>>
+OutputIt bst_sort_copy(task_pool& pool, RandomIt first, RandomIt last, OutputIt out, _Compare comp = _Compare())
+{
+    return sort_into(&pool, first, last, out, comp, false);
+}
+
+/* Parallel in-place bst_sort */
+template<std::random_access_iterator RandomIt, typename _Compare = std::less<>>
+void bst_sort(task_pool& pool, RandomIt first, RandomIt last, _Compare comp = _Compare())
+{
+    sort_into(&pool, first, last, first, comp, true);
+}
+}
+
+#endif // BINARY_SEARCH_TREE_HPP_INCLUDED
+
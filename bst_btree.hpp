@@ -0,0 +1,858 @@
+#ifndef BST_BTREE_HPP_INCLUDED
+#define BST_BTREE_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BST_BTREE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace BST
+{
+/*
+ * Key-rank kernels for simd_btree: where a key goes among the sorted keys of a node. Nodes hold few
+ * keys, so comparing a vector of them at a time with SIMD compare and movemask beats a binary search
+ * and hardly mispredicts. The instruction set is picked once at run time; 32- and 64-bit integers,
+ * float and double have SIMD kernels, other key types use the scalar loop.
+ */
+namespace simd
+{
+enum class level
+{
+    scalar,
+    sse2,
+    avx2
+};
+
+inline level supported_level()
+{
+#ifdef BST_BTREE_X86_SIMD
+    static const level detected = []
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            return level::avx2;
+        if(__builtin_cpu_supports("sse2"))
+            return level::sse2;
+        return level::scalar;
+    }();
+    return detected;
+#else
+    return level::scalar;
+#endif
+}
+
+/* Atomic since use_level() may change it while other threads search; a search takes the change from its next node on */
+inline std::atomic<level>& active_level()
+{
+    static std::atomic<level> active{supported_level()};
+    return active;
+}
+
+/* The level the kernels use */
+inline level current_level()
+{
+    return active_level().load(std::memory_order_relaxed);
+}
+
+/* Restricts the kernels to at most the given level, e.g. to measure the scalar fallback. Returns the level in use. */
+inline level use_level(level requested)
+{
+    const level granted = std::min(requested, supported_level());
+    active_level().store(granted, std::memory_order_relaxed);
+    return granted;
+}
+
+/* The fixed-width type whose kernels serve _Tp, or void when there are none */
+template<typename _Tp>
+using kernel_key_t = std::conditional_t<std::is_same_v<_Tp, float> || std::is_same_v<_Tp, double>, _Tp,
+                     std::conditional_t<!std::is_integral_v<_Tp> || std::is_same_v<_Tp, bool>, void,
+                     std::conditional_t<sizeof(_Tp) == 4, std::conditional_t<std::is_signed_v<_Tp>, std::int32_t, std::uint32_t>,
+                     std::conditional_t<sizeof(_Tp) == 8, std::conditional_t<std::is_signed_v<_Tp>, std::int64_t, std::uint64_t>, void>>>>;
+
+/* Branch-free count, which compilers vectorize for the baseline instruction set */
+template<bool _UpperBound, typename _Tp>
+unsigned rank_scalar(const _Tp* keys, unsigned count, _Tp key)
+{
+    unsigned total = 0;
+    for(unsigned i = 0; i < count; ++i)
+        total += _UpperBound ? !(key < keys[i]) : (keys[i] < key);
+    return total;
+}
+
+#ifdef BST_BTREE_X86_SIMD
+/*
+ * One vector type per key type: load() and splat() give vectors, greater(a, b) the lane mask of a > b.
+ * Unsigned keys are compared as signed after flipping their top bit.
+ */
+template<typename _Tp> struct avx2_ops;
+template<typename _Tp> struct sse2_ops;
+
+#define BST_AVX2 __attribute__((target("avx2")))
+
+template<> struct avx2_ops<std::int32_t>
+{
+    static constexpr unsigned lanes = 8;
+    BST_AVX2 static __m256i load(const void* keys) { return _mm256_load_si256(static_cast<const __m256i*>(keys)); }
+    BST_AVX2 static __m256i splat(std::int32_t key) { return _mm256_set1_epi32(key); }
+    BST_AVX2 static unsigned greater(__m256i a, __m256i b) { return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)))); }
+};
+
+template<> struct avx2_ops<std::uint32_t> : avx2_ops<std::int32_t>
+{
+    BST_AVX2 static __m256i load(const void* keys) { return _mm256_xor_si256(avx2_ops<std::int32_t>::load(keys), _mm256_set1_epi32(INT32_MIN)); }
+    BST_AVX2 static __m256i splat(std::uint32_t key) { return _mm256_set1_epi32(static_cast<std::int32_t>(key ^ 0x80000000u)); }
+};
+
+template<> struct avx2_ops<std::int64_t>
+{
+    static constexpr unsigned lanes = 4;
+    BST_AVX2 static __m256i load(const void* keys) { return _mm256_load_si256(static_cast<const __m256i*>(keys)); }
+    BST_AVX2 static __m256i splat(std::int64_t key) { return _mm256_set1_epi64x(key); }
+    BST_AVX2 static unsigned greater(__m256i a, __m256i b) { return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b)))); }
+};
+
+template<> struct avx2_ops<std::uint64_t> : avx2_ops<std::int64_t>
+{
+    BST_AVX2 static __m256i load(const void* keys) { return _mm256_xor_si256(avx2_ops<std::int64_t>::load(keys), _mm256_set1_epi64x(INT64_MIN)); }
+    BST_AVX2 static __m256i splat(std::uint64_t key) { return _mm256_set1_epi64x(static_cast<std::int64_t>(key ^ 0x8000000000000000u)); }
+};
+
+template<> struct avx2_ops<float>
+{
+    static constexpr unsigned lanes = 8;
+    BST_AVX2 static __m256 load(const void* keys) { return _mm256_load_ps(static_cast<const float*>(keys)); }
+    BST_AVX2 static __m256 splat(float key) { return _mm256_set1_ps(key); }
+    BST_AVX2 static unsigned greater(__m256 a, __m256 b) { return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ))); }
+};
+
+template<> struct avx2_ops<double>
+{
+    static constexpr unsigned lanes = 4;
+    BST_AVX2 static __m256d load(const void* keys) { return _mm256_load_pd(static_cast<const double*>(keys)); }
+    BST_AVX2 static __m256d splat(double key) { return _mm256_set1_pd(key); }
+    BST_AVX2 static unsigned greater(__m256d a, __m256d b) { return static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ))); }
+};
+
+template<> struct sse2_ops<std::int32_t>
+{
+    static constexpr unsigned lanes = 4;
+    static __m128i load(const void* keys) { return _mm_load_si128(static_cast<const __m128i*>(keys)); }
+    static __m128i splat(std::int32_t key) { return _mm_set1_epi32(key); }
+    static unsigned greater(__m128i a, __m128i b) { return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, b)))); }
+};
+
+template<> struct sse2_ops<std::uint32_t> : sse2_ops<std::int32_t>
+{
+    static __m128i load(const void* keys) { return _mm_xor_si128(sse2_ops<std::int32_t>::load(keys), _mm_set1_epi32(INT32_MIN)); }
+    static __m128i splat(std::uint32_t key) { return _mm_set1_epi32(static_cast<std::int32_t>(key ^ 0x80000000u)); }
+};
+
+template<> struct sse2_ops<float>
+{
+    static constexpr unsigned lanes = 4;
+    static __m128 load(const void* keys) { return _mm_load_ps(static_cast<const float*>(keys)); }
+    static __m128 splat(float key) { return _mm_set1_ps(key); }
+    static unsigned greater(__m128 a, __m128 b) { return static_cast<unsigned>(_mm_movemask_ps(_mm_cmpgt_ps(a, b))); }
+};
+
+template<> struct sse2_ops<double>
+{
+    static constexpr unsigned lanes = 2;
+    static __m128d load(const void* keys) { return _mm_load_pd(static_cast<const double*>(keys)); }
+    static __m128d splat(double key) { return _mm_set1_pd(key); }
+    static unsigned greater(__m128d a, __m128d b) { return static_cast<unsigned>(_mm_movemask_pd(_mm_cmpgt_pd(a, b))); }
+};
+
+/* SSE2 has no 64-bit integer compare */
+template<typename _Tp>
+concept has_sse2_kernel = requires { sse2_ops<_Tp>::lanes; };
+
+/*
+ * The keys being sorted, the lanes passing the comparison form a prefix, so the rank is the first lane
+ * that stops it. keys must be aligned to the vector size and readable up to the next multiple of lanes.
+ */
+template<bool _UpperBound, typename _Tp>
+BST_AVX2 unsigned rank_avx2(const void* keys, unsigned count, _Tp key)
+{
+    using ops = avx2_ops<_Tp>;
+    const auto key_vector = ops::splat(key);
+    const auto* bytes = static_cast<const unsigned char*>(keys);
+    for(unsigned i = 0; i < count; i += ops::lanes, bytes += ops::lanes * sizeof(_Tp))
+    {
+        const auto key_block = ops::load(bytes);
+        unsigned stop = _UpperBound ? ops::greater(key_block, key_vector) : ~ops::greater(key_vector, key_block);
+        if(count - i < ops::lanes)
+            stop |= ~0u << (count - i);
+        if((stop & ((1u << ops::lanes) - 1)) != 0)
+            return i + static_cast<unsigned>(std::countr_zero(stop));
+    }
+
+    return count;
+}
+
+template<bool _UpperBound, typename _Tp>
+unsigned rank_sse2(const void* keys, unsigned count, _Tp key)
+{
+    using ops = sse2_ops<_Tp>;
+    const auto key_vector = ops::splat(key);
+    const auto* bytes = static_cast<const unsigned char*>(keys);
+    for(unsigned i = 0; i < count; i += ops::lanes, bytes += ops::lanes * sizeof(_Tp))
+    {
+        const auto key_block = ops::load(bytes);
+        unsigned stop = _UpperBound ? ops::greater(key_block, key_vector) : ~ops::greater(key_vector, key_block);
+        if(count - i < ops::lanes)
+            stop |= ~0u << (count - i);
+        if((stop & ((1u << ops::lanes) - 1)) != 0)
+            return i + static_cast<unsigned>(std::countr_zero(stop));
+    }
+
+    return count;
+}
+
+#undef BST_AVX2
+#endif
+
+/* Number of keys in the sorted keys[0 .. count) less than key, or not greater than key when _UpperBound */
+template<bool _UpperBound, typename _Tp>
+unsigned rank(const _Tp* keys, unsigned count, _Tp key)
+{
+#ifdef BST_BTREE_X86_SIMD
+    using kernel_type = kernel_key_t<_Tp>;
+    if constexpr(!std::is_void_v<kernel_type>)
+    {
+        level active = current_level();
+        if(active == level::avx2)
+            return rank_avx2<_UpperBound, kernel_type>(keys, count, static_cast<kernel_type>(key));
+        if constexpr(has_sse2_kernel<kernel_type>)
+        {
+            if(active == level::sse2)
+                return rank_sse2<_UpperBound, kernel_type>(keys, count, static_cast<kernel_type>(key));
+        }
+    }
+#endif
+    return rank_scalar<_UpperBound>(keys, count, key);
+}
+}
+
+/*
+ * B+-tree for arithmetic keys with the operations of binary_search_tree: insert, search, delete_node,
+ * count, minimum, maximum, successor and predecessor. Equal keys are allowed, as in the tree.
+ *
+ * Every node holds up to _NodeKeys keys in a cache-line aligned array, so a lookup touches one or two
+ * cache lines per level instead of one per key, and the child to follow is found by the SIMD kernels
+ * above. Keys live in the leaves, which are chained in key order for iteration.
+ * Iterators are invalidated by insert and delete_node.
+ */
+template<typename _Tp, unsigned _NodeKeys = 32>
+class simd_btree
+{
+    static_assert(std::is_arithmetic_v<_Tp>, "simd_btree stores arithmetic keys");
+    static_assert(_NodeKeys >= 16 && _NodeKeys <= 64 && _NodeKeys % 8 == 0, "_NodeKeys must be a multiple of 8 in [16, 64]");
+
+ public:
+    using value_type = _Tp;
+    using size_type = std::size_t;
+
+    static constexpr unsigned node_keys = _NodeKeys;
+
+ private:
+    /* Nodes other than the root keep at least min_keys keys */
+    static constexpr unsigned min_keys = _NodeKeys / 2;
+
+    struct node
+    {
+        alignas(64) value_type keys[_NodeKeys]{};
+        unsigned key_count = 0;
+        const bool is_leaf;
+
+        explicit node(bool leaf) : is_leaf(leaf) {}
+    };
+
+    struct leaf_node : node
+    {
+        leaf_node* next = nullptr;
+        leaf_node* previous = nullptr;
+
+        leaf_node() : node(true) {}
+    };
+
+    struct inner_node : node
+    {
+        /* Keys of children[i] <= keys[i] <= keys of children[i + 1] */
+        node* children[_NodeKeys + 1]{};
+
+        inner_node() : node(false) {}
+    };
+
+    node* root = nullptr;
+    size_type key_total = 0;
+
+    static leaf_node* as_leaf(node* tree_node) { return static_cast<leaf_node*>(tree_node); }
+    static const leaf_node* as_leaf(const node* tree_node) { return static_cast<const leaf_node*>(tree_node); }
+    static inner_node* as_inner(node* tree_node) { return static_cast<inner_node*>(tree_node); }
+    static const inner_node* as_inner(const node* tree_node) { return static_cast<const inner_node*>(tree_node); }
+
+    /* Number of keys of the node less than key */
+    static unsigned rank_less(const node* tree_node, value_type key)
+    {
+        return simd::rank<false>(tree_node->keys, tree_node->key_count, key);
+    }
+
+    /* Number of keys of the node not greater than key */
+    static unsigned rank_less_equal(const node* tree_node, value_type key)
+    {
+        return simd::rank<true>(tree_node->keys, tree_node->key_count, key);
+    }
+
+    static void destroy_subtree(node* subtree_root)
+    {
+        if(subtree_root == nullptr)
+            return;
+
+        if(subtree_root->is_leaf)
+        {
+            delete as_leaf(subtree_root);
+            return;
+        }
+
+        inner_node* inner = as_inner(subtree_root);
+        for(unsigned i = 0; i <= inner->key_count; ++i)
+            destroy_subtree(inner->children[i]);
+        delete inner;
+    }
+
+    /* Copies src_root and links its leaves after previous_leaf */
+    static node* clone_subtree(const node* src_root, leaf_node*& previous_leaf)
+    {
+        if(src_root->is_leaf)
+        {
+            leaf_node* leaf = new leaf_node;
+            std::copy_n(src_root->keys, src_root->key_count, leaf->keys);
+            leaf->key_count = src_root->key_count;
+            leaf->previous = previous_leaf;
+            if(previous_leaf != nullptr)
+                previous_leaf->next = leaf;
+            previous_leaf = leaf;
+            return leaf;
+        }
+
+        const inner_node* src_inner = as_inner(src_root);
+        inner_node* inner = new inner_node;
+        std::copy_n(src_inner->keys, src_inner->key_count, inner->keys);
+        try
+        {
+            for(unsigned i = 0; i <= src_inner->key_count; ++i)
+            {
+                inner->children[i] = clone_subtree(src_inner->children[i], previous_leaf);
+                inner->key_count = i;
+            }
+        }
+        catch(...)
+        {
+            destroy_subtree(inner);
+            throw;
+        }
+
+        inner->key_count = src_inner->key_count;
+        return inner;
+    }
+
+    /* Splits the full child at index i of parent into two, moving the middle separator up */
+    static void split_child(inner_node* parent, unsigned i)
+    {
+        node* child = parent->children[i];
+        node* right;
+        value_type separator;
+        if(child->is_leaf)
+        {
+            leaf_node* left_leaf = as_leaf(child);
+            leaf_node* right_leaf = new leaf_node;
+            right_leaf->key_count = _NodeKeys - min_keys;
+            std::copy_n(left_leaf->keys + min_keys, right_leaf->key_count, right_leaf->keys);
+            left_leaf->key_count = min_keys;
+
+            right_leaf->next = left_leaf->next;
+            right_leaf->previous = left_leaf;
+            if(left_leaf->next != nullptr)
+                left_leaf->next->previous = right_leaf;
+            left_leaf->next = right_leaf;
+
+            separator = right_leaf->keys[0];
+            right = right_leaf;
+        }
+        else
+        {
+            inner_node* left_inner = as_inner(child);
+            inner_node* right_inner = new inner_node;
+            constexpr unsigned middle = _NodeKeys / 2;
+            right_inner->key_count = _NodeKeys - middle - 1;
+            std::copy_n(left_inner->keys + middle + 1, right_inner->key_count, right_inner->keys);
+            std::copy_n(left_inner->children + middle + 1, right_inner->key_count + 1, right_inner->children);
+            left_inner->key_count = middle;
+
+            separator = left_inner->keys[middle];
+            right = right_inner;
+        }
+
+        std::copy_backward(parent->keys + i, parent->keys + parent->key_count, parent->keys + parent->key_count + 1);
+        std::copy_backward(parent->children + i + 1, parent->children + parent->key_count + 1, parent->children + parent->key_count + 2);
+        parent->keys[i] = separator;
+        parent->children[i + 1] = right;
+        ++parent->key_count;
+    }
+
+    static void borrow_from_left(inner_node* parent, unsigned i)
+    {
+        node* left = parent->children[i - 1];
+        node* child = parent->children[i];
+        std::copy_backward(child->keys, child->keys + child->key_count, child->keys + child->key_count + 1);
+        if(child->is_leaf)
+        {
+            child->keys[0] = left->keys[left->key_count - 1];
+            parent->keys[i - 1] = child->keys[0];
+        }
+        else
+        {
+            inner_node* child_inner = as_inner(child);
+            std::copy_backward(child_inner->children, child_inner->children + child->key_count + 1, child_inner->children + child->key_count + 2);
+            child_inner->keys[0] = parent->keys[i - 1];
+            child_inner->children[0] = as_inner(left)->children[left->key_count];
+            parent->keys[i - 1] = left->keys[left->key_count - 1];
+        }
+
+        --left->key_count;
+        ++child->key_count;
+    }
+
+    static void borrow_from_right(inner_node* parent, unsigned i)
+    {
+        node* child = parent->children[i];
+        node* right = parent->children[i + 1];
+        if(child->is_leaf)
+        {
+            child->keys[child->key_count] = right->keys[0];
+            std::copy(right->keys + 1, right->keys + right->key_count, right->keys);
+            parent->keys[i] = right->keys[0];
+        }
+        else
+        {
+            inner_node* child_inner = as_inner(child);
+            inner_node* right_inner = as_inner(right);
+            child_inner->keys[child->key_count] = parent->keys[i];
+            child_inner->children[child->key_count + 1] = right_inner->children[0];
+            parent->keys[i] = right->keys[0];
+            std::copy(right->keys + 1, right->keys + right->key_count, right->keys);
+            std::copy(right_inner->children + 1, right_inner->children + right->key_count + 1, right_inner->children);
+        }
+
+        ++child->key_count;
+        --right->key_count;
+    }
+
+    /* Merges children i and i + 1 of parent into child i */
+    static void merge_children(inner_node* parent, unsigned i)
+    {
+        node* left = parent->children[i];
+        node* right = parent->children[i + 1];
+        if(left->is_leaf)
+        {
+            leaf_node* left_leaf = as_leaf(left);
+            leaf_node* right_leaf = as_leaf(right);
+            std::copy_n(right->keys, right->key_count, left->keys + left->key_count);
+            left->key_count += right->key_count;
+
+            left_leaf->next = right_leaf->next;
+            if(right_leaf->next != nullptr)
+                right_leaf->next->previous = left_leaf;
+            delete right_leaf;
+        }
+        else
+        {
+            inner_node* left_inner = as_inner(left);
+            inner_node* right_inner = as_inner(right);
+            left->keys[left->key_count] = parent->keys[i];
+            std::copy_n(right->keys, right->key_count, left->keys + left->key_count + 1);
+            std::copy_n(right_inner->children, right->key_count + 1, left_inner->children + left->key_count + 1);
+            left->key_count += right->key_count + 1;
+            delete right_inner;
+        }
+
+        std::copy(parent->keys + i + 1, parent->keys + parent->key_count, parent->keys + i);
+        std::copy(parent->children + i + 2, parent->children + parent->key_count + 1, parent->children + i + 1);
+        --parent->key_count;
+    }
+
+    /* Refills child i of parent after it fell below min_keys */
+    static void rebalance_child(inner_node* parent, unsigned i)
+    {
+        if(i > 0 && parent->children[i - 1]->key_count > min_keys)
+            borrow_from_left(parent, i);
+        else if(i < parent->key_count && parent->children[i + 1]->key_count > min_keys)
+            borrow_from_right(parent, i);
+        else if(i > 0)
+            merge_children(parent, i - 1);
+        else
+            merge_children(parent, i);
+    }
+
+    /* Removes one key equal to key from the subtree; false when there is none */
+    static bool erase_key(node* subtree_root, value_type key)
+    {
+        if(subtree_root->is_leaf)
+        {
+            unsigned position = rank_less(subtree_root, key);
+            if(position == subtree_root->key_count || key < subtree_root->keys[position])
+                return false;
+
+            std::copy(subtree_root->keys + position + 1, subtree_root->keys + subtree_root->key_count, subtree_root->keys + position);
+            --subtree_root->key_count;
+            return true;
+        }
+
+        /* Copies of key may continue into the next children while the separators equal it */
+        inner_node* inner = as_inner(subtree_root);
+        for(unsigned i = rank_less(inner, key); i <= inner->key_count; ++i)
+        {
+            if(erase_key(inner->children[i], key))
+            {
+                if(inner->children[i]->key_count < min_keys)
+                    rebalance_child(inner, i);
+                return true;
+            }
+
+            if(i == inner->key_count || key < inner->keys[i])
+                break;
+        }
+
+        return false;
+    }
+
+    const leaf_node* first_leaf() const
+    {
+        const node* current_node = root;
+        while(current_node != nullptr && !current_node->is_leaf)
+            current_node = as_inner(current_node)->children[0];
+        return as_leaf(current_node);
+    }
+
+    const leaf_node* last_leaf() const
+    {
+        const node* current_node = root;
+        while(current_node != nullptr && !current_node->is_leaf)
+            current_node = as_inner(current_node)->children[current_node->key_count];
+        return as_leaf(current_node);
+    }
+
+ public:
+    /* Position of a key in a leaf; end() has no leaf */
+    class const_iterator
+    {
+     private:
+        friend class simd_btree;
+
+        const leaf_node* current = nullptr;
+        unsigned index = 0;
+        const simd_btree* tree = nullptr;
+
+        const_iterator(const leaf_node* current, unsigned index, const simd_btree* tree) : current(current), index(index), tree(tree)
+        {
+            if(this->current != nullptr && this->index == this->current->key_count)
+            {
+                this->current = this->current->next;
+                this->index = 0;
+            }
+        }
+
+     public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = _Tp;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const _Tp*;
+        using reference = const _Tp&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return current->keys[index]; }
+        pointer operator->() const { return current->keys + index; }
+
+        const_iterator& operator++()
+        {
+            if(++index == current->key_count)
+            {
+                current = current->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous_position = *this;
+            ++*this;
+            return previous_position;
+        }
+
+        /* Decrementing begin() gives end() */
+        const_iterator& operator--()
+        {
+            if(current == nullptr)
+            {
+                current = tree->last_leaf();
+                index = (current != nullptr) ? current->key_count - 1 : 0;
+            }
+            else if(index == 0)
+            {
+                current = current->previous;
+                index = (current != nullptr) ? current->key_count - 1 : 0;
+            }
+            else
+                --index;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator next_position = *this;
+            --*this;
+            return next_position;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return lhs.current == rhs.current && lhs.index == rhs.index;
+        }
+    };
+
+    using iterator = const_iterator;
+
+    simd_btree() = default;
+
+    simd_btree(std::initializer_list<value_type> initList)
+    {
+        for(value_type key : initList)
+            insert(key);
+    }
+
+    simd_btree(const simd_btree& other) : key_total(other.key_total)
+    {
+        leaf_node* previous_leaf = nullptr;
+        if(other.root != nullptr)
+            root = clone_subtree(other.root, previous_leaf);
+    }
+
+    simd_btree(simd_btree&& other) noexcept : root(std::exchange(other.root, nullptr)), key_total(std::exchange(other.key_total, 0)) {}
+
+    simd_btree& operator=(simd_btree other) noexcept
+    {
+        std::swap(root, other.root);
+        std::swap(key_total, other.key_total);
+        return *this;
+    }
+
+    ~simd_btree()
+    {
+        destroy_subtree(root);
+    }
+
+    void clear()
+    {
+        destroy_subtree(root);
+        root = nullptr;
+        key_total = 0;
+    }
+
+    size_type size() const
+    {
+        return key_total;
+    }
+
+    bool empty() const
+    {
+        return key_total == 0;
+    }
+
+    /* Same as size(); the node-counting name of binary_search_tree */
+    size_type count() const
+    {
+        return key_total;
+    }
+
+    /* Number of keys equal to key */
+    size_type count(value_type key) const
+    {
+        const_iterator first = lower_bound(key);
+        size_type total = 0;
+        unsigned index = first.index;
+        for(const leaf_node* leaf = first.current; leaf != nullptr; leaf = leaf->next, index = 0)
+        {
+            unsigned end_index = rank_less_equal(leaf, key);
+            total += end_index - index;
+            if(end_index < leaf->key_count)
+                break;
+        }
+
+        return total;
+    }
+
+    /* Inserts after any equal keys and returns the new key's position */
+    const_iterator insert(value_type key)
+    {
+        if(root == nullptr)
+            root = new leaf_node;
+
+        if(root->key_count == _NodeKeys)
+        {
+            inner_node* new_root = new inner_node;
+            new_root->children[0] = root;
+            try
+            {
+                split_child(new_root, 0);
+            }
+            catch(...)
+            {
+                delete new_root;
+                throw;
+            }
+            root = new_root;
+        }
+
+        /* Full nodes are split on the way down, so the leaf always has room */
+        node* current_node = root;
+        while(!current_node->is_leaf)
+        {
+            inner_node* inner = as_inner(current_node);
+            unsigned i = rank_less_equal(inner, key);
+            if(inner->children[i]->key_count == _NodeKeys)
+            {
+                split_child(inner, i);
+                if(!(key < inner->keys[i]))
+                    ++i;
+            }
+            current_node = inner->children[i];
+        }
+
+        unsigned position = rank_less_equal(current_node, key);
+        std::copy_backward(current_node->keys + position, current_node->keys + current_node->key_count, current_node->keys + current_node->key_count + 1);
+        current_node->keys[position] = key;
+        ++current_node->key_count;
+        ++key_total;
+        return const_iterator(as_leaf(current_node), position, this);
+    }
+
+    /* Removes one key equal to key; false when there is none */
+    bool delete_node(value_type key)
+    {
+        if(root == nullptr || !erase_key(root, key))
+            return false;
+
+        --key_total;
+        if(root->key_count == 0)
+        {
+            node* old_root = root;
+            if(root->is_leaf)
+            {
+                root = nullptr;
+                delete as_leaf(old_root);
+            }
+            else
+            {
+                root = as_inner(old_root)->children[0];
+                delete as_inner(old_root);
+            }
+        }
+
+        return true;
+    }
+
+    /* The first key not less than key, or end() */
+    const_iterator lower_bound(value_type key) const
+    {
+        const node* current_node = root;
+        if(current_node == nullptr)
+            return end();
+
+        while(!current_node->is_leaf)
+            current_node = as_inner(current_node)->children[rank_less(current_node, key)];
+
+        return const_iterator(as_leaf(current_node), rank_less(current_node, key), this);
+    }
+
+    /* The first key greater than key, or end() */
+    const_iterator upper_bound(value_type key) const
+    {
+        const node* current_node = root;
+        if(current_node == nullptr)
+            return end();
+
+        while(!current_node->is_leaf)
+            current_node = as_inner(current_node)->children[rank_less_equal(current_node, key)];
+
+        return const_iterator(as_leaf(current_node), rank_less_equal(current_node, key), this);
+    }
+
+    /* The first key equal to key, or end() */
+    const_iterator search(value_type key) const
+    {
+        const_iterator found = lower_bound(key);
+        return (found != end() && !(key < *found)) ? found : end();
+    }
+
+    bool contains(value_type key) const
+    {
+        return search(key) != end();
+    }
+
+    const_iterator minimum() const
+    {
+        return begin();
+    }
+
+    const_iterator maximum() const
+    {
+        return std::prev(end());
+    }
+
+    const_iterator successor(const_iterator position) const
+    {
+        return std::next(position);
+    }
+
+    /* end() for the smallest key */
+    const_iterator predecessor(const_iterator position) const
+    {
+        return (position == begin()) ? end() : std::prev(position);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(first_leaf(), 0, this);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(nullptr, 0, this);
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+};
+}
+
+#endif // BST_BTREE_HPP_INCLUDED
@@ -0,0 +1,421 @@
+#ifndef BST_CONCURRENT_HPP_INCLUDED
+#define BST_CONCURRENT_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "bst_epoch.hpp"
+
+namespace BST
+{
+/*
+ * Set of unique keys that any number of threads may read and write at once.
+ *
+ * Nodes are immutable once published. A writer copies the root-to-key path it changes (rebalancing it
+ * as an AVL tree on the way up) and swings the root to the new path in one atomic store, so readers
+ * always walk a consistent snapshot without taking a lock or retrying: lookups finish in O(height)
+ * steps whatever the writers do. Writers are serialized by a mutex. Replaced nodes are handed to epoch
+ * reclamation (bst_epoch.hpp) and freed only once no reader can still be walking them.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class concurrent_bst
+{
+ public:
+    using value_type = _Tp;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+
+    static constexpr bool transparent_compare = requires { typename _Compare::is_transparent; };
+
+ private:
+    struct node
+    {
+        const value_type key;
+        node* const left;
+        node* const right;
+        const int height;
+    };
+
+    struct node_deleter
+    {
+        void operator()(node* old_node) const { delete old_node; }
+    };
+
+    std::atomic<node*> root{nullptr};
+    std::atomic<size_type> node_count{0};
+
+    /* Everything below root is only touched by the thread holding writer_mutex */
+    std::mutex writer_mutex;
+    retire_list<node, node_deleter> retired;
+    std::vector<node*> created;  /* Nodes built by the write in progress */
+    std::vector<node*> replaced; /* Nodes the write in progress cuts out of the tree */
+    [[no_unique_address]] _Compare compare;
+
+    static int height_of(const node* subtree_root)
+    {
+        return (subtree_root != nullptr) ? subtree_root->height : 0;
+    }
+
+    template<typename _Key>
+    const node* find_node(const node* current_node, const _Key& key) const
+    {
+        while(current_node != nullptr)
+        {
+            if(compare(key, current_node->key))
+                current_node = current_node->left;
+            else if(compare(current_node->key, key))
+                current_node = current_node->right;
+            else
+                return current_node;
+        }
+
+        return nullptr;
+    }
+
+    node* make_node(const value_type& key, node* left, node* right)
+    {
+        std::unique_ptr<node> new_node(new node{key, left, right, 1 + std::max(height_of(left), height_of(right))});
+        created.push_back(new_node.get());
+        return new_node.release();
+    }
+
+    /* Room for what one write builds and cuts out, about two nodes per level of its path, reserved once
+       before the path is copied */
+    void reserve_for_write(const node* old_root)
+    {
+        const std::size_t path_nodes = 2 * static_cast<std::size_t>(height_of(old_root)) + 2;
+        created.reserve(path_nodes);
+        replaced.reserve(path_nodes);
+    }
+
+    /* Builds an AVL subtree from key and two AVL subtrees whose heights differ by at most 2 */
+    node* join(const value_type& key, node* left, node* right)
+    {
+        if(height_of(left) > height_of(right) + 1)
+        {
+            replaced.push_back(left);
+            if(height_of(left->left) >= height_of(left->right))
+                return make_node(left->key, left->left, make_node(key, left->right, right));
+
+            node* inner = left->right;
+            replaced.push_back(inner);
+            return make_node(inner->key, make_node(left->key, left->left, inner->left), make_node(key, inner->right, right));
+        }
+
+        if(height_of(right) > height_of(left) + 1)
+        {
+            replaced.push_back(right);
+            if(height_of(right->right) >= height_of(right->left))
+                return make_node(right->key, make_node(key, left, right->left), right->right);
+
+            node* inner = right->left;
+            replaced.push_back(inner);
+            return make_node(inner->key, make_node(key, left, inner->left), make_node(right->key, inner->right, right->right));
+        }
+
+        return make_node(key, left, right);
+    }
+
+    /* The key must not be in the subtree yet */
+    node* insert_below(node* subtree_root, const value_type& key)
+    {
+        if(subtree_root == nullptr)
+            return make_node(key, nullptr, nullptr);
+
+        replaced.push_back(subtree_root);
+        if(compare(key, subtree_root->key))
+            return join(subtree_root->key, insert_below(subtree_root->left, key), subtree_root->right);
+
+        return join(subtree_root->key, subtree_root->left, insert_below(subtree_root->right, key));
+    }
+
+    /* Returns the subtree without its smallest key, which is left in minimum_key */
+    node* erase_minimum(node* subtree_root, const value_type*& minimum_key)
+    {
+        replaced.push_back(subtree_root);
+        if(subtree_root->left == nullptr)
+        {
+            minimum_key = &subtree_root->key;
+            return subtree_root->right;
+        }
+
+        return join(subtree_root->key, erase_minimum(subtree_root->left, minimum_key), subtree_root->right);
+    }
+
+    /* The key must be in the subtree */
+    template<typename _Key>
+    node* erase_below(node* subtree_root, const _Key& key)
+    {
+        replaced.push_back(subtree_root);
+        if(compare(key, subtree_root->key))
+            return join(subtree_root->key, erase_below(subtree_root->left, key), subtree_root->right);
+        if(compare(subtree_root->key, key))
+            return join(subtree_root->key, subtree_root->left, erase_below(subtree_root->right, key));
+
+        if(subtree_root->left == nullptr)
+            return subtree_root->right;
+        if(subtree_root->right == nullptr)
+            return subtree_root->left;
+
+        const value_type* minimum_key = nullptr;
+        node* right = erase_minimum(subtree_root->right, minimum_key);
+        return join(*minimum_key, subtree_root->left, right);
+    }
+
+    /* Makes new_root visible to readers and retires what the write replaced. Nothing can throw after the store. */
+    void publish(node* new_root)
+    {
+        retired.reserve(replaced.size());
+        root.store(new_root, std::memory_order_release);
+        for(node* old_node : replaced)
+            retired.retire(old_node);
+
+        replaced.clear();
+        created.clear();
+        retired.collect();
+    }
+
+    /* Undoes a write that failed before publishing; nothing it built was ever visible */
+    void discard()
+    {
+        for(node* new_node : created)
+            delete new_node;
+
+        replaced.clear();
+        created.clear();
+    }
+
+    template<typename _Key>
+    bool erase_key(const _Key& key)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        node* old_root = root.load(std::memory_order_relaxed);
+        if(find_node(old_root, key) == nullptr)
+            return false;
+
+        reserve_for_write(old_root);
+        try
+        {
+            publish(erase_below(old_root, key));
+        }
+        catch(...)
+        {
+            discard();
+            throw;
+        }
+
+        node_count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /* Height of the subtree when it is an AVL tree of correctly stored heights with every key strictly
+       between lower and upper (either may be null), else -1. Adds its nodes to node_total. */
+    int checked_height(const node* subtree_root, const value_type* lower, const value_type* upper, size_type& node_total) const
+    {
+        if(subtree_root == nullptr)
+            return 0;
+
+        if((lower != nullptr && !compare(*lower, subtree_root->key)) || (upper != nullptr && !compare(subtree_root->key, *upper)))
+            return -1;
+
+        ++node_total;
+        const int left_height = checked_height(subtree_root->left, lower, &subtree_root->key, node_total);
+        const int right_height = checked_height(subtree_root->right, &subtree_root->key, upper, node_total);
+        if(left_height < 0 || right_height < 0 || left_height > right_height + 1 || right_height > left_height + 1 ||
+           subtree_root->height != 1 + std::max(left_height, right_height))
+            return -1;
+
+        return subtree_root->height;
+    }
+
+    template<typename _Key>
+    std::optional<value_type> search_key(const _Key& key) const
+    {
+        epoch_guard guard;
+        const node* found_node = find_node(root.load(std::memory_order_acquire), key);
+        if(found_node == nullptr)
+            return std::nullopt;
+
+        return found_node->key;
+    }
+
+ public:
+    concurrent_bst() = default;
+
+    explicit concurrent_bst(const key_compare& comp) : compare(comp) {}
+
+    concurrent_bst(const concurrent_bst&) = delete;
+    concurrent_bst& operator=(const concurrent_bst&) = delete;
+
+    /* No other thread may still be using the tree */
+    ~concurrent_bst()
+    {
+        std::vector<node*> pending;
+        if(node* current_root = root.load(std::memory_order_acquire))
+            pending.push_back(current_root);
+
+        while(!pending.empty())
+        {
+            node* current_node = pending.back();
+            pending.pop_back();
+            if(current_node->left != nullptr)
+                pending.push_back(current_node->left);
+            if(current_node->right != nullptr)
+                pending.push_back(current_node->right);
+
+            delete current_node;
+        }
+    }
+
+    key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    size_type size() const
+    {
+        return node_count.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /* Returns false, leaving the tree alone, when an equivalent key is already there */
+    bool insert(const value_type& key)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        node* old_root = root.load(std::memory_order_relaxed);
+        if(find_node(old_root, key) != nullptr)
+            return false;
+
+        reserve_for_write(old_root);
+        try
+        {
+            publish(insert_below(old_root, key));
+        }
+        catch(...)
+        {
+            discard();
+            throw;
+        }
+
+        node_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /* Returns false when the key was not there */
+    bool delete_node(const value_type& key)
+    {
+        return erase_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool delete_node(const _Key& key)
+    {
+        return erase_key(key);
+    }
+
+    bool contains(const value_type& key) const
+    {
+        epoch_guard guard;
+        return find_node(root.load(std::memory_order_acquire), key) != nullptr;
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool contains(const _Key& key) const
+    {
+        epoch_guard guard;
+        return find_node(root.load(std::memory_order_acquire), key) != nullptr;
+    }
+
+    /* A copy of the stored key equivalent to key, if any */
+    std::optional<value_type> search(const value_type& key) const
+    {
+        return search_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    std::optional<value_type> search(const _Key& key) const
+    {
+        return search_key(key);
+    }
+
+    std::optional<value_type> minimum() const
+    {
+        epoch_guard guard;
+        const node* current_node = root.load(std::memory_order_acquire);
+        if(current_node == nullptr)
+            return std::nullopt;
+
+        while(current_node->left != nullptr)
+            current_node = current_node->left;
+
+        return current_node->key;
+    }
+
+    std::optional<value_type> maximum() const
+    {
+        epoch_guard guard;
+        const node* current_node = root.load(std::memory_order_acquire);
+        if(current_node == nullptr)
+            return std::nullopt;
+
+        while(current_node->right != nullptr)
+            current_node = current_node->right;
+
+        return current_node->key;
+    }
+
+    /*
+     * Checks the tree as of one instant: keys strictly ascending, stored heights right and AVL balanced.
+     * The node count is compared with size() only when no write is running, since size() is updated after
+     * the root is swung. O(n), for tests.
+     */
+    bool check_invariants(bool writes_running = false) const
+    {
+        epoch_guard guard;
+        size_type node_total = 0;
+        if(checked_height(root.load(std::memory_order_acquire), nullptr, nullptr, node_total) < 0)
+            return false;
+
+        return writes_running || node_total == size();
+    }
+
+    /*
+     * Calls visit(key) for every key in ascending order, as of one instant: writes that land during the
+     * walk are not seen. Memory retired meanwhile is held back until the walk ends.
+     */
+    template<typename _Visitor>
+    void for_each(_Visitor&& visit) const
+    {
+        epoch_guard guard;
+        const node* current_node = root.load(std::memory_order_acquire);
+        std::vector<const node*> ancestors;
+        ancestors.reserve(static_cast<std::size_t>(height_of(current_node)));
+        while(current_node != nullptr || !ancestors.empty())
+        {
+            while(current_node != nullptr)
+            {
+                ancestors.push_back(current_node);
+                current_node = current_node->left;
+            }
+
+            current_node = ancestors.back();
+            ancestors.pop_back();
+            visit(current_node->key);
+            current_node = current_node->right;
+        }
+    }
+};
+}
+
+#endif // BST_CONCURRENT_HPP_INCLUDED
@@ -0,0 +1,202 @@
+#ifndef BST_EPOCH_HPP_INCLUDED
+#define BST_EPOCH_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace BST
+{
+/*
+ * Epoch-based memory reclamation, one domain per process.
+ *
+ * A reader pins the current global epoch for as long as it holds pointers into a shared structure
+ * (see epoch_guard). A writer that unlinks memory retires it with the epoch it observed after the
+ * unlink; the memory is freed once the global epoch is two steps further, because the epoch can only
+ * advance when every pinned reader has seen the latest value, so no reader can still reach it.
+ */
+class epoch_domain
+{
+ private:
+    struct alignas(64) participant
+    {
+        /* (pinned epoch << 1) | 1 while inside a read section, 0 otherwise */
+        std::atomic<std::uint64_t> state{0};
+        std::atomic<bool> in_use{false};
+        unsigned depth = 0; /* Nesting level, only touched by the owning thread */
+        participant* next = nullptr;
+    };
+
+    /* Gives the thread's participant record back when the thread exits */
+    struct thread_slot
+    {
+        participant* record = nullptr;
+
+        ~thread_slot()
+        {
+            if(record != nullptr)
+                record->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    std::atomic<std::uint64_t> global_epoch{2};
+    std::atomic<participant*> participants{nullptr};
+
+    epoch_domain() = default;
+
+    participant* acquire_participant()
+    {
+        for(participant* record = participants.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            bool expected = false;
+            if(!record->in_use.load(std::memory_order_relaxed) && record->in_use.compare_exchange_strong(expected, true))
+                return record;
+        }
+
+        participant* record = new participant;
+        record->in_use.store(true, std::memory_order_relaxed);
+        record->next = participants.load(std::memory_order_relaxed);
+        while(!participants.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return record;
+    }
+
+    participant& local_participant()
+    {
+        thread_local thread_slot slot;
+        if(slot.record == nullptr)
+            slot.record = acquire_participant();
+
+        return *slot.record;
+    }
+
+ public:
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    ~epoch_domain()
+    {
+        participant* record = participants.load(std::memory_order_relaxed);
+        while(record != nullptr)
+        {
+            participant* next_record = record->next;
+            delete record;
+            record = next_record;
+        }
+    }
+
+    static epoch_domain& instance()
+    {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    void enter()
+    {
+        participant& record = local_participant();
+        if(record.depth++ == 0)
+            record.state.store((global_epoch.load(std::memory_order_seq_cst) << 1) | 1, std::memory_order_seq_cst);
+    }
+
+    void exit()
+    {
+        participant& record = local_participant();
+        if(--record.depth == 0)
+            record.state.store(0, std::memory_order_release);
+    }
+
+    std::uint64_t current_epoch() const
+    {
+        return global_epoch.load(std::memory_order_seq_cst);
+    }
+
+    /* Moves the global epoch forward if every pinned reader has caught up with it; returns the epoch */
+    std::uint64_t try_advance()
+    {
+        std::uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        for(participant* record = participants.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            std::uint64_t state = record->state.load(std::memory_order_seq_cst);
+            if((state & 1) != 0 && (state >> 1) != epoch)
+                return epoch;
+        }
+
+        global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+        return global_epoch.load(std::memory_order_seq_cst);
+    }
+};
+
+/* Pins the current epoch for the lifetime of the guard */
+class epoch_guard
+{
+ public:
+    epoch_guard() { epoch_domain::instance().enter(); }
+    ~epoch_guard() { epoch_domain::instance().exit(); }
+
+    epoch_guard(const epoch_guard&) = delete;
+    epoch_guard& operator=(const epoch_guard&) = delete;
+};
+
+/*
+ * Memory retired by one writer (or by writers holding a common lock), waiting for the readers that
+ * may still see it. _Deleter frees one retired pointer.
+ */
+template<typename _Tp, typename _Deleter>
+class retire_list
+{
+ private:
+    std::vector<std::pair<std::uint64_t, _Tp*>> retired;
+    [[no_unique_address]] _Deleter deleter;
+
+ public:
+    retire_list() = default;
+
+    explicit retire_list(_Deleter deleter) : deleter(std::move(deleter)) {}
+
+    retire_list(const retire_list&) = delete;
+    retire_list& operator=(const retire_list&) = delete;
+
+    ~retire_list()
+    {
+        for(auto& [epoch, pointer] : retired)
+            deleter(pointer);
+    }
+
+    /* Makes room for extra more retire() calls, so that those cannot throw */
+    void reserve(std::size_t extra)
+    {
+        retired.reserve(retired.size() + extra);
+    }
+
+    /* Call only after pointer has been unlinked from everything readers can reach */
+    void retire(_Tp* pointer)
+    {
+        retired.emplace_back(epoch_domain::instance().current_epoch(), pointer);
+    }
+
+    /* Frees whatever no reader can reach any more */
+    void collect()
+    {
+        std::uint64_t epoch = epoch_domain::instance().try_advance();
+        std::size_t kept = 0;
+        for(auto& entry : retired)
+        {
+            if(entry.first + 2 <= epoch)
+                deleter(entry.second);
+            else
+                retired[kept++] = entry;
+        }
+
+        retired.resize(kept);
+    }
+
+    std::size_t pending() const
+    {
+        return retired.size();
+    }
+};
+}
+
+#endif // BST_EPOCH_HPP_INCLUDED
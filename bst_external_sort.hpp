@@ -0,0 +1,265 @@
+#ifndef BST_EXTERNAL_SORT_HPP_INCLUDED
+#define BST_EXTERNAL_SORT_HPP_INCLUDED
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bst.hpp"
+
+namespace BST
+{
+/*
+ * Sorted runs of bst_sort_external, stored back to back in one unnamed temporary file (removed when it
+ * is closed), so the number of runs never runs into the limit on open files.
+ */
+template<typename _Tp>
+class run_file
+{
+ private:
+    struct file_closer
+    {
+        void operator()(std::FILE* file) const { std::fclose(file); }
+    };
+
+    struct run
+    {
+        std::uint64_t first_key;
+        std::uint64_t key_count;
+    };
+
+    std::unique_ptr<std::FILE, file_closer> file;
+    std::vector<run> runs;
+    std::uint64_t keys_written = 0;
+
+    void seek(std::uint64_t key_offset)
+    {
+        const std::uint64_t byte_offset = key_offset * sizeof(_Tp);
+#ifdef _WIN32
+        const bool moved = _fseeki64(file.get(), static_cast<long long>(byte_offset), SEEK_SET) == 0;
+#else
+        const bool moved = fseeko(file.get(), static_cast<off_t>(byte_offset), SEEK_SET) == 0;
+#endif
+        if(!moved)
+            throw std::runtime_error("bst_sort_external: cannot seek in a temporary file");
+    }
+
+ public:
+    run_file() : file(std::tmpfile())
+    {
+        if(!file)
+            throw std::runtime_error("bst_sort_external: cannot create a temporary file");
+    }
+
+    std::size_t size() const
+    {
+        return runs.size();
+    }
+
+    std::uint64_t run_first_key(std::size_t run) const
+    {
+        return runs[run].first_key;
+    }
+
+    std::uint64_t run_size(std::size_t run) const
+    {
+        return runs[run].key_count;
+    }
+
+    /* Starts a run after the last one; write() then appends its keys in order */
+    void start_run()
+    {
+        runs.push_back(run{keys_written, 0});
+    }
+
+    void write(const _Tp* keys, std::size_t count)
+    {
+        if(std::fwrite(keys, sizeof(_Tp), count, file.get()) != count)
+            throw std::runtime_error("bst_sort_external: cannot write a temporary file");
+
+        keys_written += count;
+        runs.back().key_count += count;
+    }
+
+    /* Reads count keys from key_offset on, counted from the start of the file */
+    void read(std::uint64_t key_offset, _Tp* keys, std::size_t count)
+    {
+        seek(key_offset);
+        if(std::fread(keys, sizeof(_Tp), count, file.get()) != count)
+            throw std::runtime_error("bst_sort_external: cannot read a temporary file");
+    }
+};
+
+/* Reads one run of a run_file back a block at a time during a merge */
+template<typename _Tp>
+class run_reader
+{
+ private:
+    run_file<_Tp>* source;
+    std::uint64_t next_key;  /* Offset in source of the first key not read yet */
+    std::uint64_t keys_left; /* Keys of the run not read yet */
+    std::vector<_Tp> block;
+    std::size_t position = 0; /* Next key of block to hand out */
+    std::size_t filled = 0;   /* Keys of block read back from the file */
+
+    void refill()
+    {
+        position = 0;
+        filled = static_cast<std::size_t>(std::min<std::uint64_t>(block.size(), keys_left));
+        if(filled != 0)
+            source->read(next_key, block.data(), filled);
+
+        next_key += filled;
+        keys_left -= filled;
+    }
+
+ public:
+    run_reader(run_file<_Tp>& source, std::size_t run, std::size_t block_size)
+        : source(&source), next_key(source.run_first_key(run)), keys_left(source.run_size(run)), block(block_size)
+    {
+        refill();
+    }
+
+    /* The smallest key not handed out yet, or nullptr once the run is exhausted */
+    const _Tp* front() const
+    {
+        return (position < filled) ? &block[position] : nullptr;
+    }
+
+    void pop()
+    {
+        if(++position == filled)
+            refill();
+    }
+};
+
+/*
+ * Merges runs [first_run, last_run) of source, handing each key to emit in order. Among equal keys the
+ * earlier run, holding the earlier input, goes first.
+ */
+template<typename _Tp, typename _Compare, typename _Emit>
+void merge_runs(run_file<_Tp>& source, std::size_t first_run, std::size_t last_run, std::size_t block_size, _Compare& comp, _Emit emit)
+{
+    std::vector<run_reader<_Tp>> readers;
+    readers.reserve(last_run - first_run);
+    for(std::size_t run = first_run; run < last_run; ++run)
+        readers.emplace_back(source, run, block_size);
+
+    auto comes_later = [&](std::size_t lhs, std::size_t rhs)
+    {
+        const _Tp& lhs_key = *readers[lhs].front();
+        const _Tp& rhs_key = *readers[rhs].front();
+        return comp(rhs_key, lhs_key) || (!comp(lhs_key, rhs_key) && rhs < lhs);
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(comes_later)> next_reader(comes_later);
+    for(std::size_t reader = 0; reader < readers.size(); ++reader)
+    {
+        if(readers[reader].front() != nullptr)
+            next_reader.push(reader);
+    }
+
+    while(!next_reader.empty())
+    {
+        std::size_t reader = next_reader.top();
+        next_reader.pop();
+        emit(*readers[reader].front());
+        readers[reader].pop();
+        if(readers[reader].front() != nullptr)
+            next_reader.push(reader);
+    }
+}
+
+/*
+ * bst_sort_copy for inputs that do not fit in memory. [first, last) is read in one pass, a run of
+ * about memory_limit bytes at a time: each run is sorted by bst_sort and spilled to a temporary file.
+ * The runs are then merged at most fan_in at a time, in as many passes over the disk as it takes to
+ * leave fan_in runs, and those are merged into out. Equal elements keep their input order. Input that
+ * fits in a single run never touches the disk.
+ *
+ * A run's buffer, bst_sort's copy of it and the tree of the bucket being sorted take about
+ * memory_limit bytes together, and so do the read blocks of a merge, memory_limit / (fan_in + 1)
+ * bytes each. Runs are written as raw bytes, hence the trivially copyable elements.
+ * Throws std::runtime_error when a temporary file cannot be created, written or read.
+ */
+template<std::input_iterator InputIt, typename OutputIt, typename _Compare = std::less<>>
+    requires std::is_trivially_copyable_v<std::iter_value_t<InputIt>> && std::default_initializable<std::iter_value_t<InputIt>>
+OutputIt bst_sort_external(InputIt first, InputIt last, OutputIt out, std::size_t memory_limit, _Compare comp = _Compare())
+{
+    using value_type = std::iter_value_t<InputIt>;
+    constexpr std::size_t minimum_run = 4096;
+    constexpr std::size_t max_fan_in = 128;
+    constexpr std::size_t preferred_block_bytes = std::size_t(1) << 16;
+
+    /* As many runs per merge as leave each a block of the preferred size, between 2 and max_fan_in */
+    const std::size_t fan_in = std::clamp<std::size_t>(memory_limit / preferred_block_bytes, 2, max_fan_in);
+    const std::size_t block_size = std::max<std::size_t>(1, memory_limit / ((fan_in + 1) * sizeof(value_type)));
+    const std::size_t run_size = std::max(minimum_run, memory_limit / (2 * sizeof(value_type) + sizeof(std::uint32_t)));
+
+    std::optional<run_file<value_type>> spilled;
+    {
+        std::vector<value_type> run_keys;
+        run_keys.reserve(run_size);
+        while(first != last)
+        {
+            for(; first != last && run_keys.size() < run_size; ++first)
+                run_keys.push_back(*first);
+
+            bst_sort(run_keys.begin(), run_keys.end(), comp);
+            if(!spilled && first == last)
+                return std::move(run_keys.begin(), run_keys.end(), out);
+
+            if(!spilled)
+                spilled.emplace();
+
+            spilled->start_run();
+            spilled->write(run_keys.data(), run_keys.size());
+            run_keys.clear();
+        }
+    }
+
+    if(!spilled)
+        return out;
+
+    /* Each pass merges consecutive groups of fan_in runs into one, which keeps equal keys in input order */
+    std::vector<value_type> merged_block;
+    while(spilled->size() > fan_in)
+    {
+        run_file<value_type> merged;
+        merged_block.reserve(block_size);
+        for(std::size_t first_run = 0; first_run < spilled->size(); first_run += fan_in)
+        {
+            merged.start_run();
+            merge_runs(*spilled, first_run, std::min(first_run + fan_in, spilled->size()), block_size, comp,
+                       [&](const value_type& key)
+                       {
+                           merged_block.push_back(key);
+                           if(merged_block.size() == block_size)
+                           {
+                               merged.write(merged_block.data(), merged_block.size());
+                               merged_block.clear();
+                           }
+                       });
+            merged.write(merged_block.data(), merged_block.size());
+            merged_block.clear();
+        }
+
+        spilled.emplace(std::move(merged));
+    }
+
+    merge_runs(*spilled, 0, spilled->size(), block_size, comp, [&](const value_type& key) { *out++ = key; });
+    return out;
+}
+}
+
+#endif // BST_EXTERNAL_SORT_HPP_INCLUDED
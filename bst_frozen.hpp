@@ -0,0 +1,411 @@
+#ifndef BST_FROZEN_HPP_INCLUDED
+#define BST_FROZEN_HPP_INCLUDED
+
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace BST
+{
+/*
+ * Read-only lookups over a sorted sequence stored in Eytzinger (BFS) order: the root lives in slot 1
+ * and the children of slot k in slots 2k and 2k + 1, so a lookup walks one contiguous array with no
+ * pointers. The descent is branch-free and prefetches the cache line holding the node's descendants a
+ * few levels down, which keeps several memory accesses in flight on trees far larger than the caches.
+ *
+ * The view does not own the slots. frozen_bst keeps them on the heap and mapped_bst (bst_io.hpp) in
+ * a memory-mapped snapshot file. Lookups return a pointer to the stored key, or nullptr, like
+ * binary_search_tree returns nodes.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class eytzinger_view
+{
+ public:
+    using value_type = _Tp;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+    using const_pointer = const value_type*;
+
+    static constexpr bool transparent_compare = requires { typename _Compare::is_transparent; };
+
+    /* Visits the keys in ascending order */
+    class const_iterator
+    {
+     public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = _Tp;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const _Tp*;
+        using reference = const _Tp&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return view->slots[slot]; }
+        pointer operator->() const { return view->slots + slot; }
+
+        const_iterator& operator++()
+        {
+            slot = next_slot(slot, view->key_count);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        /* Decrementing end() gives the largest key */
+        const_iterator& operator--()
+        {
+            slot = (slot == 0) ? last_slot(view->key_count) : previous_slot(slot, view->key_count);
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return lhs.slot == rhs.slot;
+        }
+
+     private:
+        friend class eytzinger_view;
+
+        const eytzinger_view* view = nullptr;
+        size_type slot = 0;
+
+        const_iterator(const eytzinger_view* view, size_type slot) : view(view), slot(slot) {}
+    };
+
+ protected:
+    static constexpr std::size_t cache_line = 64;
+
+    /* Slots between a node and the first descendant sharing a cache line with its siblings */
+    static constexpr size_type prefetch_stride = (sizeof(value_type) < cache_line) ? cache_line / sizeof(value_type) : 1;
+
+    /* Slot 0 holds no key, so slots[16k .. 16k + 15] of 4-byte keys is one aligned cache line */
+    const value_type* slots = nullptr;
+    size_type key_count = 0;
+    [[no_unique_address]] _Compare compare;
+
+    /* Eytzinger slot of the smallest key among key_count keys */
+    static size_type first_slot(size_type key_count)
+    {
+        return (key_count == 0) ? 0 : std::bit_floor(key_count);
+    }
+
+    static size_type last_slot(size_type key_count)
+    {
+        return (key_count == 0) ? 0 : std::bit_floor(key_count + 1) - 1;
+    }
+
+    /* Next slot in key order, or 0 */
+    static size_type next_slot(size_type slot, size_type key_count)
+    {
+        if(2 * slot + 1 <= key_count)
+        {
+            slot = 2 * slot + 1;
+            while(2 * slot <= key_count)
+                slot = 2 * slot;
+            return slot;
+        }
+
+        return slot >> (std::countr_one(slot) + 1);
+    }
+
+    /* Previous slot in key order, or 0 */
+    static size_type previous_slot(size_type slot, size_type key_count)
+    {
+        if(2 * slot <= key_count)
+        {
+            slot = 2 * slot;
+            while(2 * slot + 1 <= key_count)
+                slot = 2 * slot + 1;
+            return slot;
+        }
+
+        return slot >> (std::countr_zero(slot) + 1);
+    }
+
+    void prefetch(size_type slot) const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(reinterpret_cast<const char*>(slots) + slot * prefetch_stride * sizeof(value_type));
+#else
+        (void)slot;
+#endif
+    }
+
+    /* Slot of the first key for which goes_right is false, or 0. The descent takes no branch on keys. */
+    template<typename _GoesRight>
+    size_type descend(_GoesRight goes_right) const
+    {
+        size_type slot = 1;
+        while(slot <= key_count)
+        {
+            prefetch(slot);
+            slot = 2 * slot + static_cast<size_type>(goes_right(slots[slot]));
+        }
+
+        /* Undo the trailing right turns and the final left turn */
+        return slot >> (std::countr_one(slot) + 1);
+    }
+
+    template<typename _Key>
+    const_pointer lower_bound_key(const _Key& key) const
+    {
+        return to_pointer(descend([&](const value_type& slot_key) { return compare(slot_key, key); }));
+    }
+
+    template<typename _Key>
+    const_pointer upper_bound_key(const _Key& key) const
+    {
+        return to_pointer(descend([&](const value_type& slot_key) { return !compare(key, slot_key); }));
+    }
+
+    template<typename _Key>
+    const_pointer search_key(const _Key& key) const
+    {
+        const_pointer found = lower_bound_key(key);
+        return (found != nullptr && !compare(key, *found)) ? found : nullptr;
+    }
+
+    const_pointer to_pointer(size_type slot) const
+    {
+        return (slot != 0) ? slots + slot : nullptr;
+    }
+
+    size_type to_slot(const_pointer key) const
+    {
+        return static_cast<size_type>(key - slots);
+    }
+
+ public:
+    eytzinger_view() = default;
+
+    /* slots[1 .. key_count] in Eytzinger order; slots[0] is never read */
+    eytzinger_view(const value_type* slots, size_type key_count, const key_compare& comp = key_compare())
+        : slots(slots), key_count(key_count), compare(comp) {}
+
+    size_type size() const
+    {
+        return key_count;
+    }
+
+    bool empty() const
+    {
+        return key_count == 0;
+    }
+
+    key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    const_pointer search(const value_type& key) const
+    {
+        return search_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer search(const _Key& key) const
+    {
+        return search_key(key);
+    }
+
+    bool contains(const value_type& key) const
+    {
+        return search_key(key) != nullptr;
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool contains(const _Key& key) const
+    {
+        return search_key(key) != nullptr;
+    }
+
+    /* The smallest key not less than key, or nullptr */
+    const_pointer lower_bound(const value_type& key) const
+    {
+        return lower_bound_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer lower_bound(const _Key& key) const
+    {
+        return lower_bound_key(key);
+    }
+
+    /* The smallest key greater than key, or nullptr */
+    const_pointer upper_bound(const value_type& key) const
+    {
+        return upper_bound_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer upper_bound(const _Key& key) const
+    {
+        return upper_bound_key(key);
+    }
+
+    const_pointer minimum() const
+    {
+        return to_pointer(first_slot(key_count));
+    }
+
+    const_pointer maximum() const
+    {
+        return to_pointer(last_slot(key_count));
+    }
+
+    /* key must point into this view */
+    const_pointer successor(const_pointer key) const
+    {
+        return to_pointer(next_slot(to_slot(key), key_count));
+    }
+
+    const_pointer predecessor(const_pointer key) const
+    {
+        return to_pointer(previous_slot(to_slot(key), key_count));
+    }
+
+    /* The slot array, slots[0] included, as written to a snapshot (see bst_io.hpp) */
+    const value_type* data() const
+    {
+        return slots;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, first_slot(key_count));
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, 0);
+    }
+};
+
+/*
+ * Immutable snapshot of a sorted sequence in Eytzinger order, owning its slots in one cache-aligned
+ * heap block. Built by binary_search_tree::freeze() or from any range sorted by _Compare.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class frozen_bst : public eytzinger_view<_Tp, _Compare>
+{
+    using view_type = eytzinger_view<_Tp, _Compare>;
+
+ public:
+    using typename view_type::value_type;
+    using typename view_type::key_compare;
+    using typename view_type::size_type;
+
+ private:
+    static constexpr std::align_val_t slot_alignment{alignof(value_type) > view_type::cache_line ? alignof(value_type) : view_type::cache_line};
+
+    value_type* owned_slots = nullptr;
+
+    static value_type* allocate_slots(size_type key_count)
+    {
+        return static_cast<value_type*>(::operator new((key_count + 1) * sizeof(value_type), slot_alignment));
+    }
+
+    static void deallocate_slots(value_type* slots)
+    {
+        ::operator delete(slots, slot_alignment);
+    }
+
+    /* Destroys the keys in the first constructed_count slots in key order */
+    void destroy_first(size_type constructed_count)
+    {
+        for(size_type slot = this->first_slot(this->key_count); constructed_count != 0; slot = this->next_slot(slot, this->key_count), --constructed_count)
+            std::destroy_at(owned_slots + slot);
+    }
+
+    void release()
+    {
+        if(owned_slots == nullptr)
+            return;
+
+        destroy_first(this->key_count);
+        deallocate_slots(owned_slots);
+        owned_slots = nullptr;
+        this->slots = nullptr;
+        this->key_count = 0;
+    }
+
+ public:
+    frozen_bst() = default;
+
+    /* count keys from first, in ascending order */
+    template<std::input_iterator InputIt>
+    frozen_bst(InputIt first, size_type count, const key_compare& comp = key_compare())
+        : view_type(nullptr, count, comp), owned_slots(allocate_slots(count))
+    {
+        this->slots = owned_slots;
+        size_type constructed_count = 0;
+        try
+        {
+            for(size_type slot = this->first_slot(count); slot != 0; slot = this->next_slot(slot, count), ++first, ++constructed_count)
+                std::construct_at(owned_slots + slot, *first);
+        }
+        catch(...)
+        {
+            destroy_first(constructed_count);
+            deallocate_slots(owned_slots);
+            throw;
+        }
+    }
+
+    template<std::forward_iterator ForwardIt>
+    frozen_bst(ForwardIt first, ForwardIt last, const key_compare& comp = key_compare())
+        : frozen_bst(first, static_cast<size_type>(std::distance(first, last)), comp) {}
+
+    frozen_bst(const frozen_bst& other) : view_type(other), owned_slots(allocate_slots(other.key_count))
+    {
+        this->slots = owned_slots;
+        try
+        {
+            std::uninitialized_copy(other.owned_slots + 1, other.owned_slots + other.key_count + 1, owned_slots + 1);
+        }
+        catch(...)
+        {
+            deallocate_slots(owned_slots);
+            throw;
+        }
+    }
+
+    frozen_bst(frozen_bst&& other) noexcept : view_type(other), owned_slots(std::exchange(other.owned_slots, nullptr))
+    {
+        other.slots = nullptr;
+        other.key_count = 0;
+    }
+
+    frozen_bst& operator=(frozen_bst other) noexcept
+    {
+        std::swap(owned_slots, other.owned_slots);
+        std::swap(this->slots, other.slots);
+        std::swap(this->key_count, other.key_count);
+        std::swap(this->compare, other.compare);
+        return *this;
+    }
+
+    ~frozen_bst()
+    {
+        release();
+    }
+};
+}
+
+#endif // BST_FROZEN_HPP_INCLUDED
@@ -0,0 +1,323 @@
+#ifndef BST_IO_HPP_INCLUDED
+#define BST_IO_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BST_IO_MMAP 1
+#else
+#define BST_IO_MMAP 0
+#endif
+
+#include "bst_frozen.hpp"
+
+namespace BST
+{
+/*
+ * Tree snapshot file, version 1:
+ *
+ *   bytes 0 .. 63    snapshot_header
+ *   bytes 64 ..      key_count + 1 slots of key_size bytes: the keys in Eytzinger order as in
+ *                    frozen_bst, after a zero-filled slot 0
+ *
+ * The keys are the raw bytes of trivially copyable values, so a snapshot is only read back by the
+ * same key type on a machine with the same byte order, which byte_order, key_size and key_alignment
+ * check. Offset 64 keeps the slots of a page-aligned mapping on cache-line boundaries.
+ */
+struct snapshot_header
+{
+    static constexpr char expected_magic[8] = {'B', 'S', 'T', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t native_byte_order = 0x01020304;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t key_size;
+    std::uint32_t key_alignment;
+    std::uint64_t key_count;
+    std::uint64_t payload_checksum; /* Of the key_count keys after slot 0 */
+    std::uint64_t header_checksum;  /* Of the header bytes before this field */
+    std::uint8_t reserved[16];
+};
+
+static_assert(sizeof(snapshot_header) == 64 && std::is_trivially_copyable_v<snapshot_header>, "snapshot header must be 64 plain bytes");
+
+/* How much of a snapshot mapped_bst checks when it opens one */
+enum class snapshot_check
+{
+    full,       /* Header and payload checksums: reads the whole file once */
+    header_only /* Header checksum and sizes: O(1), pages are read on first touch */
+};
+
+/*
+ * 64-bit checksum of a byte range. Four independent multiply-xor lanes over 8-byte words keep it near
+ * memory bandwidth on large snapshots. It catches corruption, not tampering.
+ */
+inline std::uint64_t snapshot_checksum(const void* data, std::size_t length)
+{
+    constexpr std::uint64_t multiplier = 0x9E3779B185EBCA87ull;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t lanes[4] = {1, 2, 3, 4};
+
+    std::size_t offset = 0;
+    for(; offset + sizeof(lanes) <= length; offset += sizeof(lanes))
+    {
+        for(std::size_t lane = 0; lane < 4; ++lane)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + offset + lane * sizeof(word), sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * multiplier;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    for(; offset < length; ++offset)
+        lanes[0] = (lanes[0] ^ bytes[offset]) * multiplier;
+
+    std::uint64_t checksum = length;
+    for(std::uint64_t lane : lanes)
+    {
+        checksum = (checksum ^ lane) * multiplier;
+        checksum ^= checksum >> 32;
+    }
+
+    return checksum;
+}
+
+/*
+ * Writes the keys of view to path as a snapshot. The file is written next to path and renamed over it
+ * once complete, so a crash never leaves a truncated snapshot behind. Throws std::runtime_error when
+ * the file cannot be written.
+ */
+template<typename _Tp, typename _Compare>
+void write_snapshot(const std::filesystem::path& path, const eytzinger_view<_Tp, _Compare>& view)
+{
+    static_assert(std::is_trivially_copyable_v<_Tp>, "snapshots store keys as raw bytes");
+
+    const std::size_t payload_size = view.size() * sizeof(_Tp);
+    const _Tp* keys = view.empty() ? nullptr : view.data() + 1;
+    snapshot_header header{};
+    std::memcpy(header.magic, snapshot_header::expected_magic, sizeof(header.magic));
+    header.version = snapshot_header::current_version;
+    header.byte_order = snapshot_header::native_byte_order;
+    header.key_size = sizeof(_Tp);
+    header.key_alignment = alignof(_Tp);
+    header.key_count = view.size();
+    header.payload_checksum = snapshot_checksum(keys, payload_size);
+    header.header_checksum = snapshot_checksum(&header, offsetof(snapshot_header, header_checksum));
+
+    struct file_closer
+    {
+        void operator()(std::FILE* file) const { std::fclose(file); }
+    };
+
+    std::filesystem::path partial_path = path;
+    partial_path += ".partial";
+    const unsigned char empty_slot[sizeof(_Tp)] = {};
+    {
+        std::unique_ptr<std::FILE, file_closer> file(std::fopen(partial_path.string().c_str(), "wb"));
+        bool written = file && std::fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+                       std::fwrite(empty_slot, sizeof(empty_slot), 1, file.get()) == 1 &&
+                       (payload_size == 0 || std::fwrite(keys, 1, payload_size, file.get()) == payload_size);
+        written = written && std::fclose(file.release()) == 0;
+        if(!written)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(partial_path, ignored);
+            throw std::runtime_error("bst: cannot write snapshot " + path.string());
+        }
+    }
+
+    std::error_code rename_error;
+    std::filesystem::rename(partial_path, path, rename_error);
+    if(rename_error)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(partial_path, ignored);
+        throw std::runtime_error("bst: cannot write snapshot " + path.string() + ": " + rename_error.message());
+    }
+}
+
+/* Checks file_size bytes holding a snapshot of _Tp keys and returns the key count. Throws std::runtime_error. */
+template<typename _Tp>
+std::size_t validate_snapshot(const void* file_bytes, std::size_t file_size, snapshot_check check, const std::filesystem::path& path)
+{
+    auto reject = [&](const char* reason) { return std::runtime_error("bst: " + path.string() + " " + reason); };
+
+    snapshot_header header;
+    if(file_size < sizeof(header))
+        throw reject("is not a tree snapshot");
+
+    std::memcpy(&header, file_bytes, sizeof(header));
+    if(std::memcmp(header.magic, snapshot_header::expected_magic, sizeof(header.magic)) != 0)
+        throw reject("is not a tree snapshot");
+    if(header.byte_order != snapshot_header::native_byte_order)
+        throw reject("was written with another byte order");
+    if(header.version != snapshot_header::current_version)
+        throw reject("has an unsupported snapshot version");
+    if(header.header_checksum != snapshot_checksum(&header, offsetof(snapshot_header, header_checksum)))
+        throw reject("has a corrupt header");
+    if(header.key_size != sizeof(_Tp) || header.key_alignment != alignof(_Tp))
+        throw reject("holds keys of another type");
+    if(header.key_count > (file_size - sizeof(header)) / sizeof(_Tp) || file_size != sizeof(header) + (header.key_count + 1) * sizeof(_Tp))
+        throw reject("is truncated");
+
+    const std::size_t key_count = static_cast<std::size_t>(header.key_count);
+    if(check == snapshot_check::full)
+    {
+        const unsigned char* payload = static_cast<const unsigned char*>(file_bytes) + sizeof(header) + sizeof(_Tp);
+        if(header.payload_checksum != snapshot_checksum(payload, key_count * sizeof(_Tp)))
+            throw reject("has corrupt keys");
+    }
+
+    return key_count;
+}
+
+/*
+ * Read-only view of a snapshot written by binary_search_tree::save(), served straight from the file:
+ * opening it maps the file (or, without mmap, reads it into one aligned block) and checks it, with no
+ * per-key work beyond the optional checksum and no allocation per key. The lookups, in-order
+ * iteration and successor walks of eytzinger_view run on the mapped pages, which the OS reads in on
+ * first touch and may share between processes.
+ *
+ * comp must order keys as the tree that was saved did. Throws std::runtime_error when the file cannot
+ * be opened or is not a valid snapshot of _Tp keys.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class mapped_bst : public eytzinger_view<_Tp, _Compare>
+{
+    static_assert(std::is_trivially_copyable_v<_Tp>, "snapshots store keys as raw bytes");
+    static_assert(alignof(_Tp) <= sizeof(snapshot_header), "snapshot slots are only aligned to the header size");
+
+    using view_type = eytzinger_view<_Tp, _Compare>;
+
+ public:
+    using typename view_type::key_compare;
+
+ private:
+    static constexpr std::align_val_t buffer_alignment{64};
+
+    void* file_bytes = nullptr;
+    std::size_t file_size = 0;
+
+    void unmap()
+    {
+        if(file_bytes == nullptr)
+            return;
+
+#if BST_IO_MMAP
+        ::munmap(file_bytes, file_size);
+#else
+        ::operator delete(file_bytes, buffer_alignment);
+#endif
+        file_bytes = nullptr;
+        file_size = 0;
+    }
+
+    void map(const std::filesystem::path& path)
+    {
+        auto cannot_open = [&] { return std::runtime_error("bst: cannot open snapshot " + path.string()); };
+#if BST_IO_MMAP
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if(descriptor < 0)
+            throw cannot_open();
+
+        struct stat file_status;
+        void* address = MAP_FAILED;
+        if(::fstat(descriptor, &file_status) == 0 && file_status.st_size > 0)
+            address = ::mmap(nullptr, static_cast<std::size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if(address == MAP_FAILED)
+            throw cannot_open();
+
+        file_bytes = address;
+        file_size = static_cast<std::size_t>(file_status.st_size);
+#else
+        struct file_closer
+        {
+            void operator()(std::FILE* file) const { std::fclose(file); }
+        };
+
+        std::error_code size_error;
+        std::size_t size = static_cast<std::size_t>(std::filesystem::file_size(path, size_error));
+        std::unique_ptr<std::FILE, file_closer> file(std::fopen(path.string().c_str(), "rb"));
+        if(size_error || !file)
+            throw cannot_open();
+
+        file_bytes = ::operator new(size, buffer_alignment);
+        file_size = size;
+        if(std::fread(file_bytes, 1, size, file.get()) != size)
+        {
+            unmap();
+            throw cannot_open();
+        }
+#endif
+    }
+
+ public:
+    explicit mapped_bst(const std::filesystem::path& path, snapshot_check check = snapshot_check::full, const key_compare& comp = key_compare())
+        : view_type(nullptr, 0, comp)
+    {
+        map(path);
+        try
+        {
+            this->key_count = validate_snapshot<_Tp>(file_bytes, file_size, check, path);
+        }
+        catch(...)
+        {
+            unmap();
+            throw;
+        }
+
+        this->slots = reinterpret_cast<const _Tp*>(static_cast<const unsigned char*>(file_bytes) + sizeof(snapshot_header));
+    }
+
+    mapped_bst(const mapped_bst&) = delete;
+    mapped_bst& operator=(const mapped_bst&) = delete;
+
+    mapped_bst(mapped_bst&& other) noexcept
+        : view_type(other), file_bytes(std::exchange(other.file_bytes, nullptr)), file_size(std::exchange(other.file_size, 0))
+    {
+        other.slots = nullptr;
+        other.key_count = 0;
+    }
+
+    mapped_bst& operator=(mapped_bst&& other) noexcept
+    {
+        if(this != &other)
+        {
+            unmap();
+            view_type::operator=(other);
+            file_bytes = std::exchange(other.file_bytes, nullptr);
+            file_size = std::exchange(other.file_size, 0);
+            other.slots = nullptr;
+            other.key_count = 0;
+        }
+        return *this;
+    }
+
+    ~mapped_bst()
+    {
+        unmap();
+    }
+};
+}
+
+#endif // BST_IO_HPP_INCLUDED
@@ -0,0 +1,610 @@
+#ifndef BST_PERSISTENT_HPP_INCLUDED
+#define BST_PERSISTENT_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bst_epoch.hpp"
+
+namespace BST
+{
+template<typename _Tp, typename _Compare>
+class versioned_bst;
+
+/*
+ * Immutable set of unique keys. insert and delete_node leave the tree alone and return a new version
+ * that copies only the root-to-key path (rebalanced as an AVL tree on the way up, as in concurrent_bst)
+ * and shares every other node with the version it came from. Nodes are reference counted, so copying
+ * a version, or taking a snapshot(), is O(1), and a node is freed with the last version holding it.
+ *
+ * A version never changes once built: any number of threads may read one, and copy it, without
+ * synchronization. Pointers returned by search and the bounds stay valid while a version holding the
+ * key is alive. versioned_bst keeps a current version that writers replace while readers take
+ * snapshots of it.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class persistent_bst
+{
+    friend class versioned_bst<_Tp, _Compare>;
+
+ public:
+    using value_type = _Tp;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+    using const_pointer = const value_type*;
+
+    static constexpr bool transparent_compare = requires { typename _Compare::is_transparent; };
+
+ private:
+    struct node
+    {
+        const value_type key;
+        node* const left;
+        node* const right;
+        const int height;
+        const size_type subtree_size;
+        mutable std::atomic<std::size_t> references{1};
+    };
+
+    static void acquire(const node* shared_node)
+    {
+        if(shared_node != nullptr)
+            shared_node->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Drops one reference; the last one frees the node and drops its references to its children. Recurses at most height deep. */
+    static void release(node* released_node) noexcept
+    {
+        while(released_node != nullptr && released_node->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            node* right = released_node->right;
+            release(released_node->left);
+            delete released_node;
+            released_node = right;
+        }
+    }
+
+    /* One counted reference to a node, or none, released when the handle goes */
+    class node_ref
+    {
+     public:
+        node_ref() = default;
+
+        explicit node_ref(node* adopted_node) : held_node(adopted_node) {}
+
+        node_ref(node_ref&& other) noexcept : held_node(std::exchange(other.held_node, nullptr)) {}
+
+        node_ref& operator=(node_ref&& other) noexcept
+        {
+            if(this != &other)
+                release(std::exchange(held_node, std::exchange(other.held_node, nullptr)));
+            return *this;
+        }
+
+        ~node_ref()
+        {
+            release(held_node);
+        }
+
+        node* get() const
+        {
+            return held_node;
+        }
+
+        /* Hands the reference over to the caller */
+        node* detach()
+        {
+            return std::exchange(held_node, nullptr);
+        }
+
+     private:
+        node* held_node = nullptr;
+    };
+
+    node_ref root;
+    [[no_unique_address]] _Compare compare;
+
+    persistent_bst(node_ref new_root, const key_compare& comp) : root(std::move(new_root)), compare(comp) {}
+
+    static node_ref share(node* shared_node)
+    {
+        acquire(shared_node);
+        return node_ref(shared_node);
+    }
+
+    static int height_of(const node* subtree_root)
+    {
+        return (subtree_root != nullptr) ? subtree_root->height : 0;
+    }
+
+    static size_type size_of(const node* subtree_root)
+    {
+        return (subtree_root != nullptr) ? subtree_root->subtree_size : 0;
+    }
+
+    /* Takes over the references to left and right */
+    static node_ref make_node(const value_type& key, node_ref left, node_ref right)
+    {
+        node* new_node = new node{key, left.get(), right.get(), 1 + std::max(height_of(left.get()), height_of(right.get())),
+                                  1 + size_of(left.get()) + size_of(right.get())};
+        left.detach();
+        right.detach();
+        return node_ref(new_node);
+    }
+
+    /* Builds an AVL subtree from key and two AVL subtrees whose heights differ by at most 2. The taller one is rebuilt, not changed. */
+    static node_ref join(const value_type& key, node_ref left, node_ref right)
+    {
+        if(height_of(left.get()) > height_of(right.get()) + 1)
+        {
+            const node* pivot = left.get();
+            if(height_of(pivot->left) >= height_of(pivot->right))
+                return make_node(pivot->key, share(pivot->left), make_node(key, share(pivot->right), std::move(right)));
+
+            const node* inner = pivot->right;
+            return make_node(inner->key, make_node(pivot->key, share(pivot->left), share(inner->left)),
+                             make_node(key, share(inner->right), std::move(right)));
+        }
+
+        if(height_of(right.get()) > height_of(left.get()) + 1)
+        {
+            const node* pivot = right.get();
+            if(height_of(pivot->right) >= height_of(pivot->left))
+                return make_node(pivot->key, make_node(key, std::move(left), share(pivot->left)), share(pivot->right));
+
+            const node* inner = pivot->left;
+            return make_node(inner->key, make_node(key, std::move(left), share(inner->left)),
+                             make_node(pivot->key, share(inner->right), share(pivot->right)));
+        }
+
+        return make_node(key, std::move(left), std::move(right));
+    }
+
+    template<typename _Key>
+    static const node* find_below(const node* current_node, const _Key& key, const _Compare& compare)
+    {
+        while(current_node != nullptr)
+        {
+            if(compare(key, current_node->key))
+                current_node = current_node->left;
+            else if(compare(current_node->key, key))
+                current_node = current_node->right;
+            else
+                return current_node;
+        }
+
+        return nullptr;
+    }
+
+    template<typename _Key>
+    const node* find_node(const _Key& key) const
+    {
+        return find_below(root.get(), key, compare);
+    }
+
+    /* First key not less than key (greater than key when upper), or nullptr */
+    template<typename _Key>
+    const_pointer bound_key(const _Key& key, bool upper) const
+    {
+        const_pointer bound = nullptr;
+        for(const node* current_node = root.get(); current_node != nullptr;)
+        {
+            if(upper ? compare(key, current_node->key) : !compare(current_node->key, key))
+            {
+                bound = &current_node->key;
+                current_node = current_node->left;
+            }
+            else
+            {
+                current_node = current_node->right;
+            }
+        }
+
+        return bound;
+    }
+
+    /* The key must not be in the subtree yet */
+    node_ref insert_below(node* subtree_root, const value_type& key) const
+    {
+        if(subtree_root == nullptr)
+            return make_node(key, node_ref(), node_ref());
+
+        if(compare(key, subtree_root->key))
+            return join(subtree_root->key, insert_below(subtree_root->left, key), share(subtree_root->right));
+
+        return join(subtree_root->key, share(subtree_root->left), insert_below(subtree_root->right, key));
+    }
+
+    /* Returns the subtree without its smallest key, which is left in minimum_key */
+    static node_ref erase_minimum(node* subtree_root, const value_type*& minimum_key)
+    {
+        if(subtree_root->left == nullptr)
+        {
+            minimum_key = &subtree_root->key;
+            return share(subtree_root->right);
+        }
+
+        return join(subtree_root->key, erase_minimum(subtree_root->left, minimum_key), share(subtree_root->right));
+    }
+
+    /* The key must be in the subtree */
+    template<typename _Key>
+    node_ref erase_below(node* subtree_root, const _Key& key) const
+    {
+        if(compare(key, subtree_root->key))
+            return join(subtree_root->key, erase_below(subtree_root->left, key), share(subtree_root->right));
+        if(compare(subtree_root->key, key))
+            return join(subtree_root->key, share(subtree_root->left), erase_below(subtree_root->right, key));
+
+        if(subtree_root->left == nullptr)
+            return share(subtree_root->right);
+        if(subtree_root->right == nullptr)
+            return share(subtree_root->left);
+
+        const value_type* minimum_key = nullptr;
+        node_ref right = erase_minimum(subtree_root->right, minimum_key);
+        return join(*minimum_key, share(subtree_root->left), std::move(right));
+    }
+
+    /* Height of the subtree when it is an AVL tree of correctly stored heights and sizes with every key
+       strictly between lower and upper (either may be null), else -1 */
+    int checked_height(const node* subtree_root, const value_type* lower, const value_type* upper) const
+    {
+        if(subtree_root == nullptr)
+            return 0;
+
+        if((lower != nullptr && !compare(*lower, subtree_root->key)) || (upper != nullptr && !compare(subtree_root->key, *upper)))
+            return -1;
+
+        const int left_height = checked_height(subtree_root->left, lower, &subtree_root->key);
+        const int right_height = checked_height(subtree_root->right, &subtree_root->key, upper);
+        if(left_height < 0 || right_height < 0 || left_height > right_height + 1 || right_height > left_height + 1 ||
+           subtree_root->height != 1 + std::max(left_height, right_height) ||
+           subtree_root->subtree_size != 1 + size_of(subtree_root->left) + size_of(subtree_root->right))
+            return -1;
+
+        return subtree_root->height;
+    }
+
+    persistent_bst inserted(const value_type& key) const
+    {
+        if(find_node(key) != nullptr)
+            return *this;
+
+        return persistent_bst(insert_below(root.get(), key), compare);
+    }
+
+    template<typename _Key>
+    persistent_bst erased(const _Key& key) const
+    {
+        if(find_node(key) == nullptr)
+            return *this;
+
+        return persistent_bst(erase_below(root.get(), key), compare);
+    }
+
+ public:
+    persistent_bst() = default;
+
+    explicit persistent_bst(const key_compare& comp) : compare(comp) {}
+
+    /* Inserts the keys one by one into a single version, keeping the first of equivalent keys */
+    template<std::input_iterator InputIt>
+    persistent_bst(InputIt first, InputIt last, const key_compare& comp = key_compare()) : compare(comp)
+    {
+        for(; first != last; ++first)
+        {
+            if(find_node(*first) == nullptr)
+                root = insert_below(root.get(), *first);
+        }
+    }
+
+    persistent_bst(std::initializer_list<value_type> keys, const key_compare& comp = key_compare())
+        : persistent_bst(keys.begin(), keys.end(), comp) {}
+
+    /* O(1): the copy shares every node */
+    persistent_bst(const persistent_bst& other) : root(share(other.root.get())), compare(other.compare) {}
+
+    persistent_bst(persistent_bst&& other) noexcept = default;
+
+    persistent_bst& operator=(persistent_bst other) noexcept
+    {
+        std::swap(root, other.root);
+        std::swap(compare, other.compare);
+        return *this;
+    }
+
+    /* The same version, in O(1); it stays as it is whatever is later built from this one */
+    persistent_bst snapshot() const
+    {
+        return *this;
+    }
+
+    key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    size_type size() const
+    {
+        return size_of(root.get());
+    }
+
+    bool empty() const
+    {
+        return root.get() == nullptr;
+    }
+
+    /* Checks this version: keys strictly ascending, stored heights and subtree sizes right and AVL balanced. O(n), for tests. */
+    bool check_invariants() const
+    {
+        return checked_height(root.get(), nullptr, nullptr) >= 0;
+    }
+
+    /* A version with key added, or this one when an equivalent key is already there. O(log n) new nodes. */
+    [[nodiscard]] persistent_bst insert(const value_type& key) const
+    {
+        return inserted(key);
+    }
+
+    /* A version without the key equivalent to key, or this one when there is none */
+    [[nodiscard]] persistent_bst delete_node(const value_type& key) const
+    {
+        return erased(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    [[nodiscard]] persistent_bst delete_node(const _Key& key) const
+    {
+        return erased(key);
+    }
+
+    bool contains(const value_type& key) const
+    {
+        return find_node(key) != nullptr;
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool contains(const _Key& key) const
+    {
+        return find_node(key) != nullptr;
+    }
+
+    /* The stored key equivalent to key, or nullptr */
+    const_pointer search(const value_type& key) const
+    {
+        const node* found_node = find_node(key);
+        return (found_node != nullptr) ? &found_node->key : nullptr;
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer search(const _Key& key) const
+    {
+        const node* found_node = find_node(key);
+        return (found_node != nullptr) ? &found_node->key : nullptr;
+    }
+
+    /* The smallest key not less than key, or nullptr */
+    const_pointer lower_bound(const value_type& key) const
+    {
+        return bound_key(key, false);
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer lower_bound(const _Key& key) const
+    {
+        return bound_key(key, false);
+    }
+
+    /* The smallest key greater than key, or nullptr */
+    const_pointer upper_bound(const value_type& key) const
+    {
+        return bound_key(key, true);
+    }
+
+    template<typename _Key> requires transparent_compare
+    const_pointer upper_bound(const _Key& key) const
+    {
+        return bound_key(key, true);
+    }
+
+    const_pointer minimum() const
+    {
+        const node* current_node = root.get();
+        if(current_node == nullptr)
+            return nullptr;
+
+        while(current_node->left != nullptr)
+            current_node = current_node->left;
+
+        return &current_node->key;
+    }
+
+    const_pointer maximum() const
+    {
+        const node* current_node = root.get();
+        if(current_node == nullptr)
+            return nullptr;
+
+        while(current_node->right != nullptr)
+            current_node = current_node->right;
+
+        return &current_node->key;
+    }
+
+    /* Calls visit(key) for every key in ascending order; a visit returning false ends the walk */
+    template<typename _Visitor>
+    void for_each(_Visitor&& visit) const
+    {
+        const node* current_node = root.get();
+        std::vector<const node*> ancestors;
+        ancestors.reserve(static_cast<std::size_t>(height_of(current_node)));
+        while(current_node != nullptr || !ancestors.empty())
+        {
+            while(current_node != nullptr)
+            {
+                ancestors.push_back(current_node);
+                current_node = current_node->left;
+            }
+
+            current_node = ancestors.back();
+            ancestors.pop_back();
+            if constexpr(std::is_convertible_v<std::invoke_result_t<_Visitor&, const value_type&>, bool>)
+            {
+                if(!visit(current_node->key))
+                    return;
+            }
+            else
+            {
+                visit(current_node->key);
+            }
+            current_node = current_node->right;
+        }
+    }
+};
+
+/*
+ * A persistent_bst that changes: insert and delete_node replace the current version, and snapshot()
+ * hands out the current version in O(1) without a lock, for readers that need a point-in-time view
+ * of a tree changing underneath them. Writers are serialized by a mutex and never wait for readers,
+ * which never wait at all.
+ *
+ * The reference held by the current version is dropped through epoch reclamation (bst_epoch.hpp), so
+ * a snapshot() that loaded the old root can still count its reference after a writer replaced it.
+ */
+template<typename _Tp, typename _Compare = std::less<>>
+class versioned_bst
+{
+ public:
+    using version_type = persistent_bst<_Tp, _Compare>;
+    using value_type = _Tp;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+
+    static constexpr bool transparent_compare = version_type::transparent_compare;
+
+ private:
+    using node = typename version_type::node;
+
+    struct reference_dropper
+    {
+        void operator()(node* released_node) const { version_type::release(released_node); }
+    };
+
+    std::atomic<node*> root{nullptr}; /* Holds one reference */
+    [[no_unique_address]] _Compare compare;
+
+    /* Only touched by the thread holding writer_mutex */
+    std::mutex writer_mutex;
+    version_type current;
+    retire_list<node, reference_dropper> retired;
+
+    template<typename _Key>
+    bool contains_key(const _Key& key) const
+    {
+        epoch_guard guard;
+        return version_type::find_below(root.load(std::memory_order_acquire), key, compare) != nullptr;
+    }
+
+    /* Makes next the current version when it differs; returns whether it did */
+    bool publish(version_type next)
+    {
+        if(next.root.get() == current.root.get())
+            return false;
+
+        retired.reserve(1);
+        node* old_root = root.exchange(version_type::share(next.root.get()).detach(), std::memory_order_acq_rel);
+        if(old_root != nullptr)
+            retired.retire(old_root);
+
+        current = std::move(next);
+        retired.collect();
+        return true;
+    }
+
+    template<typename _Key>
+    bool erase_key(const _Key& key)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return publish(current.erased(key));
+    }
+
+ public:
+    versioned_bst() = default;
+
+    explicit versioned_bst(const key_compare& comp) : compare(comp), current(comp) {}
+
+    versioned_bst(const versioned_bst&) = delete;
+    versioned_bst& operator=(const versioned_bst&) = delete;
+
+    /* No other thread may still be using the tree; snapshots taken from it stay valid */
+    ~versioned_bst()
+    {
+        version_type::release(root.load(std::memory_order_acquire));
+    }
+
+    /* The current version in O(1). It keeps every key it holds alive and unchanged for as long as it exists. */
+    version_type snapshot() const
+    {
+        epoch_guard guard;
+        node* current_root = root.load(std::memory_order_acquire);
+        return version_type(version_type::share(current_root), compare);
+    }
+
+    key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    size_type size() const
+    {
+        epoch_guard guard;
+        return version_type::size_of(root.load(std::memory_order_acquire));
+    }
+
+    bool empty() const
+    {
+        return root.load(std::memory_order_acquire) == nullptr;
+    }
+
+    /* Returns false, leaving the tree alone, when an equivalent key is already there */
+    bool insert(const value_type& key)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return publish(current.inserted(key));
+    }
+
+    /* Returns false when the key was not there */
+    bool delete_node(const value_type& key)
+    {
+        return erase_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool delete_node(const _Key& key)
+    {
+        return erase_key(key);
+    }
+
+    bool contains(const value_type& key) const
+    {
+        return contains_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    bool contains(const _Key& key) const
+    {
+        return contains_key(key);
+    }
+};
+}
+
+#endif // BST_PERSISTENT_HPP_INCLUDED
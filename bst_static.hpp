@@ -0,0 +1,232 @@
+#ifndef BST_STATIC_HPP_INCLUDED
+#define BST_STATIC_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace BST
+{
+/*
+ * Fixed set of _N keys sorted and laid out when the table is built, which a constexpr variable does at
+ * compile time:
+ *
+ *   static constexpr BST::static_bst codes{std::array{404, 200, 301, 500, 201}};
+ *   static_assert(codes.contains(301));
+ *
+ * The keys are kept twice: in ascending order, which lookups point into and iteration walks, and in
+ * Eytzinger order as in frozen_bst, padded up to a perfect tree of levels levels with copies of the
+ * largest key. A lookup is then exactly levels comparisons unrolled by the template, each turning left or
+ * right by arithmetic rather than a branch, and the leaf it ends at is the number of keys ordered before
+ * the key. Equivalent keys are allowed; lookups find the first of them.
+ *
+ * _Tp must be default constructible and copy assignable in constant expressions, as arithmetic types,
+ * enums and std::string_view are.
+ */
+template<typename _Tp, std::size_t _N, typename _Compare = std::less<>>
+class static_bst
+{
+ public:
+    using value_type = _Tp;
+    using key_compare = _Compare;
+    using size_type = std::size_t;
+    using const_pointer = const value_type*;
+    using const_iterator = const value_type*;
+
+    static constexpr bool transparent_compare = requires { typename _Compare::is_transparent; };
+
+    /* Levels of the padded tree: the smallest perfect tree holding _N keys has 2^levels - 1 slots */
+    static constexpr size_type levels = std::bit_width(_N);
+
+ private:
+    static constexpr size_type leaf_base = size_type(1) << levels;
+
+    std::array<value_type, _N> sorted_keys{};
+    std::array<value_type, leaf_base> slots{}; /* slots[1 .. leaf_base - 1]; slot 0 is never read */
+    [[no_unique_address]] _Compare compare;
+
+    /* Ascending position of the key at Eytzinger slot in a perfect tree of levels levels */
+    static constexpr size_type sorted_position(size_type slot)
+    {
+        const size_type depth = static_cast<size_type>(std::bit_width(slot)) - 1;
+        const size_type first_at_depth = size_type(1) << depth;
+        return ((2 * (slot - first_at_depth) + 1) << (levels - 1 - depth)) - 1;
+    }
+
+    constexpr void lay_out()
+    {
+        std::sort(sorted_keys.begin(), sorted_keys.end(), compare);
+        for(size_type slot = 1; slot < leaf_base; ++slot)
+            slots[slot] = sorted_keys[std::min(sorted_position(slot), _N - 1)];
+    }
+
+    /* Number of keys for which goes_right holds, found in levels unrolled steps */
+    template<typename _GoesRight, size_type... _Level>
+    constexpr size_type descend(_GoesRight goes_right, std::index_sequence<_Level...>) const
+    {
+        size_type slot = 1;
+        ((slot = 2 * slot + static_cast<size_type>(goes_right(slots[slot])), (void)_Level), ...);
+        return slot - leaf_base;
+    }
+
+    template<typename _GoesRight>
+    constexpr const_pointer first_not(_GoesRight goes_right) const
+    {
+        if constexpr(_N == 0)
+        {
+            return nullptr;
+        }
+        else
+        {
+            const size_type position = descend(goes_right, std::make_index_sequence<levels>());
+            return (position < _N) ? sorted_keys.data() + position : nullptr;
+        }
+    }
+
+    template<typename _Key>
+    constexpr const_pointer lower_bound_key(const _Key& key) const
+    {
+        return first_not([&](const value_type& slot_key) { return compare(slot_key, key); });
+    }
+
+    template<typename _Key>
+    constexpr const_pointer upper_bound_key(const _Key& key) const
+    {
+        return first_not([&](const value_type& slot_key) { return !compare(key, slot_key); });
+    }
+
+    template<typename _Key>
+    constexpr const_pointer search_key(const _Key& key) const
+    {
+        const_pointer found = lower_bound_key(key);
+        return (found != nullptr && !compare(key, *found)) ? found : nullptr;
+    }
+
+ public:
+    constexpr explicit static_bst(const std::array<value_type, _N>& keys, const key_compare& comp = key_compare())
+        : sorted_keys(keys), compare(comp)
+    {
+        lay_out();
+    }
+
+    constexpr explicit static_bst(const value_type (&keys)[_N], const key_compare& comp = key_compare())
+        : compare(comp)
+    {
+        std::copy(keys, keys + _N, sorted_keys.begin());
+        lay_out();
+    }
+
+    constexpr size_type size() const
+    {
+        return _N;
+    }
+
+    constexpr bool empty() const
+    {
+        return _N == 0;
+    }
+
+    constexpr key_compare key_comp() const
+    {
+        return compare;
+    }
+
+    constexpr const_pointer search(const value_type& key) const
+    {
+        return search_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr const_pointer search(const _Key& key) const
+    {
+        return search_key(key);
+    }
+
+    constexpr bool contains(const value_type& key) const
+    {
+        return search_key(key) != nullptr;
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr bool contains(const _Key& key) const
+    {
+        return search_key(key) != nullptr;
+    }
+
+    /* The smallest key not less than key, or nullptr */
+    constexpr const_pointer lower_bound(const value_type& key) const
+    {
+        return lower_bound_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr const_pointer lower_bound(const _Key& key) const
+    {
+        return lower_bound_key(key);
+    }
+
+    /* The smallest key greater than key, or nullptr */
+    constexpr const_pointer upper_bound(const value_type& key) const
+    {
+        return upper_bound_key(key);
+    }
+
+    template<typename _Key> requires transparent_compare
+    constexpr const_pointer upper_bound(const _Key& key) const
+    {
+        return upper_bound_key(key);
+    }
+
+    /* Position of a key returned by a lookup among the keys in ascending order, e.g. to index a parallel table */
+    constexpr size_type index_of(const_pointer key) const
+    {
+        return static_cast<size_type>(key - sorted_keys.data());
+    }
+
+    constexpr const_pointer minimum() const
+    {
+        return empty() ? nullptr : sorted_keys.data();
+    }
+
+    constexpr const_pointer maximum() const
+    {
+        return empty() ? nullptr : sorted_keys.data() + _N - 1;
+    }
+
+    /* The keys in ascending order */
+    constexpr const_iterator begin() const
+    {
+        return sorted_keys.data();
+    }
+
+    constexpr const_iterator end() const
+    {
+        return sorted_keys.data() + _N;
+    }
+};
+
+template<typename _Tp, std::size_t _N>
+static_bst(const std::array<_Tp, _N>&) -> static_bst<_Tp, _N>;
+
+template<typename _Tp, std::size_t _N, typename _Compare>
+static_bst(const std::array<_Tp, _N>&, const _Compare&) -> static_bst<_Tp, _N, _Compare>;
+
+template<typename _Tp, std::size_t _N>
+static_bst(const _Tp (&)[_N]) -> static_bst<_Tp, _N>;
+
+template<typename _Tp, std::size_t _N, typename _Compare>
+static_bst(const _Tp (&)[_N], const _Compare&) -> static_bst<_Tp, _N, _Compare>;
+
+/* Built and searched by the compiler: a static_bst that does not work in constant expressions fails here */
+static_assert([]
+{
+    constexpr static_bst<int, 6> table({42, 7, 19, 3, 88, 19});
+    return *table.lower_bound(8) == 19 && table.index_of(table.search(19)) == 2 && table.upper_bound(88) == nullptr &&
+           !table.contains(20) && *table.begin() == 3;
+}(), "static_bst must be usable at compile time");
+}
+
+#endif // BST_STATIC_HPP_INCLUDED
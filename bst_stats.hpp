@@ -0,0 +1,118 @@
+#ifndef BST_STATS_HPP_INCLUDED
+#define BST_STATS_HPP_INCLUDED
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BST
+{
+/* Appends "name":value, and the comma before it unless it is the first field */
+inline void append_json_field(std::string& json, const char* name, const std::string& value)
+{
+    if(json.back() != '{')
+        json += ',';
+
+    json += '"';
+    json += name;
+    json += "\":";
+    json += value;
+}
+
+/* Shortest decimal form, independent of the C locale */
+inline std::string json_number(double value)
+{
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+template<typename _Counts>
+std::string json_array(const _Counts& counts, std::size_t length)
+{
+    std::string json = "[";
+    for(std::size_t index = 0; index < length; ++index)
+    {
+        if(index != 0)
+            json += ',';
+        json += std::to_string(counts[index]);
+    }
+    return json + "]";
+}
+
+/*
+ * Counters kept by a binary_search_tree whose policy is instrumented. An operation is one search,
+ * insert or removal by key; its path is the number of nodes its descent visited, and comparisons
+ * counts the key comparisons of those descents. A node handed out by extract() counts as freed by
+ * its tree and one spliced in as allocated, so allocations - deallocations stays the tree's size.
+ * A tree that keeps stats must not be searched from several threads at once.
+ */
+struct tree_stats
+{
+    static constexpr std::size_t histogram_size = 64;
+
+    std::uint64_t searches = 0;
+    std::uint64_t inserts = 0;
+    std::uint64_t erases = 0;
+    std::uint64_t search_nodes_visited = 0;
+    std::uint64_t insert_nodes_visited = 0;
+    std::uint64_t erase_nodes_visited = 0;
+    std::uint64_t comparisons = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+
+    /* path_lengths[n]: operations whose path visited n nodes; the last bucket also takes longer paths */
+    std::array<std::uint64_t, histogram_size> path_lengths{};
+
+    std::string to_json() const
+    {
+        std::size_t used_buckets = histogram_size;
+        while(used_buckets != 0 && path_lengths[used_buckets - 1] == 0)
+            --used_buckets;
+
+        std::string json = "{";
+        append_json_field(json, "searches", std::to_string(searches));
+        append_json_field(json, "inserts", std::to_string(inserts));
+        append_json_field(json, "erases", std::to_string(erases));
+        append_json_field(json, "search_nodes_visited", std::to_string(search_nodes_visited));
+        append_json_field(json, "insert_nodes_visited", std::to_string(insert_nodes_visited));
+        append_json_field(json, "erase_nodes_visited", std::to_string(erase_nodes_visited));
+        append_json_field(json, "comparisons", std::to_string(comparisons));
+        append_json_field(json, "allocations", std::to_string(allocations));
+        append_json_field(json, "deallocations", std::to_string(deallocations));
+        append_json_field(json, "path_lengths", json_array(path_lengths, used_buckets));
+        return json + "}";
+    }
+};
+
+/*
+ * Shape of a binary_search_tree as measured by shape_report(). Depths count from 0 at the root.
+ * balance_factor is the height over the smallest height that many nodes allow, ceil(log2(n + 1)):
+ * 1 for a perfectly balanced tree, at most about 1.44 for AVL and 2 for red-black, and up to n / log2(n)
+ * for a degenerate one.
+ */
+struct tree_shape
+{
+    std::size_t node_count = 0;
+    std::size_t height = 0;
+    double average_depth = 0;
+    double balance_factor = 1;
+    std::vector<std::size_t> level_counts; /* level_counts[d]: nodes at depth d */
+
+    std::string to_json() const
+    {
+        std::string json = "{";
+        append_json_field(json, "node_count", std::to_string(node_count));
+        append_json_field(json, "height", std::to_string(height));
+        append_json_field(json, "average_depth", json_number(average_depth));
+        append_json_field(json, "balance_factor", json_number(balance_factor));
+        append_json_field(json, "level_counts", json_array(level_counts, level_counts.size()));
+        return json + "}";
+    }
+};
+}
+
+#endif // BST_STATS_HPP_INCLUDED
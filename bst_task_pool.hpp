@@ -0,0 +1,263 @@
+#ifndef BST_TASK_POOL_HPP_INCLUDED
+#define BST_TASK_POOL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace BST
+{
+/*
+ * Fork-join thread pool with work stealing, used by the parallel tree algorithms.
+ *
+ * Every worker owns a deque: tasks it spawns go to the back and it runs them from the back, so a
+ * worker keeps descending into the subtree it is already working on while its caches are warm. An
+ * idle worker steals from the front of another worker's deque, which holds the oldest and therefore
+ * largest pieces of work. Threads outside the pool submit to a deque of their own.
+ *
+ * A thread waiting on a task_group runs queued tasks instead of blocking, so tasks may spawn and wait
+ * on nested groups without tying up workers.
+ */
+class task_pool
+{
+ public:
+    class task_group;
+
+    explicit task_pool(unsigned thread_count = std::max(1u, std::thread::hardware_concurrency()))
+        : worker_count(std::max(1u, thread_count))
+    {
+        for(unsigned index = 0; index <= worker_count; ++index)
+            queues.push_back(std::make_unique<task_queue>());
+
+        try
+        {
+            for(unsigned index = 0; index < worker_count; ++index)
+                workers.emplace_back([this, index] { work(index); });
+        }
+        catch(...)
+        {
+            stop();
+            throw;
+        }
+    }
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    /* Runs the tasks still queued, then joins the workers */
+    ~task_pool()
+    {
+        stop();
+    }
+
+    /* The pool the parallel algorithms use when none is given, with one worker per hardware thread */
+    static task_pool& shared()
+    {
+        static task_pool pool;
+        return pool;
+    }
+
+    unsigned size() const
+    {
+        return worker_count;
+    }
+
+ private:
+    using task = std::function<void()>;
+
+    struct alignas(64) task_queue
+    {
+        std::mutex queue_mutex;
+        std::deque<task> tasks;
+    };
+
+    unsigned worker_count;
+    std::vector<std::unique_ptr<task_queue>> queues; /* One per worker, the last one for outside threads */
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> queued_count{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    inline static thread_local const task_pool* current_pool = nullptr;
+    inline static thread_local unsigned current_index = 0;
+
+    /* The calling thread's own queue */
+    unsigned own_queue() const
+    {
+        return (current_pool == this) ? current_index : worker_count;
+    }
+
+    void push(task new_task)
+    {
+        task_queue& queue = *queues[own_queue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.queue_mutex);
+            queue.tasks.push_back(std::move(new_task));
+        }
+
+        queued_count.fetch_add(1, std::memory_order_release);
+        {
+            /* Taking the lock orders the count against a worker about to sleep, so the wake-up cannot be lost */
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_one();
+    }
+
+    bool pop_back(unsigned index, task& next_task)
+    {
+        task_queue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.queue_mutex);
+        if(queue.tasks.empty())
+            return false;
+
+        next_task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned index, task& next_task)
+    {
+        for(unsigned offset = 1; offset <= worker_count; ++offset)
+        {
+            task_queue& victim = *queues[(index + offset) % (worker_count + 1)];
+            std::lock_guard<std::mutex> lock(victim.queue_mutex);
+            if(!victim.tasks.empty())
+            {
+                next_task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /* Runs one queued task on the calling thread; false when there was none */
+    bool run_one()
+    {
+        if(queued_count.load(std::memory_order_acquire) == 0)
+            return false;
+
+        unsigned index = own_queue();
+        task next_task;
+        if(!pop_back(index, next_task) && !steal(index, next_task))
+            return false;
+
+        queued_count.fetch_sub(1, std::memory_order_relaxed);
+        next_task();
+        return true;
+    }
+
+    void work(unsigned index)
+    {
+        current_pool = this;
+        current_index = index;
+        while(true)
+        {
+            if(run_one())
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping || queued_count.load(std::memory_order_acquire) != 0; });
+            if(stopping && queued_count.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for(std::thread& worker : workers)
+            worker.join();
+
+        workers.clear();
+    }
+};
+
+/*
+ * Tasks spawned together and waited for together. The first exception a task throws is rethrown by
+ * wait() once every task of the group has finished.
+ */
+class task_pool::task_group
+{
+ public:
+    explicit task_group(task_pool& pool) : pool(pool) {}
+
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+
+    ~task_group()
+    {
+        wait_all();
+    }
+
+    template<typename _Task>
+    void spawn(_Task&& new_task)
+    {
+        pending_count.fetch_add(1, std::memory_order_relaxed);
+        try
+        {
+            pool.push([this, new_task = std::forward<_Task>(new_task)]() mutable
+            {
+                try
+                {
+                    new_task();
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if(!error)
+                        error = std::current_exception();
+                }
+
+                pending_count.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        catch(...)
+        {
+            pending_count.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+    }
+
+    /* Helps with queued work until every task of the group has finished */
+    void wait()
+    {
+        wait_all();
+        if(error)
+            std::rethrow_exception(std::exchange(error, nullptr));
+    }
+
+ private:
+    task_pool& pool;
+    std::atomic<std::size_t> pending_count{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    void wait_all()
+    {
+        while(pending_count.load(std::memory_order_acquire) != 0)
+        {
+            if(!pool.run_one())
+                std::this_thread::yield();
+        }
+    }
+};
+}
+
+#endif // BST_TASK_POOL_HPP_INCLUDED
@@ -0,0 +1,145 @@
+#include <cstddef>
+#include <utility>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Trees with arena_allocator whose nodes end up shared between holders of one arena: split() results,
+ * joined trees and extracted node handles. clear() and the destructors must leave nodes another holder
+ * still uses alone. Meant to run under ASan, which reports the use-after-free a bulk release causes.
+ */
+namespace
+{
+using arena_tree = BST::binary_search_tree<int, BST::red_black_policy, BST::arena_allocator<int>>;
+
+arena_tree make_tree(int key_count)
+{
+    arena_tree tree;
+    for(int key = 0; key < key_count; ++key)
+        tree.insert(key);
+    return tree;
+}
+
+bool holds_range(const arena_tree& tree, int first_key, int last_key)
+{
+    int expected_key = first_key;
+    for(int key : tree)
+    {
+        if(key != expected_key++)
+            return false;
+    }
+    return expected_key == last_key;
+}
+
+void split_then_drop_upper()
+{
+    arena_tree tree = make_tree(5000);
+    {
+        arena_tree upper = tree.split(2500);
+        BST_CHECK(upper.size() == 2500 && holds_range(upper, 2500, 5000));
+    }
+
+    tree.insert(99999);
+    BST_CHECK(tree.size() == 2501 && tree.search(2499) != nullptr && tree.search(99999) != nullptr);
+}
+
+void split_clear_lower_then_join()
+{
+    arena_tree tree = make_tree(5000);
+    arena_tree upper = tree.split(2500);
+    tree.clear();
+    BST_CHECK(tree.empty() && holds_range(upper, 2500, 5000));
+
+    upper.insert(5000);
+    for(int key = 0; key < 2500; ++key)
+        tree.insert(key);
+
+    tree.join(std::move(upper));
+    BST_CHECK(upper.empty() && tree.size() == 5001 && holds_range(tree, 0, 5001));
+}
+
+void split_repeatedly_and_join_back()
+{
+    arena_tree tree = make_tree(4096);
+    arena_tree top = tree.split(3072);
+    arena_tree middle = tree.split(1024);
+    BST_CHECK(holds_range(tree, 0, 1024) && holds_range(middle, 1024, 3072) && holds_range(top, 3072, 4096));
+
+    middle.join(std::move(top));
+    tree.join(std::move(middle));
+    BST_CHECK(tree.size() == 4096 && holds_range(tree, 0, 4096));
+    tree.clear();
+    BST_CHECK(tree.empty());
+}
+
+void extract_clear_then_splice()
+{
+    arena_tree source = make_tree(10);
+    arena_tree target;
+    auto handle = source.extract(3);
+    source.clear();
+    BST_CHECK(target.splice(std::move(handle)).second);
+    BST_CHECK(target.size() == 1 && target.search(3) != nullptr);
+}
+
+void extract_clear_then_drop_handle()
+{
+    arena_tree source = make_tree(10);
+    {
+        auto handle = source.extract(3);
+        source.clear();
+    }
+
+    source.insert(4);
+    BST_CHECK(source.size() == 1);
+}
+
+void handle_outlives_tree()
+{
+    arena_tree target;
+    {
+        auto handle = [] {
+            arena_tree source = make_tree(100);
+            return source.extract(42);
+        }();
+        BST_CHECK(target.splice(std::move(handle)).second);
+    }
+
+    BST_CHECK(target.size() == 1 && target.search(42) != nullptr);
+}
+
+void trees_built_from_one_allocator()
+{
+    BST::arena_allocator<int> allocator;
+    arena_tree lower(allocator);
+    arena_tree upper(allocator);
+    BST_CHECK(lower.get_allocator() == allocator && lower.get_allocator() == upper.get_allocator());
+    BST_CHECK(BST::arena_allocator<double>(allocator) == allocator);
+
+    for(int key = 0; key < 2000; ++key)
+    {
+        lower.insert(key);
+        upper.insert(key + 2000);
+    }
+
+    lower.merge(upper);
+    BST_CHECK(upper.empty() && holds_range(lower, 0, 4000));
+
+    lower.clear();
+    lower.insert(7);
+    BST_CHECK(lower.size() == 1 && lower.search(7) != nullptr);
+}
+}
+
+int main()
+{
+    split_then_drop_upper();
+    split_clear_lower_then_join();
+    split_repeatedly_and_join_back();
+    extract_clear_then_splice();
+    extract_clear_then_drop_handle();
+    handle_outlives_tree();
+    trees_built_from_one_allocator();
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Model test for the balancing policies: random insert and delete_node sequences, single and batched,
+ * on red_black_policy and avl_policy trees, checked against a std::multiset after every batch. Besides
+ * the keys, each check walks the nodes for consistent parent links, the colour rules and equal black
+ * heights, or the stored AVL balances, and bounds the height: 2 log2(n + 1) for red-black, 1.44 log2(n + 2)
+ * for AVL. Trees made in bulk (assign from a sorted range, the sorted_unique constructor, copies) get the
+ * same checks at every size up to a few thousand keys, and have to stay valid under later updates.
+ */
+namespace
+{
+template<typename Tree>
+void check_against_model(const Tree& tree, const std::multiset<int>& model)
+{
+    const std::size_t height = tree_invariants::check_tree(tree);
+    BST_CHECK(tree.size() == model.size() && std::equal(tree.begin(), tree.end(), model.begin(), model.end()));
+
+    const double key_count = static_cast<double>(model.size());
+    if constexpr(std::is_base_of_v<BST::red_black_policy, typename Tree::balance_policy>)
+        BST_CHECK(static_cast<double>(height) <= 2 * std::log2(key_count + 1));
+    else
+        BST_CHECK(static_cast<double>(height) <= 1.44 * std::log2(key_count + 2));
+}
+
+template<typename Tree>
+void run_model(unsigned seed, int key_range)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> random_key(0, key_range - 1);
+    Tree tree;
+    std::multiset<int> model;
+
+    for(int batch = 0; batch < 60; ++batch)
+    {
+        /* Grow, then shrink to empty, then grow again */
+        const unsigned insert_share = (batch < 25) ? 3 : (batch < 45) ? 1 : 2;
+        for(int step = 0; step < 150; ++step)
+        {
+            const int key = random_key(rng);
+            if(rng() % 4 < insert_share)
+            {
+                tree.insert(key);
+                model.insert(key);
+            }
+            else
+            {
+                tree.delete_node(key);
+                if(const auto found = model.find(key); found != model.end())
+                    model.erase(found);
+            }
+        }
+
+        check_against_model(tree, model);
+
+        std::vector<int> keys(32);
+        for(int& key : keys)
+            key = random_key(rng);
+        if(batch % 2 == 0)
+        {
+            tree.insert_batch(keys);
+            model.insert(keys.begin(), keys.end());
+        }
+        else
+        {
+            std::sort(keys.begin(), keys.end());
+            tree.erase_batch(BST::sorted_equivalent, std::span<const int>(keys));
+            for(int key : keys)
+            {
+                if(const auto found = model.find(key); found != model.end())
+                    model.erase(found);
+            }
+        }
+
+        check_against_model(tree, model);
+    }
+
+    while(!model.empty())
+    {
+        tree.delete_node(*model.begin());
+        model.erase(model.begin());
+    }
+    check_against_model(tree, model);
+}
+
+/* A bulk-built tree is perfectly balanced: as low as n keys allow */
+template<typename Tree>
+void check_bulk_built(const Tree& tree, const std::multiset<int>& model)
+{
+    check_against_model(tree, model);
+    BST_CHECK(tree_invariants::check_tree(tree) == static_cast<std::size_t>(std::bit_width(model.size())));
+}
+
+template<typename Tree>
+void run_bulk_model(std::size_t key_count)
+{
+    std::vector<int> distinct(key_count);
+    std::vector<int> repeated(key_count);
+    for(std::size_t i = 0; i < key_count; ++i)
+    {
+        distinct[i] = 2 * static_cast<int>(i);
+        repeated[i] = static_cast<int>(i / 4);
+    }
+    const std::multiset<int> distinct_model(distinct.begin(), distinct.end());
+    const std::multiset<int> repeated_model(repeated.begin(), repeated.end());
+
+    Tree loaded;
+    loaded.insert(-1);
+    loaded.assign(distinct.begin(), distinct.end());
+    check_bulk_built(loaded, distinct_model);
+
+    Tree tagged(BST::sorted_unique, distinct.begin(), distinct.end());
+    check_bulk_built(tagged, distinct_model);
+
+    Tree chained;
+    chained.assign(repeated.begin(), repeated.end());
+    check_bulk_built(chained, repeated_model);
+
+    /* Copies take the shape and balancing data node for node */
+    const Tree copied(chained);
+    check_bulk_built(copied, repeated_model);
+    Tree assigned;
+    assigned.insert(7);
+    assigned = loaded;
+    check_bulk_built(assigned, distinct_model);
+
+    /* Rebalancing has to carry on from the balancing data the bulk load wrote */
+    std::multiset<int> model = distinct_model;
+    for(std::size_t i = 0; i < key_count; i += 3)
+    {
+        const int key = static_cast<int>(2 * i + 1);
+        assigned.insert(key);
+        model.insert(key);
+        assigned.delete_node(static_cast<int>(i));
+        if(const auto found = model.find(static_cast<int>(i)); found != model.end())
+            model.erase(found);
+    }
+    check_against_model(assigned, model);
+    check_against_model(loaded, distinct_model);
+}
+
+template<typename Policy>
+void run_policy()
+{
+    for(unsigned seed = 1; seed <= 4; ++seed)
+    {
+        run_model<BST::binary_search_tree<int, Policy>>(seed, 1000);
+        run_model<BST::binary_search_tree<int, Policy>>(seed, 50); /* Mostly duplicates */
+        run_model<BST::binary_search_tree<int, BST::order_statistics<Policy>>>(seed, 1000);
+    }
+
+    for(std::size_t key_count = 0; key_count <= 300; ++key_count)
+    {
+        run_bulk_model<BST::binary_search_tree<int, Policy>>(key_count);
+        run_bulk_model<BST::binary_search_tree<int, BST::order_statistics<Policy>>>(key_count);
+    }
+    for(std::size_t power = 512; power <= 4096; power *= 2)
+    {
+        for(std::size_t key_count : {power - 1, power, power + 1})
+            run_bulk_model<BST::binary_search_tree<int, Policy>>(key_count);
+    }
+}
+}
+
+int main()
+{
+    run_policy<BST::red_black_policy>();
+    run_policy<BST::avl_policy>();
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Model test for the ordered lookups: lower_bound, upper_bound, equal_range, floor, ceil and visit_range
+ * against std::multiset. Keys come from a small range so most of them repeat, and each bound is checked by
+ * the in-order position of the node it returns, which tells apart the first and the last of equal keys.
+ * Queried keys run one past either end, where the bounds have to come back null.
+ */
+namespace
+{
+constexpr int largest_key = 40;
+
+template<typename Tree>
+std::unordered_map<typename Tree::node_pointer, std::size_t> inorder_positions(const Tree& tree)
+{
+    std::unordered_map<typename Tree::node_pointer, std::size_t> positions;
+    for(auto it = tree.begin(); it != tree.end(); ++it)
+        positions.emplace(it.get_node(), positions.size());
+    return positions;
+}
+
+template<typename Tree>
+void check_against_model(const Tree& tree, const std::multiset<int>& model)
+{
+    tree_invariants::check_tree(tree);
+    BST_CHECK(tree.size() == model.size());
+    const auto positions = inorder_positions(tree);
+
+    /* Position of the node a bound returned, model.size() standing for nullptr */
+    const auto position_of = [&](typename Tree::node_pointer node) {
+        if(node == nullptr)
+            return model.size();
+        const auto found = positions.find(node);
+        BST_CHECK(found != positions.end());
+        return found->second;
+    };
+    const auto model_position = [&](std::multiset<int>::const_iterator it) {
+        return static_cast<std::size_t>(std::distance(model.begin(), it));
+    };
+
+    for(int key = -1; key <= largest_key + 1; ++key)
+    {
+        const std::size_t first_equal = model_position(model.lower_bound(key));
+        const std::size_t past_equal = model_position(model.upper_bound(key));
+
+        BST_CHECK(position_of(tree.lower_bound(key)) == first_equal);
+        BST_CHECK(position_of(tree.upper_bound(key)) == past_equal);
+        BST_CHECK(position_of(tree.ceil(key)) == first_equal);
+
+        const auto [range_first, range_last] = tree.equal_range(key);
+        BST_CHECK(position_of(range_first) == first_equal && position_of(range_last) == past_equal);
+
+        /* floor is the last of the equal keys, or the last key below when there are none */
+        const std::size_t expected_floor = (past_equal == 0) ? model.size() : past_equal - 1;
+        BST_CHECK(position_of(tree.floor(key)) == expected_floor);
+    }
+
+    for(int low_key = -1; low_key <= largest_key + 1; low_key += 3)
+    {
+        for(int high_key : {low_key - 1, low_key, low_key + 4, largest_key + 1})
+        {
+            std::vector<int> visited;
+            tree.visit_range(low_key, high_key, [&visited](int key) { visited.push_back(key); });
+            const std::vector<int> expected = (high_key < low_key) ? std::vector<int>()
+                : std::vector<int>(model.lower_bound(low_key), model.upper_bound(high_key));
+            BST_CHECK(visited == expected);
+
+            /* A visitor returning false stops at the key it was handed */
+            std::size_t calls = 0;
+            tree.visit_range(low_key, high_key, [&calls](int) { return ++calls < 2; });
+            BST_CHECK(calls == std::min<std::size_t>(expected.size(), 2));
+        }
+    }
+}
+
+template<typename Policy>
+void run_model(unsigned seed)
+{
+    BST::binary_search_tree<int, Policy> tree;
+    std::multiset<int> model;
+    check_against_model(tree, model);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> random_key(0, largest_key);
+    for(int round = 0; round < 6; ++round)
+    {
+        for(int i = 0; i < 60; ++i)
+        {
+            const int key = random_key(rng);
+            tree.insert(key);
+            model.insert(key);
+        }
+        for(int i = 0; i < 25; ++i)
+        {
+            const int key = random_key(rng);
+            tree.delete_node(key);
+            if(const auto found = model.find(key); found != model.end())
+                model.erase(found);
+        }
+        check_against_model(tree, model);
+    }
+
+    /* Only the keys at the ends of the range, then a single run of one key */
+    for(int key = 1; key < largest_key; ++key)
+    {
+        tree.erase(key);
+        model.erase(key);
+    }
+    check_against_model(tree, model);
+    tree.clear();
+    model.clear();
+    for(int i = 0; i < 9; ++i)
+    {
+        tree.insert(largest_key / 2);
+        model.insert(largest_key / 2);
+    }
+    check_against_model(tree, model);
+}
+}
+
+int main()
+{
+    for(unsigned seed = 1; seed <= 3; ++seed)
+    {
+        run_model<BST::unbalanced_policy>(seed);
+        run_model<BST::red_black_policy>(seed);
+        run_model<BST::avl_policy>(seed);
+        run_model<BST::splay_policy>(seed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "bst_concurrent.hpp"
+#include "bst_persistent.hpp"
+#include "test_check.hpp"
+
+/*
+ * Stress test for the trees that take concurrent readers and writers. Writers insert and delete random
+ * keys, each writer owning the keys equal to its index modulo the writer count, so its own std::set is an
+ * exact serial model of its share of the tree. Readers meanwhile check lookups, the AVL invariants and
+ * the ascending order of full walks, and that a band of stable keys no writer touches never goes missing.
+ * At the end the tree must hold exactly the union of the models and the stable keys.
+ */
+namespace
+{
+constexpr int churned_keys = 4096;
+constexpr int stable_keys = 256;
+
+/* Readers check one consistent view of the whole tree: concurrent_bst itself, or a versioned_bst snapshot */
+template<typename Tree>
+void check_view(const Tree& tree)
+{
+    if constexpr(requires { tree.snapshot().check_invariants(); })
+    {
+        const auto version = tree.snapshot();
+        BST_CHECK(version.check_invariants());
+
+        std::size_t walked_keys = 0;
+        int stable_seen = 0;
+        int previous_key = -1;
+        version.for_each([&](int key) {
+            BST_CHECK(key > previous_key);
+            previous_key = key;
+            ++walked_keys;
+            stable_seen += (key >= churned_keys) ? 1 : 0;
+        });
+        BST_CHECK(walked_keys == version.size());
+        BST_CHECK(stable_seen == stable_keys);
+    }
+    else
+    {
+        BST_CHECK(tree.check_invariants(true));
+
+        int stable_seen = 0;
+        int previous_key = -1;
+        tree.for_each([&](int key) {
+            BST_CHECK(key > previous_key);
+            previous_key = key;
+            stable_seen += (key >= churned_keys) ? 1 : 0;
+        });
+        BST_CHECK(stable_seen == stable_keys);
+    }
+}
+
+template<typename Tree>
+void run_stress(unsigned writer_count, unsigned reader_count, std::size_t writes_per_writer)
+{
+    Tree tree;
+    for(int key = churned_keys; key < churned_keys + stable_keys; ++key)
+        BST_CHECK(tree.insert(key));
+
+    std::vector<std::set<int>> models(writer_count);
+    std::atomic<unsigned> writers_running{writer_count};
+    std::vector<std::thread> threads;
+
+    for(unsigned writer = 0; writer < writer_count; ++writer)
+    {
+        threads.emplace_back([&, writer] {
+            std::mt19937 gen(writer + 1);
+            std::set<int>& model = models[writer];
+            const int owned_keys = churned_keys / static_cast<int>(writer_count);
+            for(std::size_t write = 0; write < writes_per_writer; ++write)
+            {
+                const int key = static_cast<int>(writer) + static_cast<int>(writer_count) * static_cast<int>(gen() % static_cast<unsigned>(owned_keys));
+                if(gen() % 2 == 0)
+                    BST_CHECK(tree.insert(key) == model.insert(key).second);
+                else
+                    BST_CHECK(tree.delete_node(key) == (model.erase(key) == 1));
+            }
+            writers_running.fetch_sub(1);
+        });
+    }
+
+    for(unsigned reader = 0; reader < reader_count; ++reader)
+    {
+        threads.emplace_back([&, reader] {
+            std::mt19937 gen(1000 + reader);
+            for(unsigned round = 0; writers_running.load() != 0; ++round)
+            {
+                const int key = static_cast<int>(gen() % (churned_keys + stable_keys));
+                const bool found = tree.contains(key);
+                BST_CHECK(found || key < churned_keys);
+
+                if(round % 256 == 0)
+                    check_view(tree);
+            }
+        });
+    }
+
+    for(std::thread& thread : threads)
+        thread.join();
+
+    std::set<int> expected;
+    for(const std::set<int>& model : models)
+        expected.insert(model.begin(), model.end());
+    for(int key = churned_keys; key < churned_keys + stable_keys; ++key)
+        expected.insert(key);
+
+    std::vector<int> contents;
+    if constexpr(requires { tree.snapshot(); })
+    {
+        const auto version = tree.snapshot();
+        BST_CHECK(version.check_invariants());
+        version.for_each([&](int key) { contents.push_back(key); });
+    }
+    else
+    {
+        BST_CHECK(tree.check_invariants());
+        tree.for_each([&](int key) { contents.push_back(key); });
+    }
+
+    BST_CHECK(tree.size() == expected.size());
+    BST_CHECK(contents == std::vector<int>(expected.begin(), expected.end()));
+}
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s concurrent|versioned [writes_per_writer]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::size_t writes_per_writer = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    if(std::strcmp(argv[1], "concurrent") == 0)
+        run_stress<BST::concurrent_bst<int>>(4, 4, writes_per_writer);
+    else if(std::strcmp(argv[1], "versioned") == 0)
+        run_stress<BST::versioned_bst<int>>(4, 4, writes_per_writer);
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
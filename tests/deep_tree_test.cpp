@@ -0,0 +1,74 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Regression test for the iterative search, count, copy and teardown paths: key_count sorted keys make
+ * an unbalanced tree one chain key_count nodes deep, which the recursive versions overflowed the stack on.
+ * The same steps run on a red-black tree.
+ */
+template<typename Tree>
+void run_deep_tree(std::size_t key_count)
+{
+    std::vector<int> keys(key_count);
+    for(std::size_t i = 0; i < key_count; ++i)
+        keys[i] = static_cast<int>(i);
+
+    const int largest_key = static_cast<int>(key_count) - 1;
+    Tree tree;
+    tree.insert_batch(BST::sorted_equivalent, keys);
+    BST_CHECK(tree.size() == key_count);
+    if constexpr(std::is_same_v<Tree, BST::binary_search_tree<int>>)
+        BST_CHECK(tree.shape_report().height == key_count);
+
+    /* Copy */
+    Tree copy(tree);
+    BST_CHECK(copy.size() == key_count);
+    BST_CHECK(*copy.begin() == 0 && copy.maximum()->get_key() == largest_key);
+
+    /* Count and search, down to the deepest key */
+    BST_CHECK(tree.count() == key_count);
+    BST_CHECK(tree.count(largest_key) == 1);
+    BST_CHECK(tree.count(-1) == 0);
+    BST_CHECK(tree.count_if([](int key) { return key % 2 == 0; }) == (key_count + 1) / 2);
+    BST_CHECK(tree.search(largest_key) != nullptr);
+    BST_CHECK(tree.search(largest_key + 1) == nullptr);
+
+    /* Delete at both ends and in the middle */
+    tree.delete_node(0);
+    tree.delete_node(largest_key);
+    tree.delete_node(largest_key / 2);
+    BST_CHECK(tree.size() == key_count - 3);
+    BST_CHECK(tree.search(largest_key / 2) == nullptr && tree.search(1) != nullptr);
+
+    /* Clear one, let the other go with its destructor */
+    copy.clear();
+    BST_CHECK(copy.empty());
+    copy = tree;
+    BST_CHECK(copy.size() == key_count - 3);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s unbalanced|red_black [key_count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::size_t key_count = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+    if(std::strcmp(argv[1], "unbalanced") == 0)
+        run_deep_tree<BST::binary_search_tree<int>>(key_count);
+    else if(std::strcmp(argv[1], "red_black") == 0)
+        run_deep_tree<BST::binary_search_tree<int, BST::red_black_policy>>(key_count);
+    else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Model test for duplicate_handling. Records carry a payload that the comparison ignores, so the tree
+ * shows which of two equivalent keys it kept. A std::map from key to payload models reject (the first
+ * payload stays) and overwrite (the last one wins), a std::map from key to occurrences models count.
+ * Checked: the pair insert returns, what delete_node and erase(key) remove and return, count(key),
+ * size() and the keys and payloads the iterators visit.
+ */
+namespace
+{
+struct record
+{
+    int key;
+    int payload;
+};
+
+struct by_key
+{
+    using is_transparent = void;
+
+    bool operator()(const record& lhs, const record& rhs) const { return lhs.key < rhs.key; }
+    bool operator()(const record& lhs, int rhs) const { return lhs.key < rhs; }
+    bool operator()(int lhs, const record& rhs) const { return lhs < rhs.key; }
+};
+
+template<BST::duplicate_keys Mode, typename Policy>
+using record_tree = BST::binary_search_tree<record, BST::duplicate_handling<Mode, Policy>, std::allocator<record>, by_key>;
+
+/* What the model expects of inserting key with payload, applied to it */
+template<BST::duplicate_keys Mode>
+bool model_insert(std::map<int, int>& model, const record& inserted)
+{
+    const auto [position, added] = model.try_emplace(inserted.key, (Mode == BST::duplicate_keys::count) ? 1 : inserted.payload);
+    if(!added)
+    {
+        if constexpr(Mode == BST::duplicate_keys::overwrite)
+            position->second = inserted.payload;
+        else if constexpr(Mode == BST::duplicate_keys::count)
+            ++position->second;
+    }
+
+    return added;
+}
+
+template<BST::duplicate_keys Mode, typename Tree>
+void check_against_model(const Tree& tree, const std::map<int, int>& model)
+{
+    tree_invariants::check_tree(tree);
+    BST_CHECK(tree.size() == model.size());
+
+    auto model_position = model.begin();
+    for(const record& stored : tree)
+    {
+        BST_CHECK(model_position != model.end() && stored.key == model_position->first);
+        if constexpr(Mode == BST::duplicate_keys::count)
+            BST_CHECK(tree.count(stored.key) == static_cast<unsigned>(model_position->second));
+        else
+            BST_CHECK(stored.payload == model_position->second && tree.count(stored.key) == 1);
+        ++model_position;
+    }
+    BST_CHECK(model_position == model.end());
+}
+
+template<BST::duplicate_keys Mode, typename Policy>
+void run_model(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> random_key(0, 199);
+    record_tree<Mode, Policy> tree;
+    std::map<int, int> model;
+    int next_payload = 0;
+
+    for(int batch = 0; batch < 40; ++batch)
+    {
+        for(int step = 0; step < 100; ++step)
+        {
+            const int key = random_key(rng);
+            const auto found = model.find(key);
+            switch(rng() % 8)
+            {
+                case 0:
+                {
+                    /* delete_node takes one occurrence */
+                    tree.delete_node(key);
+                    if(found != model.end() && (Mode != BST::duplicate_keys::count || --found->second == 0))
+                        model.erase(found);
+                    break;
+                }
+                case 1:
+                {
+                    /* erase(key) takes all of them and says how many */
+                    const std::size_t expected = (found == model.end()) ? 0 : (Mode == BST::duplicate_keys::count) ? found->second : 1;
+                    BST_CHECK(tree.erase(key) == expected);
+                    if(found != model.end())
+                        model.erase(found);
+                    break;
+                }
+                default:
+                {
+                    const record inserted{key, next_payload++};
+                    const auto [position, added] = (step % 2 == 0) ? tree.insert(inserted) : tree.emplace(inserted);
+                    BST_CHECK(added == model_insert<Mode>(model, inserted));
+                    BST_CHECK(position->key == key);
+                    if constexpr(Mode != BST::duplicate_keys::count)
+                        BST_CHECK(position->payload == model[key]);
+                    break;
+                }
+            }
+        }
+
+        check_against_model<Mode>(tree, model);
+
+        std::vector<record> batch_keys(24);
+        for(record& batch_key : batch_keys)
+            batch_key = record{random_key(rng), next_payload++};
+        if(batch % 2 == 0)
+        {
+            tree.insert_batch(batch_keys);
+        }
+        else
+        {
+            std::stable_sort(batch_keys.begin(), batch_keys.end(), by_key());
+            tree.insert_batch(BST::sorted_equivalent, batch_keys);
+        }
+        for(const record& batch_key : batch_keys)
+            model_insert<Mode>(model, batch_key);
+
+        check_against_model<Mode>(tree, model);
+    }
+}
+
+template<BST::duplicate_keys Mode>
+void run_mode()
+{
+    for(unsigned seed = 1; seed <= 4; ++seed)
+    {
+        run_model<Mode, BST::unbalanced_policy>(seed);
+        run_model<Mode, BST::red_black_policy>(seed);
+        run_model<Mode, BST::order_statistics<BST::avl_policy>>(seed);
+    }
+}
+}
+
+int main()
+{
+    run_mode<BST::duplicate_keys::reject>();
+    run_mode<BST::duplicate_keys::overwrite>();
+    run_mode<BST::duplicate_keys::count>();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Test for eytzinger_view and frozen_bst over every size from empty up to 2^10 + 1, so each complete
+ * tree, each tree one key short of it and each one with a single key on a new level comes up. Keys are
+ * checked against a sorted vector: iteration both ways, minimum, maximum, successor, predecessor and
+ * the lookups, with hits, misses between keys and misses past both ends. With repeated keys the bounds
+ * must return the first of the equal keys, which the test tells apart by where iteration found each one.
+ */
+namespace
+{
+constexpr std::size_t largest_size = (std::size_t(1) << 10) + 1;
+
+template<typename View, typename Compare = std::less<>>
+void check_view(const View& view, const std::vector<int>& sorted, Compare comp = Compare())
+{
+    BST_CHECK(view.size() == sorted.size() && view.empty() == sorted.empty());
+
+    /* Forward iteration, recording where each key is stored */
+    std::vector<const int*> stored;
+    for(auto it = view.begin(); it != view.end(); ++it)
+        stored.push_back(&*it);
+    BST_CHECK(stored.size() == sorted.size());
+    for(std::size_t i = 0; i < stored.size(); ++i)
+        BST_CHECK(*stored[i] == sorted[i]);
+
+    /* Backward from end(), and the same order through predecessor and successor */
+    std::size_t remaining = sorted.size();
+    for(auto it = view.end(); it != view.begin();)
+    {
+        --it;
+        BST_CHECK(remaining != 0 && &*it == stored[--remaining]);
+    }
+    BST_CHECK(remaining == 0);
+
+    BST_CHECK(view.minimum() == (sorted.empty() ? nullptr : stored.front()));
+    BST_CHECK(view.maximum() == (sorted.empty() ? nullptr : stored.back()));
+    for(std::size_t i = 0; i < stored.size(); ++i)
+    {
+        BST_CHECK(view.successor(stored[i]) == (i + 1 < stored.size() ? stored[i + 1] : nullptr));
+        BST_CHECK(view.predecessor(stored[i]) == (i != 0 ? stored[i - 1] : nullptr));
+    }
+
+    const auto stored_at = [&](std::vector<int>::const_iterator position) {
+        return (position == sorted.end()) ? nullptr : stored[static_cast<std::size_t>(position - sorted.begin())];
+    };
+
+    const int low_key = sorted.empty() ? 0 : std::min(sorted.front(), sorted.back()) - 1;
+    const int high_key = sorted.empty() ? 0 : std::max(sorted.front(), sorted.back()) + 1;
+    for(int key = low_key; key <= high_key; ++key)
+    {
+        const auto lower = std::lower_bound(sorted.begin(), sorted.end(), key, comp);
+        const auto upper = std::upper_bound(sorted.begin(), sorted.end(), key, comp);
+        BST_CHECK(view.lower_bound(key) == stored_at(lower));
+        BST_CHECK(view.upper_bound(key) == stored_at(upper));
+        BST_CHECK(view.search(key) == (lower != upper ? stored_at(lower) : nullptr));
+        BST_CHECK(view.contains(key) == (lower != upper));
+    }
+}
+
+void check_frozen(const std::vector<int>& sorted)
+{
+    const BST::frozen_bst<int> frozen(sorted.begin(), sorted.end());
+    check_view(frozen, sorted);
+
+    /* A bare view over the same slots sees the same keys in the same places */
+    const BST::eytzinger_view<int> view(frozen.data(), frozen.size());
+    check_view(view, sorted);
+    BST_CHECK(view.minimum() == frozen.minimum());
+}
+
+void frozen_of_every_size()
+{
+    for(std::size_t size = 0; size <= largest_size; ++size)
+    {
+        std::vector<int> distinct(size);
+        std::vector<int> repeated(size);
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            distinct[i] = 2 * static_cast<int>(i);
+            repeated[i] = static_cast<int>(i / 3);
+        }
+        check_frozen(distinct);
+        check_frozen(repeated);
+    }
+}
+
+void frozen_from_trees()
+{
+    for(std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(255), std::size_t(256), std::size_t(257), largest_size})
+    {
+        BST::binary_search_tree<int, BST::red_black_policy> tree;
+        std::vector<int> sorted;
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            const int key = static_cast<int>((i * 7919) % (size + 13));
+            tree.insert(key);
+            sorted.push_back(key);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        check_view(tree.freeze(), sorted);
+
+        /* Copies own their slots and moves leave the source empty */
+        BST::frozen_bst<int> frozen = tree.freeze();
+        BST::frozen_bst<int> copied(frozen);
+        check_view(copied, sorted);
+        BST::frozen_bst<int> moved(std::move(frozen));
+        check_view(moved, sorted);
+        BST_CHECK(frozen.empty() && frozen.begin() == frozen.end());
+        copied = BST::frozen_bst<int>(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(size / 2));
+        check_view(copied, std::vector<int>(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(size / 2)));
+    }
+
+    std::vector<int> descending = {9, 7, 7, 4, 1};
+    BST::binary_search_tree<int, BST::avl_policy, std::allocator<int>, std::greater<>> tree;
+    for(int key : descending)
+        tree.insert(key);
+    check_view(tree.freeze(), descending, std::greater<>());
+}
+}
+
+int main()
+{
+    frozen_of_every_size();
+    frozen_from_trees();
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Model test for bst_map against std::map: try_emplace, insert_or_assign, emplace, operator[], the
+ * erases and the lookups, with random keys under each balancing policy, plus the guarantee that
+ * try_emplace and insert_or_assign leave their arguments alone when the key is already there.
+ */
+namespace
+{
+template<typename Map>
+void check_against_model(const Map& map, const std::map<int, std::string>& model)
+{
+    BST_CHECK(map.size() == model.size() && map.empty() == model.empty());
+    BST_CHECK(static_cast<std::size_t>(std::distance(map.begin(), map.end())) == model.size());
+
+    auto expected = model.begin();
+    for(const auto& [key, value] : map)
+    {
+        BST_CHECK(key == expected->first && value == expected->second);
+        ++expected;
+    }
+
+    auto expected_reverse = model.rbegin();
+    for(auto it = map.rbegin(); it != map.rend(); ++it, ++expected_reverse)
+        BST_CHECK(it->first == expected_reverse->first);
+}
+
+template<typename Map>
+void check_lookups(const Map& map, const std::map<int, std::string>& model, int key)
+{
+    const auto expected = model.find(key);
+    BST_CHECK(map.contains(key) == (expected != model.end()));
+    BST_CHECK(map.count(key) == model.count(key));
+    BST_CHECK((map.find(key) == map.end()) == (expected == model.end()));
+    if(expected != model.end())
+    {
+        BST_CHECK(map.find(key)->second == expected->second && map.at(key) == expected->second);
+    }
+    else
+    {
+        bool thrown = false;
+        try
+        {
+            map.at(key);
+        }
+        catch(const std::out_of_range&)
+        {
+            thrown = true;
+        }
+        BST_CHECK(thrown);
+    }
+
+    const auto lower = map.lower_bound(key);
+    BST_CHECK(lower == map.end() ? model.lower_bound(key) == model.end() : lower->first == model.lower_bound(key)->first);
+    const auto upper = map.upper_bound(key);
+    BST_CHECK(upper == map.end() ? model.upper_bound(key) == model.end() : upper->first == model.upper_bound(key)->first);
+    const auto [range_first, range_last] = map.equal_range(key);
+    BST_CHECK(range_first == lower && range_last == upper);
+}
+
+template<typename Policy>
+void run_model(unsigned seed)
+{
+    using map_type = BST::bst_map<int, std::string, Policy>;
+    map_type map;
+    std::map<int, std::string> model;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> random_key(0, 199);
+
+    for(int step = 0; step < 4000; ++step)
+    {
+        const int key = random_key(rng);
+        const std::string value = std::to_string(step);
+        switch(rng() % 7)
+        {
+            case 0:
+            {
+                const auto [position, added] = map.try_emplace(key, value);
+                const auto [expected, expected_added] = model.try_emplace(key, value);
+                BST_CHECK(added == expected_added && position->first == key && position->second == expected->second);
+                break;
+            }
+            case 1:
+            {
+                const auto [position, added] = map.insert_or_assign(key, value);
+                const auto [expected, expected_added] = model.insert_or_assign(key, value);
+                BST_CHECK(added == expected_added && position->second == value);
+                break;
+            }
+            case 2:
+            {
+                const auto [position, added] = map.emplace(key, value);
+                const auto [expected, expected_added] = model.emplace(key, value);
+                BST_CHECK(added == expected_added && position->first == key && position->second == expected->second);
+                break;
+            }
+            case 3:
+            {
+                map[key] += value;
+                model[key] += value;
+                break;
+            }
+            case 4:
+            {
+                BST_CHECK(map.erase(key) == model.erase(key));
+                break;
+            }
+            case 5:
+            {
+                const auto position = map.find(key);
+                if(position != map.end())
+                {
+                    const auto next_position = map.erase(position);
+                    const auto expected_next = model.erase(model.find(key));
+                    BST_CHECK((next_position == map.end()) == (expected_next == model.end()));
+                    BST_CHECK(next_position == map.end() || next_position->first == expected_next->first);
+                }
+                break;
+            }
+            default:
+                check_lookups(map, model, key);
+                break;
+        }
+
+        if(step % 500 == 0)
+            check_against_model(map, model);
+    }
+    check_against_model(map, model);
+
+    for(int key = -1; key <= 200; ++key)
+        check_lookups(map, model, key);
+
+    map.clear();
+    model.clear();
+    check_against_model(map, model);
+}
+
+/* A key that is present must leave both the moved-from key and the arguments where they were */
+void keeps_arguments_on_clash()
+{
+    BST::bst_map<std::string, std::unique_ptr<int>, BST::red_black_policy> map;
+    BST_CHECK(map.try_emplace("first", std::make_unique<int>(1)).second);
+
+    std::string key = "first";
+    auto value = std::make_unique<int>(2);
+    const auto [position, added] = map.try_emplace(std::move(key), std::move(value));
+    BST_CHECK(!added && *position->second == 1);
+    BST_CHECK(key == "first" && value != nullptr && *value == 2);
+
+    const auto [same_position, assigned_added] = map.insert_or_assign(std::move(key), std::move(value));
+    BST_CHECK(!assigned_added && same_position == position && *position->second == 2);
+    BST_CHECK(key == "first" && value == nullptr);
+
+    std::string other_key = "second";
+    auto other_value = std::make_unique<int>(3);
+    BST_CHECK(map.try_emplace(std::move(other_key), std::move(other_value)).second);
+    BST_CHECK(other_value == nullptr && *map.at("second") == 3);
+
+    /* emplace has to build the entry to learn its key; on a clash the entry is dropped and the map kept */
+    const auto [clash_position, emplaced] = map.emplace("second", std::make_unique<int>(4));
+    BST_CHECK(!emplaced && *clash_position->second == 3 && map.size() == 2);
+}
+}
+
+int main()
+{
+    for(unsigned seed = 1; seed <= 3; ++seed)
+    {
+        run_model<BST::unbalanced_policy>(seed);
+        run_model<BST::red_black_policy>(seed);
+        run_model<BST::avl_policy>(seed);
+    }
+    keeps_arguments_on_clash();
+
+    return 0;
+}
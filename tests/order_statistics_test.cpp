@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Test for the subtree sizes of order_statistics: inserts, removals, batches, bulk loads, split, join
+ * and the set operations all have to keep them right. After each step rank, select and count_range are
+ * checked against a sorted vector of the keys, and the node walk checks every stored size.
+ */
+namespace
+{
+template<typename Tree>
+void check_against_model(const Tree& tree, const std::multiset<int>& model)
+{
+    tree_invariants::check_tree(tree);
+    const std::vector<int> sorted(model.begin(), model.end());
+    BST_CHECK(tree.size() == sorted.size() && tree.count() == sorted.size());
+    BST_CHECK(tree.select(sorted.size()) == nullptr);
+
+    for(std::size_t i = 0; i < sorted.size(); ++i)
+        BST_CHECK(tree.select(i) != nullptr && tree.select(i)->get_key() == sorted[i]);
+
+    for(int key = -1; key <= 3001; key += 7)
+    {
+        const auto below = static_cast<std::size_t>(std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin());
+        BST_CHECK(tree.rank(key) == below);
+
+        const int high_key = key + 50;
+        const auto up_to_high = static_cast<std::size_t>(std::upper_bound(sorted.begin(), sorted.end(), high_key) - sorted.begin());
+        BST_CHECK(tree.count_range(key, high_key) == up_to_high - below);
+        BST_CHECK(tree.count_range(high_key, key) == 0);
+    }
+}
+
+std::vector<int> random_keys(std::mt19937& rng, std::size_t count)
+{
+    std::uniform_int_distribution<int> random_key(0, 2999);
+    std::vector<int> keys(count);
+    for(int& key : keys)
+        key = random_key(rng);
+    return keys;
+}
+
+template<typename Policy>
+void run_model(unsigned seed)
+{
+    using tree_type = BST::binary_search_tree<int, BST::order_statistics<Policy>>;
+    std::mt19937 rng(seed);
+    tree_type tree;
+    std::multiset<int> model;
+
+    /* Single inserts and removals, then batches */
+    for(int key : random_keys(rng, 800))
+    {
+        tree.insert(key);
+        model.insert(key);
+    }
+    for(int key : random_keys(rng, 300))
+    {
+        tree.delete_node(key);
+        if(const auto found = model.find(key); found != model.end())
+            model.erase(found);
+    }
+    check_against_model(tree, model);
+
+    const std::vector<int> batch = random_keys(rng, 400);
+    tree.insert_batch(batch);
+    model.insert(batch.begin(), batch.end());
+    std::vector<int> erased = random_keys(rng, 200);
+    std::sort(erased.begin(), erased.end());
+    tree.erase_batch(BST::sorted_equivalent, std::span<const int>(erased));
+    for(int key : erased)
+    {
+        if(const auto found = model.find(key); found != model.end())
+            model.erase(found);
+    }
+    check_against_model(tree, model);
+
+    /* Removal through an iterator */
+    for(int i = 0; i < 50 && !model.empty(); ++i)
+    {
+        const std::size_t position = rng() % model.size();
+        tree.erase(std::next(tree.begin(), static_cast<std::ptrdiff_t>(position)));
+        model.erase(std::next(model.begin(), static_cast<std::ptrdiff_t>(position)));
+    }
+    check_against_model(tree, model);
+
+    /* Split at several keys and join back */
+    for(int split_key : {1500, 0, 3000, 777})
+    {
+        tree_type upper = tree.split(split_key);
+        std::multiset<int> upper_model(model.lower_bound(split_key), model.end());
+        model.erase(model.lower_bound(split_key), model.end());
+        check_against_model(tree, model);
+        check_against_model(upper, upper_model);
+
+        upper.insert(split_key + 1);
+        upper_model.insert(split_key + 1);
+        tree.join(std::move(upper));
+        model.insert(upper_model.begin(), upper_model.end());
+        check_against_model(tree, model);
+    }
+
+    /* Bulk load, then the set operations against another tree */
+    std::vector<int> loaded = random_keys(rng, 1000);
+    std::sort(loaded.begin(), loaded.end());
+    tree_type other;
+    other.assign(loaded.begin(), loaded.end());
+    std::multiset<int> other_model(loaded.begin(), loaded.end());
+    check_against_model(other, other_model);
+
+    tree_type intersected(tree);
+    intersected.intersect(other);
+    std::multiset<int> intersected_model;
+    std::copy_if(model.begin(), model.end(), std::inserter(intersected_model, intersected_model.end()), [&](int key) { return other_model.contains(key); });
+    check_against_model(intersected, intersected_model);
+
+    tree_type subtracted(tree);
+    subtracted.difference(other);
+    std::multiset<int> subtracted_model;
+    std::copy_if(model.begin(), model.end(), std::inserter(subtracted_model, subtracted_model.end()), [&](int key) { return !other_model.contains(key); });
+    check_against_model(subtracted, subtracted_model);
+
+    tree_type united(tree);
+    tree_type union_source(other);
+    united.union_with(union_source);
+    std::multiset<int> united_model = model;
+    std::multiset<int> union_source_model;
+    for(int key : other_model)
+        (model.contains(key) ? union_source_model : united_model).insert(key);
+    check_against_model(united, united_model);
+    check_against_model(union_source, union_source_model);
+
+    tree.merge(other);
+    model.insert(other_model.begin(), other_model.end());
+    check_against_model(tree, model);
+    BST_CHECK(other.empty());
+}
+}
+
+int main()
+{
+    for(unsigned seed = 1; seed <= 4; ++seed)
+    {
+        run_model<BST::red_black_policy>(seed);
+        run_model<BST::avl_policy>(seed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Test for task_pool and the parallel tree algorithms, meant to run under ThreadSanitizer as well: nested
+ * task groups, groups fed from several outside threads, exceptions rethrown by task_group::wait, and the
+ * parallel scans, set operations and parallel_clear checked against their serial counterparts.
+ */
+namespace
+{
+using tree_type = BST::binary_search_tree<int, BST::red_black_policy>;
+
+/* Sum of [first, last) by recursive halving, each half a task of a nested group */
+long long nested_sum(BST::task_pool& pool, int first, int last)
+{
+    if(last - first <= 64)
+    {
+        long long sum = 0;
+        for(int value = first; value < last; ++value)
+            sum += value;
+        return sum;
+    }
+
+    const int middle = first + (last - first) / 2;
+    long long left_sum = 0;
+    long long right_sum = 0;
+    BST::task_pool::task_group group(pool);
+    group.spawn([&] { left_sum = nested_sum(pool, first, middle); });
+    group.spawn([&] { right_sum = nested_sum(pool, middle, last); });
+    group.wait();
+    return left_sum + right_sum;
+}
+
+void task_groups(BST::task_pool& pool)
+{
+    BST_CHECK(nested_sum(pool, 0, 100000) == 100000LL * 99999 / 2);
+
+    /* Several outside threads share the pool */
+    std::vector<long long> sums(4);
+    std::vector<std::thread> submitters;
+    for(std::size_t i = 0; i < sums.size(); ++i)
+        submitters.emplace_back([&, i] { sums[i] = nested_sum(pool, 0, 20000 * static_cast<int>(i + 1)); });
+    for(std::thread& submitter : submitters)
+        submitter.join();
+    for(std::size_t i = 0; i < sums.size(); ++i)
+    {
+        const long long count = 20000LL * static_cast<long long>(i + 1);
+        BST_CHECK(sums[i] == count * (count - 1) / 2);
+    }
+
+    /* The first exception comes out of wait once every task has finished; the group is usable again after */
+    BST::task_pool::task_group group(pool);
+    std::atomic<int> finished{0};
+    for(int i = 0; i < 32; ++i)
+    {
+        group.spawn([&finished, i]
+        {
+            finished.fetch_add(1, std::memory_order_relaxed);
+            if(i % 8 == 3)
+                throw std::runtime_error("task failed");
+        });
+    }
+
+    bool rethrown = false;
+    try
+    {
+        group.wait();
+    }
+    catch(const std::runtime_error&)
+    {
+        rethrown = true;
+    }
+    BST_CHECK(rethrown && finished.load() == 32);
+
+    group.spawn([&finished] { finished.fetch_add(1, std::memory_order_relaxed); });
+    group.wait();
+    BST_CHECK(finished.load() == 33);
+}
+
+/* Keys in order as a fold can see them: reduce is associative but not commutative */
+struct ordered_span
+{
+    int first_key;
+    int last_key;
+    std::size_t key_count;
+    bool ascending;
+};
+
+void parallel_scans(BST::task_pool& pool)
+{
+    tree_type tree;
+    for(int key = 0; key < 200000; ++key)
+        tree.insert((key * 7919) % 200000);
+
+    auto is_even = [](int key) { return key % 2 == 0; };
+    BST_CHECK(tree.parallel_count_if(is_even, pool) == tree.count_if(is_even));
+    BST_CHECK(tree.parallel_count(pool) == tree.size());
+
+    std::atomic<long long> visited_sum{0};
+    std::atomic<std::size_t> visited_count{0};
+    tree.parallel_for_each([&](int key)
+    {
+        visited_sum.fetch_add(key, std::memory_order_relaxed);
+        visited_count.fetch_add(1, std::memory_order_relaxed);
+    }, pool);
+    BST_CHECK(visited_count.load() == tree.size() && visited_sum.load() == 200000LL * 199999 / 2);
+
+    const ordered_span whole = tree.parallel_reduce(
+        ordered_span{-1, -1, 0, true},
+        [](ordered_span lhs, ordered_span rhs)
+        {
+            if(lhs.key_count == 0)
+                return rhs;
+            return ordered_span{lhs.first_key, rhs.last_key, lhs.key_count + rhs.key_count,
+                                lhs.ascending && rhs.ascending && lhs.last_key < rhs.first_key};
+        },
+        [](int key) { return ordered_span{key, key, 1, true}; }, pool);
+    BST_CHECK(whole.ascending && whole.key_count == tree.size() && whole.first_key == 0 && whole.last_key == 199999);
+    BST_CHECK(tree.parallel_reduce(0LL, std::plus<long long>(), pool) == 200000LL * 199999 / 2);
+
+    tree.parallel_clear(pool);
+    BST_CHECK(tree.empty() && tree.get_root() == nullptr);
+    tree.insert(1);
+    BST_CHECK(tree.size() == 1);
+}
+
+void parallel_set_operations(BST::task_pool& pool)
+{
+    tree_type evens;
+    tree_type thirds;
+    for(int key = 0; key < 60000; ++key)
+    {
+        if(key % 2 == 0)
+            evens.insert(key);
+        if(key % 3 == 0)
+            thirds.insert(key);
+    }
+
+    auto check_same = [](const tree_type& parallel_result, const tree_type& serial_result)
+    {
+        tree_invariants::check_tree(parallel_result);
+        BST_CHECK(parallel_result.size() == serial_result.size() &&
+                  std::equal(parallel_result.begin(), parallel_result.end(), serial_result.begin()));
+    };
+
+    tree_type parallel_result(evens);
+    tree_type serial_result(evens);
+    parallel_result.parallel_intersect(thirds, pool);
+    serial_result.intersect(thirds);
+    check_same(parallel_result, serial_result);
+
+    parallel_result = evens;
+    serial_result = evens;
+    parallel_result.parallel_difference(thirds, pool);
+    serial_result.difference(thirds);
+    check_same(parallel_result, serial_result);
+
+    parallel_result = evens;
+    serial_result = evens;
+    tree_type parallel_source(thirds);
+    tree_type serial_source(thirds);
+    parallel_result.parallel_union_with(parallel_source, pool);
+    serial_result.union_with(serial_source);
+    check_same(parallel_result, serial_result);
+    check_same(parallel_source, serial_source);
+
+    parallel_result = evens;
+    serial_result = evens;
+    parallel_source = thirds;
+    serial_source = thirds;
+    parallel_result.parallel_merge(parallel_source, pool);
+    serial_result.merge(serial_source);
+    check_same(parallel_result, serial_result);
+    BST_CHECK(parallel_source.empty());
+}
+}
+
+int main()
+{
+    BST::task_pool pool(4);
+    task_groups(pool);
+    parallel_scans(pool);
+    parallel_set_operations(pool);
+    return 0;
+}
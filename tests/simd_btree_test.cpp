@@ -0,0 +1,117 @@
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <type_traits>
+
+#include "bst_btree.hpp"
+#include "test_check.hpp"
+
+/*
+ * Model test for simd_btree: random inserts and removals of keys with many duplicates, checked against a
+ * std::multiset after every batch through size, both iteration directions, count, lower_bound,
+ * upper_bound and a copy. Runs once per kernel level, with int keys, unsigned keys around the top bit,
+ * where the SIMD kernels compare after flipping it, and double keys.
+ */
+namespace
+{
+template<typename Key>
+Key random_key(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> offset(-300, 300);
+    if constexpr(std::is_same_v<Key, unsigned>)
+        return (rng() % 8 == 0) ? 0xFFFFFFFFu - static_cast<unsigned>(offset(rng) + 300) : 0x80000000u + static_cast<unsigned>(offset(rng));
+    else if constexpr(std::is_same_v<Key, double>)
+        return offset(rng) / 4.0;
+    else
+        return static_cast<Key>(offset(rng));
+}
+
+template<typename Tree, typename Key>
+void check_against_model(const Tree& tree, const std::multiset<Key>& model, std::mt19937& rng)
+{
+    BST_CHECK(tree.size() == model.size() && tree.count() == model.size() && tree.empty() == model.empty());
+
+    auto model_position = model.begin();
+    for(Key key : tree)
+        BST_CHECK(model_position != model.end() && key == *model_position++);
+    BST_CHECK(model_position == model.end());
+
+    auto tree_position = tree.end();
+    for(auto model_key = model.rbegin(); model_key != model.rend(); ++model_key)
+        BST_CHECK(*--tree_position == *model_key);
+    BST_CHECK(tree_position == tree.begin());
+
+    for(int probe = 0; probe < 32; ++probe)
+    {
+        const Key key = random_key<Key>(rng);
+        BST_CHECK(tree.count(key) == model.count(key));
+        BST_CHECK(tree.contains(key) == model.contains(key));
+        BST_CHECK(std::distance(tree.begin(), tree.lower_bound(key)) == std::distance(model.begin(), model.lower_bound(key)));
+        BST_CHECK(std::distance(tree.begin(), tree.upper_bound(key)) == std::distance(model.begin(), model.upper_bound(key)));
+    }
+}
+
+template<typename Key, unsigned NodeKeys>
+void run_model(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    BST::simd_btree<Key, NodeKeys> tree;
+    std::multiset<Key> model;
+
+    for(int batch = 0; batch < 40; ++batch)
+    {
+        /* Grow for the first half, shrink for the second, so merges and root collapses are hit too */
+        const unsigned insert_share = (batch < 20) ? 3 : 1;
+        for(int step = 0; step < 200; ++step)
+        {
+            const Key key = random_key<Key>(rng);
+            if(rng() % 4 < insert_share)
+            {
+                BST_CHECK(*tree.insert(key) == key);
+                model.insert(key);
+            }
+            else
+            {
+                const auto found = model.find(key);
+                BST_CHECK(tree.delete_node(key) == (found != model.end()));
+                if(found != model.end())
+                    model.erase(found);
+            }
+        }
+
+        check_against_model(tree, model, rng);
+    }
+
+    const BST::simd_btree<Key, NodeKeys> copy(tree);
+    check_against_model(copy, model, rng);
+    while(!model.empty())
+    {
+        BST_CHECK(tree.delete_node(*model.begin()));
+        model.erase(model.begin());
+    }
+    BST_CHECK(tree.empty() && tree.begin() == tree.end());
+    BST_CHECK(copy.size() == copy.count() && copy.size() > 0);
+}
+
+template<typename Key>
+void run_key_type(unsigned seed)
+{
+    run_model<Key, 16>(seed);
+    run_model<Key, 64>(seed + 1);
+}
+}
+
+int main()
+{
+    for(BST::simd::level requested : {BST::simd::level::scalar, BST::simd::level::sse2, BST::simd::level::avx2})
+    {
+        BST::simd::use_level(requested);
+        run_key_type<int>(1);
+        run_key_type<unsigned>(2);
+        run_key_type<double>(3);
+    }
+
+    return 0;
+}
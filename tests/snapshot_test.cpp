@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Tree snapshots (bst_io.hpp): save() and load() round trips, mapped_bst over a saved file, and the
+ * damaged or mismatched files that load() and mapped_bst must reject with std::runtime_error, leaving
+ * the loading tree as it was.
+ */
+namespace
+{
+using tree_type = BST::binary_search_tree<int, BST::red_black_policy>;
+using set_type = BST::binary_search_tree<int, BST::duplicate_handling<BST::duplicate_keys::reject, BST::red_black_policy>>;
+
+/* Four bytes like an int, aligned to one: only key_alignment tells a snapshot of these from one of ints */
+struct byte_key
+{
+    unsigned char bytes[4];
+
+    auto operator<=>(const byte_key&) const = default;
+};
+
+std::vector<char> read_file(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::filesystem::path& path, const std::vector<char>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template<typename Load>
+bool rejects(Load load)
+{
+    try
+    {
+        load();
+    }
+    catch(const std::runtime_error&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/* A damaged copy of the snapshot at path must be refused by load(), which keeps the tree's keys, and by mapped_bst */
+void check_rejected(const std::filesystem::path& damaged_path, const std::vector<char>& damaged_bytes)
+{
+    write_file(damaged_path, damaged_bytes);
+
+    tree_type tree{1, 2, 3};
+    BST_CHECK(rejects([&] { tree.load(damaged_path); }));
+    BST_CHECK(tree.size() == 3 && tree.search(2) != nullptr);
+    BST_CHECK(rejects([&] { BST::mapped_bst<int> view(damaged_path); }));
+}
+
+void round_trips(const std::filesystem::path& path)
+{
+    tree_type saved;
+    for(int key = 0; key < 5000; ++key)
+        saved.insert((key * 7919) % 3001);
+    saved.save(path);
+
+    tree_type loaded{42};
+    loaded.load(path);
+    BST_CHECK(loaded.size() == saved.size() && std::equal(loaded.begin(), loaded.end(), saved.begin()));
+    BST_CHECK(loaded.search(42) != nullptr && loaded.count(1500) == saved.count(1500));
+
+    /* Equivalent neighbours in the file: a set keeps one of each */
+    set_type set;
+    set.load(path);
+    BST_CHECK(set.size() == 3001 && *set.begin() == 0 && set.maximum()->get_key() == 3000);
+
+    for(BST::snapshot_check check : {BST::snapshot_check::full, BST::snapshot_check::header_only})
+    {
+        const BST::mapped_bst<int> view(path, check);
+        BST_CHECK(view.size() == saved.size() && std::equal(view.begin(), view.end(), saved.begin()));
+        BST_CHECK(view.contains(3000) && !view.contains(3001) && *view.lower_bound(-5) == 0);
+    }
+
+    tree_type empty_tree;
+    empty_tree.save(path);
+    loaded.load(path);
+    BST_CHECK(loaded.empty() && BST::mapped_bst<int>(path).empty());
+}
+
+void damaged_files(const std::filesystem::path& path, const std::filesystem::path& damaged_path)
+{
+    tree_type saved;
+    for(int key = 0; key < 1000; ++key)
+        saved.insert(key);
+    saved.save(path);
+    const std::vector<char> bytes = read_file(path);
+
+    std::vector<char> damaged = bytes;
+    damaged[sizeof(BST::snapshot_header) + sizeof(int) + 100] ^= 0x10;
+    check_rejected(damaged_path, damaged);
+
+    damaged = bytes;
+    damaged[offsetof(BST::snapshot_header, key_count)] ^= 0x01;
+    check_rejected(damaged_path, damaged);
+
+    damaged = bytes;
+    damaged[offsetof(BST::snapshot_header, payload_checksum)] ^= 0x01;
+    check_rejected(damaged_path, damaged);
+
+    damaged.assign(bytes.begin(), bytes.end() - sizeof(int));
+    check_rejected(damaged_path, damaged);
+
+    damaged.assign(bytes.begin(), bytes.begin() + sizeof(BST::snapshot_header) / 2);
+    check_rejected(damaged_path, damaged);
+
+    /* Same file, read as keys of another size or alignment */
+    BST_CHECK(rejects([&] { BST::mapped_bst<long long> view(path); }));
+    BST_CHECK(rejects([&] { BST::mapped_bst<byte_key> view(path); }));
+    BST::binary_search_tree<long long> wider_tree;
+    BST_CHECK(rejects([&] { wider_tree.load(path); }));
+
+    /* Intact, but ordered by another comparison */
+    BST::binary_search_tree<int, BST::red_black_policy, std::allocator<int>, std::greater<>> descending{5};
+    BST_CHECK(rejects([&] { descending.load(path); }));
+    BST_CHECK(descending.size() == 1);
+}
+}
+
+int main()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "bst_snapshot_test.snap";
+    const std::filesystem::path damaged_path = std::filesystem::temp_directory_path() / "bst_snapshot_test_damaged.snap";
+
+    round_trips(path);
+    damaged_files(path, damaged_path);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(damaged_path);
+    return 0;
+}
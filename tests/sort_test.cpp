@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "bst.hpp"
+#include "bst_external_sort.hpp"
+#include "test_check.hpp"
+
+/*
+ * bst_sort, its parallel form and bst_sort_external against std::stable_sort: records sorted by a key
+ * with many duplicates carry their input position, so any reordering of equal keys shows. The external
+ * sort gets memory limits that make it spill, merge in several passes, or fit in one run.
+ */
+namespace
+{
+struct record
+{
+    int key;
+    int input_position;
+
+    friend bool operator==(const record&, const record&) = default;
+};
+
+struct by_key
+{
+    bool operator()(const record& lhs, const record& rhs) const
+    {
+        return lhs.key < rhs.key;
+    }
+};
+
+std::vector<record> random_records(std::size_t count, int distinct_keys, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> key(0, distinct_keys - 1);
+    std::vector<record> records(count);
+    for(std::size_t i = 0; i < count; ++i)
+        records[i] = record{key(rng), static_cast<int>(i)};
+    return records;
+}
+
+/* Shapes the sorts treat specially: random, ascending, strictly descending, one key, and empty */
+std::vector<std::vector<record>> inputs()
+{
+    std::vector<std::vector<record>> shapes;
+    shapes.push_back(random_records(100000, 1000, 1));
+    shapes.push_back(random_records(100000, 7, 2));
+
+    std::vector<record> ascending = random_records(50000, 500, 3);
+    std::stable_sort(ascending.begin(), ascending.end(), by_key());
+    shapes.push_back(ascending);
+
+    std::vector<record> descending(50000);
+    for(std::size_t i = 0; i < descending.size(); ++i)
+        descending[i] = record{static_cast<int>(descending.size() - i), static_cast<int>(i)};
+    shapes.push_back(descending);
+
+    shapes.push_back(random_records(20000, 1, 4));
+    shapes.push_back({});
+    return shapes;
+}
+
+void check_sorts(const std::vector<record>& input, BST::task_pool& pool)
+{
+    std::vector<record> expected = input;
+    std::stable_sort(expected.begin(), expected.end(), by_key());
+
+    std::vector<record> sorted = input;
+    BST::bst_sort(sorted.begin(), sorted.end(), by_key());
+    BST_CHECK(sorted == expected);
+
+    sorted = input;
+    BST::bst_sort(pool, sorted.begin(), sorted.end(), by_key());
+    BST_CHECK(sorted == expected);
+
+    sorted.assign(input.size(), record{});
+    BST_CHECK(BST::bst_sort_copy(pool, input.begin(), input.end(), sorted.begin(), by_key()) == sorted.end());
+    BST_CHECK(sorted == expected);
+
+    /* 1 byte: minimal runs merged two at a time over many passes; 64 KiB: several runs, 64 MiB: one run in memory */
+    for(std::size_t memory_limit : {std::size_t(1), std::size_t(1) << 16, std::size_t(1) << 26})
+    {
+        sorted.clear();
+        BST::bst_sort_external(input.begin(), input.end(), std::back_inserter(sorted), memory_limit, by_key());
+        BST_CHECK(sorted == expected);
+    }
+}
+}
+
+int main()
+{
+    BST::task_pool pool(4);
+    for(const std::vector<record>& input : inputs())
+        check_sorts(input, pool);
+
+    return 0;
+}
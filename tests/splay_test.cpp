@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <type_traits>
+#include <utility>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+#include "tree_invariants.hpp"
+
+/*
+ * Model test for the policies that restructure the tree on lookups: splay_policy, semi_splay_policy and
+ * sampled_splaying, alone and under order_statistics and duplicate_handling. Random inserts, removals
+ * and non-const searches run against a std::multiset, and the nodes are walked for order, parent links
+ * and subtree sizes after every round of searches, since each search may have rotated the tree.
+ */
+namespace
+{
+/* Full splaying on every search, where the found node must end up at the root */
+template<typename Policy>
+constexpr bool splays_to_root = std::is_same_v<Policy, BST::splay_policy> || std::is_same_v<Policy, BST::order_statistics<BST::splay_policy>> ||
+                                std::is_same_v<Policy, BST::sampled_splaying<1, BST::splay_policy>>;
+
+template<typename Tree>
+void check_against_model(const Tree& tree, const std::multiset<int>& model)
+{
+    tree_invariants::check_tree(tree);
+    BST_CHECK(tree.size() == model.size() && std::equal(tree.begin(), tree.end(), model.begin(), model.end()));
+}
+
+template<typename Policy>
+void run_model(unsigned seed)
+{
+    using tree_type = BST::binary_search_tree<int, Policy>;
+    constexpr bool unique_keys = tree_type::duplicate_mode == BST::duplicate_keys::reject;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> random_key(0, 499);
+    tree_type tree;
+    std::multiset<int> model;
+
+    for(int round = 0; round < 40; ++round)
+    {
+        for(int step = 0; step < 100; ++step)
+        {
+            const int key = random_key(rng);
+            if(rng() % 3 != 0)
+            {
+                tree.insert(key);
+                if(!unique_keys || !model.contains(key))
+                    model.insert(key);
+            }
+            else
+            {
+                tree.delete_node(key);
+                if(const auto found = model.find(key); found != model.end())
+                    model.erase(found);
+            }
+        }
+
+        check_against_model(tree, model);
+
+        /* Searches skewed towards a few hot keys, then uniform ones */
+        for(int step = 0; step < 200; ++step)
+        {
+            const int key = (step < 100) ? random_key(rng) % 8 : random_key(rng);
+            const typename tree_type::node_pointer found_node = tree.search(key);
+            BST_CHECK((found_node != nullptr) == model.contains(key));
+            if(found_node != nullptr)
+            {
+                BST_CHECK(found_node->get_key() == key);
+                if constexpr(splays_to_root<Policy>)
+                    BST_CHECK(tree.get_root() == found_node);
+            }
+
+            if(step % 25 == 0)
+                check_against_model(tree, model);
+        }
+
+        check_against_model(tree, model);
+
+        /* A const search must leave the shape alone */
+        const typename tree_type::node_pointer root_before = tree.get_root();
+        std::as_const(tree).search(random_key(rng));
+        BST_CHECK(tree.get_root() == root_before);
+    }
+
+    /* Ascending inserts make a chain; searching its far end must undo it without breaking the links */
+    tree.clear();
+    model.clear();
+    for(int key = 0; key < 2000; ++key)
+    {
+        tree.insert(key);
+        model.insert(key);
+    }
+    BST_CHECK(tree.search(0) != nullptr && tree.search(1999) != nullptr && tree.search(1000) != nullptr);
+    check_against_model(tree, model);
+}
+
+template<typename Policy>
+void run_policy()
+{
+    for(unsigned seed = 1; seed <= 4; ++seed)
+        run_model<Policy>(seed);
+}
+}
+
+int main()
+{
+    run_policy<BST::splay_policy>();
+    run_policy<BST::semi_splay_policy>();
+    run_policy<BST::sampled_splaying<1, BST::splay_policy>>();
+    run_policy<BST::sampled_splaying<>>();
+    run_policy<BST::order_statistics<BST::splay_policy>>();
+    run_policy<BST::duplicate_handling<BST::duplicate_keys::reject, BST::semi_splay_policy>>();
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * tree_stats and shape_report() of instrumented trees: the counters each operation moves, allocations
+ * minus deallocations staying the tree's size through extract, splice and a dropped node handle, the
+ * map insert paths, and the exact JSON both reports write.
+ */
+namespace
+{
+using stats_tree = BST::binary_search_tree<int, BST::instrumented<>>;
+using stats_map = BST::bst_map<int, std::string, BST::instrumented<>>;
+
+template<typename _Tree>
+std::uint64_t live_nodes(const _Tree& tree)
+{
+    return tree.stats().allocations - tree.stats().deallocations;
+}
+
+void counts_operations()
+{
+    stats_tree tree;
+    for(int key : {2, 1, 3, 1})
+        tree.insert(key);
+    BST_CHECK(tree.stats().inserts == 4);
+    BST_CHECK(tree.stats().allocations == 4);
+    BST_CHECK(tree.stats().insert_nodes_visited == 0 + 1 + 1 + 2);
+
+    BST_CHECK(tree.search(3) != nullptr && tree.search(4) == nullptr);
+    BST_CHECK(tree.stats().searches == 2);
+    BST_CHECK(tree.stats().search_nodes_visited == 2 + 2);
+
+    BST_CHECK(tree.erase(1) == 2);
+    BST_CHECK(tree.stats().erases == 1);
+    BST_CHECK(tree.stats().deallocations == 2);
+    BST_CHECK(live_nodes(tree) == tree.size());
+
+    tree.reset_stats();
+    BST_CHECK(tree.stats().to_json() == BST::tree_stats().to_json());
+}
+
+void counts_extracted_nodes()
+{
+    stats_tree tree;
+    for(int key = 0; key < 10; ++key)
+        tree.insert(key);
+
+    {
+        auto dropped = tree.extract(4);
+        BST_CHECK(!dropped.empty());
+        BST_CHECK(live_nodes(tree) == tree.size());
+    }
+    BST_CHECK(live_nodes(tree) == tree.size());
+
+    stats_tree other;
+    other.insert(20);
+    auto moved = tree.extract(tree.begin());
+    BST_CHECK(live_nodes(tree) == tree.size());
+    other.splice(std::move(moved));
+    BST_CHECK(other.size() == 2 && other.count(0) == 1);
+    BST_CHECK(live_nodes(other) == other.size());
+
+    tree.clear();
+    BST_CHECK(live_nodes(tree) == 0);
+}
+
+void counts_map_inserts()
+{
+    stats_map map;
+    BST_CHECK(map.try_emplace(1, "one").second);
+    BST_CHECK(!map.try_emplace(1, "uno").second);
+    BST_CHECK(map.emplace(2, "two").second);
+    BST_CHECK(!map.emplace(2, "dos").second);
+    BST_CHECK(map.stats().inserts == 4);
+    BST_CHECK(map.stats().allocations == 3 && map.stats().deallocations == 1);
+    BST_CHECK(live_nodes(map) == map.size());
+}
+
+void writes_json()
+{
+    BST_CHECK(BST::tree_stats().to_json() ==
+              "{\"searches\":0,\"inserts\":0,\"erases\":0,\"search_nodes_visited\":0,\"insert_nodes_visited\":0,"
+              "\"erase_nodes_visited\":0,\"comparisons\":0,\"allocations\":0,\"deallocations\":0,"
+              "\"path_lengths\":[]}");
+
+    stats_tree tree;
+    BST_CHECK(tree.shape_report().to_json() ==
+              "{\"node_count\":0,\"height\":0,\"average_depth\":0,\"balance_factor\":1,\"level_counts\":[]}");
+
+    for(int key : {2, 1, 3})
+        tree.insert(key);
+    BST_CHECK(tree.stats().to_json() ==
+              "{\"searches\":0,\"inserts\":3,\"erases\":0,\"search_nodes_visited\":0,\"insert_nodes_visited\":2,"
+              "\"erase_nodes_visited\":0,\"comparisons\":2,\"allocations\":3,\"deallocations\":0,"
+              "\"path_lengths\":[1,2]}");
+    BST_CHECK(tree.shape_report().to_json() ==
+              "{\"node_count\":3,\"height\":2,\"average_depth\":0.6666666666666666,\"balance_factor\":1,"
+              "\"level_counts\":[1,2]}");
+
+    tree.insert(4);
+    BST_CHECK(tree.shape_report().to_json() ==
+              "{\"node_count\":4,\"height\":3,\"average_depth\":1,\"balance_factor\":1,\"level_counts\":[1,2,1]}");
+}
+}
+
+int main()
+{
+    counts_operations();
+    counts_extracted_nodes();
+    counts_map_inserts();
+    writes_json();
+    return 0;
+}
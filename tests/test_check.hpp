@@ -0,0 +1,18 @@
+#ifndef BST_TEST_CHECK_HPP_INCLUDED
+#define BST_TEST_CHECK_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+
+/* Stops the test with the failed condition and its location; the tests have no framework to report through */
+#define BST_CHECK(condition)                                                                     \
+    do                                                                                           \
+    {                                                                                            \
+        if(!(condition))                                                                         \
+        {                                                                                        \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(EXIT_FAILURE);                                                             \
+        }                                                                                        \
+    } while(false)
+
+#endif // BST_TEST_CHECK_HPP_INCLUDED
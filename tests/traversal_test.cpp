@@ -0,0 +1,218 @@
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Test for the visitor walks and copy_to in each traversal_order. A tree of known shape, built by
+ * inserting its preorder keys into an unbalanced tree, has its four orders spelled out, for the whole
+ * tree and for a subtree, whose walk must not leave it. Visitors that return false stop the walk, and
+ * larger red-black trees are compared against a recursive walk over the child links.
+ */
+namespace
+{
+using plain_tree = BST::binary_search_tree<int>;
+
+/*
+ *          8
+ *        /   \
+ *       4     12
+ *      / \    /
+ *     2   6  10
+ *    /     \   \
+ *   1       7   11
+ */
+constexpr std::array<int, 9> preorder_keys = {8, 4, 2, 1, 6, 7, 12, 10, 11};
+constexpr std::array<int, 9> inorder_keys = {1, 2, 4, 6, 7, 8, 10, 11, 12};
+constexpr std::array<int, 9> postorder_keys = {1, 2, 7, 6, 4, 11, 10, 12, 8};
+constexpr std::array<int, 9> levelorder_keys = {8, 4, 12, 2, 6, 10, 1, 7, 11};
+
+template<typename Tree>
+std::vector<int> walked(const Tree& tree, BST::traversal_order order, typename Tree::node_pointer starting_node)
+{
+    std::vector<int> keys;
+    const auto visit = [&keys](int key) { keys.push_back(key); };
+    switch(order)
+    {
+        case BST::traversal_order::inorder:     tree.for_each_inorder(starting_node, visit); break;
+        case BST::traversal_order::preorder:    tree.for_each_preorder(starting_node, visit); break;
+        case BST::traversal_order::postorder:   tree.for_each_postorder(starting_node, visit); break;
+        case BST::traversal_order::level_order:
+        {
+            typename Tree::level_order_queue queue;
+            tree.for_each_levelorder(starting_node, visit, queue);
+            break;
+        }
+    }
+    return keys;
+}
+
+template<typename Tree>
+std::vector<int> copied(const Tree& tree, BST::traversal_order order)
+{
+    std::vector<int> keys(tree.size() + 1, -1);
+    const auto past_last = tree.copy_to(keys.begin(), order);
+    BST_CHECK(past_last == keys.begin() + static_cast<std::ptrdiff_t>(tree.size()) && keys.back() == -1);
+    keys.pop_back();
+    return keys;
+}
+
+template<std::size_t N>
+std::vector<int> as_vector(const std::array<int, N>& keys)
+{
+    return std::vector<int>(keys.begin(), keys.end());
+}
+
+void known_shape()
+{
+    plain_tree tree;
+    for(int key : preorder_keys)
+        tree.insert(key);
+
+    struct expectation
+    {
+        BST::traversal_order order;
+        std::vector<int> keys;
+        std::vector<int> subtree_keys; /* Under the node holding 4 */
+    };
+    const std::array<expectation, 4> expectations = {{
+        {BST::traversal_order::inorder, as_vector(inorder_keys), {1, 2, 4, 6, 7}},
+        {BST::traversal_order::preorder, as_vector(preorder_keys), {4, 2, 1, 6, 7}},
+        {BST::traversal_order::postorder, as_vector(postorder_keys), {1, 2, 7, 6, 4}},
+        {BST::traversal_order::level_order, as_vector(levelorder_keys), {4, 2, 6, 1, 7}},
+    }};
+
+    const plain_tree::node_pointer subtree = tree.search(4);
+    for(const expectation& expected : expectations)
+    {
+        BST_CHECK(walked(tree, expected.order, tree.get_root()) == expected.keys);
+        BST_CHECK(copied(tree, expected.order) == expected.keys);
+        BST_CHECK(walked(tree, expected.order, subtree) == expected.subtree_keys);
+    }
+
+    /* The overloads without a starting node walk the whole tree */
+    std::vector<int> keys;
+    tree.for_each_postorder([&keys](int key) { keys.push_back(key); });
+    BST_CHECK(keys == as_vector(postorder_keys));
+    keys.clear();
+    tree.for_each_levelorder([&keys](int key) { keys.push_back(key); });
+    BST_CHECK(keys == as_vector(levelorder_keys));
+
+    /* A visitor returning false ends each walk right after that key */
+    std::vector<int> stopped;
+    const auto three_keys = [&stopped](int key) { stopped.push_back(key); return stopped.size() < 3; };
+    tree.for_each_preorder(three_keys);
+    BST_CHECK(stopped == std::vector<int>(preorder_keys.begin(), preorder_keys.begin() + 3));
+    stopped.clear();
+    tree.for_each_postorder(three_keys);
+    BST_CHECK(stopped == std::vector<int>(postorder_keys.begin(), postorder_keys.begin() + 3));
+    stopped.clear();
+    plain_tree::level_order_queue queue;
+    tree.for_each_levelorder(three_keys, queue);
+    BST_CHECK(stopped == std::vector<int>(levelorder_keys.begin(), levelorder_keys.begin() + 3));
+    stopped.clear();
+    tree.for_each_inorder(three_keys);
+    BST_CHECK(stopped == std::vector<int>(inorder_keys.begin(), inorder_keys.begin() + 3));
+
+    /* Preorder keys inserted into an empty unbalanced tree rebuild the same shape */
+    plain_tree rebuilt;
+    for(int key : copied(tree, BST::traversal_order::preorder))
+        rebuilt.insert(key);
+    BST_CHECK(copied(rebuilt, BST::traversal_order::level_order) == as_vector(levelorder_keys));
+
+    /* A tree that is one long right spine */
+    plain_tree spine;
+    for(int key = 1; key <= 5; ++key)
+        spine.insert(key);
+    BST_CHECK(copied(spine, BST::traversal_order::preorder) == std::vector<int>({1, 2, 3, 4, 5}));
+    BST_CHECK(copied(spine, BST::traversal_order::postorder) == std::vector<int>({5, 4, 3, 2, 1}));
+    BST_CHECK(copied(spine, BST::traversal_order::level_order) == std::vector<int>({1, 2, 3, 4, 5}));
+
+    const plain_tree empty;
+    for(const expectation& expected : expectations)
+    {
+        BST_CHECK(walked(empty, expected.order, empty.get_root()).empty());
+        BST_CHECK(copied(empty, expected.order).empty());
+    }
+}
+
+/* Recursive reference walks over the child links */
+template<typename Node>
+void reference_walk(const Node* node, std::vector<int>& preorder, std::vector<int>& inorder, std::vector<int>& postorder)
+{
+    if(node == nullptr)
+        return;
+
+    preorder.push_back(node->get_key());
+    reference_walk(node->get_left(), preorder, inorder, postorder);
+    inorder.push_back(node->get_key());
+    reference_walk(node->get_right(), preorder, inorder, postorder);
+    postorder.push_back(node->get_key());
+}
+
+template<typename Node>
+std::vector<int> reference_levelorder(const Node* root)
+{
+    std::vector<int> keys;
+    std::vector<const Node*> level;
+    if(root != nullptr)
+        level.push_back(root);
+    while(!level.empty())
+    {
+        std::vector<const Node*> next_level;
+        for(const Node* node : level)
+        {
+            keys.push_back(node->get_key());
+            if(node->get_left() != nullptr)
+                next_level.push_back(node->get_left());
+            if(node->get_right() != nullptr)
+                next_level.push_back(node->get_right());
+        }
+        level.swap(next_level);
+    }
+    return keys;
+}
+
+void random_shapes()
+{
+    using tree_type = BST::binary_search_tree<int, BST::red_black_policy>;
+    std::mt19937 rng(7);
+    for(std::size_t key_count : {1u, 2u, 3u, 17u, 200u, 1000u})
+    {
+        tree_type tree;
+        for(std::size_t i = 0; i < key_count; ++i)
+            tree.insert(static_cast<int>(rng() % 500));
+
+        std::vector<int> preorder;
+        std::vector<int> inorder;
+        std::vector<int> postorder;
+        reference_walk(tree.get_root(), preorder, inorder, postorder);
+        BST_CHECK(copied(tree, BST::traversal_order::preorder) == preorder);
+        BST_CHECK(copied(tree, BST::traversal_order::inorder) == inorder);
+        BST_CHECK(copied(tree, BST::traversal_order::postorder) == postorder);
+        BST_CHECK(copied(tree, BST::traversal_order::level_order) == reference_levelorder(tree.get_root()));
+
+        /* Subtree walks of the root's left child */
+        const auto left = tree.get_root()->get_left();
+        preorder.clear();
+        inorder.clear();
+        postorder.clear();
+        reference_walk(left, preorder, inorder, postorder);
+        BST_CHECK(walked(tree, BST::traversal_order::preorder, left) == preorder);
+        BST_CHECK(walked(tree, BST::traversal_order::inorder, left) == inorder);
+        BST_CHECK(walked(tree, BST::traversal_order::postorder, left) == postorder);
+        BST_CHECK(walked(tree, BST::traversal_order::level_order, left) == reference_levelorder(left));
+    }
+}
+}
+
+int main()
+{
+    known_shape();
+    random_shapes();
+    return 0;
+}
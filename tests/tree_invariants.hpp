@@ -0,0 +1,82 @@
+#ifndef BST_TEST_TREE_INVARIANTS_HPP_INCLUDED
+#define BST_TEST_TREE_INVARIANTS_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "bst.hpp"
+#include "test_check.hpp"
+
+/*
+ * Structural checks shared by the tree tests: parent links, key order, the invariants of the balancing
+ * policy and the subtree sizes of order_statistics, walked node by node rather than through the
+ * iterators, which rely on the links being checked.
+ */
+namespace tree_invariants
+{
+struct subtree_facts
+{
+    std::size_t height;
+    std::size_t black_height;
+    std::size_t node_count;
+};
+
+template<typename Tree>
+subtree_facts check_subtree(const Tree& tree, typename Tree::node_pointer subtree_root, typename Tree::node_pointer parent_node,
+                            std::vector<typename Tree::value_type>& inorder_keys)
+{
+    using policy = typename Tree::balance_policy;
+    if(subtree_root == nullptr)
+        return subtree_facts{0, 1, 0};
+
+    BST_CHECK(subtree_root->get_parent() == parent_node);
+    const subtree_facts left = check_subtree(tree, subtree_root->get_left(), subtree_root, inorder_keys);
+    inorder_keys.push_back(subtree_root->get_key());
+    const subtree_facts right = check_subtree(tree, subtree_root->get_right(), subtree_root, inorder_keys);
+
+    const subtree_facts facts{1 + std::max(left.height, right.height), left.black_height, 1 + left.node_count + right.node_count};
+    if constexpr(std::is_base_of_v<BST::red_black_policy, policy>)
+    {
+        const bool red = policy::is_red(subtree_root);
+        BST_CHECK(!red || (!policy::is_red(subtree_root->get_left()) && !policy::is_red(subtree_root->get_right())));
+        BST_CHECK(left.black_height == right.black_height);
+        return subtree_facts{facts.height, left.black_height + (red ? 0 : 1), facts.node_count};
+    }
+    else if constexpr(std::is_base_of_v<BST::avl_policy, policy>)
+    {
+        const long height_difference = static_cast<long>(right.height) - static_cast<long>(left.height);
+        BST_CHECK(height_difference >= -1 && height_difference <= 1);
+        BST_CHECK(subtree_root->get_balance() == height_difference);
+    }
+
+    if constexpr(Tree::counts_subtrees)
+        BST_CHECK(subtree_root->get_subtree_size() == facts.node_count);
+
+    return facts;
+}
+
+/* Checks the whole tree, that its iterators visit the keys in the order of its nodes, and returns its height */
+template<typename Tree>
+std::size_t check_tree(const Tree& tree)
+{
+    std::vector<typename Tree::value_type> inorder_keys;
+    const subtree_facts facts = check_subtree(tree, tree.get_root(), nullptr, inorder_keys);
+    if constexpr(std::is_base_of_v<BST::red_black_policy, typename Tree::balance_policy>)
+        BST_CHECK(!BST::red_black_policy::is_red(tree.get_root()));
+
+    const auto& comp = tree.key_comp();
+    BST_CHECK(std::is_sorted(inorder_keys.begin(), inorder_keys.end(), comp));
+    if constexpr(Tree::duplicate_mode != BST::duplicate_keys::chain)
+        BST_CHECK(std::adjacent_find(inorder_keys.begin(), inorder_keys.end(), [&](const auto& lhs, const auto& rhs) { return !comp(lhs, rhs); }) == inorder_keys.end());
+
+    BST_CHECK(facts.node_count == tree.size());
+    BST_CHECK(std::equal(tree.begin(), tree.end(), inorder_keys.begin(), inorder_keys.end(),
+                         [&](const auto& lhs, const auto& rhs) { return !comp(lhs, rhs) && !comp(rhs, lhs); }));
+    return facts.height;
+}
+}
+
+#endif // BST_TEST_TREE_INVARIANTS_HPP_INCLUDED